@@ -52,8 +52,18 @@
     (((uint32_t)(data_type_id)) | (((uint32_t)(transfer_type)) << 16U) |                            \
     (((uint32_t)(src_node_id)) << 18U) | (((uint32_t)(dst_node_id)) << 25U))
 
+#define DATA_TYPE_FROM_DESCRIPTOR(x)                ((uint16_t)((x) & 0xFFFFU))
+#define TRANSFER_TYPE_FROM_DESCRIPTOR(x)            ((uint8_t) (((x) >> 16U) & 0x3U))
+#define SOURCE_ID_FROM_DESCRIPTOR(x)                ((uint8_t) (((x) >> 18U) & 0x7FU))
+
 #define TRANSFER_ID_FROM_TAIL_BYTE(x)               ((uint8_t)((x) & 0x1FU))
 
+#if CANARD_RX_STATE_ARRAY_SIZE > 0
+#define RX_STATE_ALLOCATOR(ins)                     (&(ins)->rx_state_allocator)
+#else
+#define RX_STATE_ALLOCATOR(ins)                     (&(ins)->allocator)
+#endif
+
 // The extra cast to unsigned is needed to squelch warnings from clang-tidy
 #define IS_START_OF_TRANSFER(x)                     ((bool)(((uint32_t)(x) >> 7U) & 0x1U))
 #define IS_END_OF_TRANSFER(x)                       ((bool)(((uint32_t)(x) >> 6U) & 0x1U))
@@ -98,6 +108,14 @@ void canardInit(CanardInstance* out_ins,
         pool_capacity = 0xFFFFU;
     }
 
+#if CANARD_RX_STATE_ARRAY_SIZE > 0
+    // The RX state array occupies the beginning of the arena; the general pool takes the rest
+    const size_t rx_state_capacity = MIN((size_t)CANARD_RX_STATE_ARRAY_SIZE, pool_capacity);
+    initPoolAllocator(&out_ins->rx_state_allocator, mem_arena, (uint16_t)rx_state_capacity);
+    mem_arena = (uint8_t*)mem_arena + (rx_state_capacity * CANARD_MEM_BLOCK_SIZE);
+    pool_capacity -= rx_state_capacity;
+#endif
+
     initPoolAllocator(&out_ins->allocator, mem_arena, (uint16_t)pool_capacity);
 }
 
@@ -397,7 +415,7 @@ void canardPopTxQueue(CanardInstance* ins)
 {
     CanardTxQueueItem* item = ins->tx_queue;
     ins->tx_queue = item->next;
-    freeBlock(&ins->allocator, item);
+    freeBlock(&ins->allocator, CanardPoolConsumerTx, item);
 }
 
 int16_t canardHandleRxFrame(CanardInstance* ins, const CanardCANFrame* frame, uint64_t timestamp_usec)
@@ -443,8 +461,10 @@ int16_t canardHandleRxFrame(CanardInstance* ins, const CanardCANFrame* frame, ui
 
             if(rx_state == NULL)
             {
+                notifyPoolOutOfMemory(ins, CanardPoolConsumerRxState, data_type_id, transfer_type);
                 return -CANARD_ERROR_OUT_OF_MEMORY;
             }
+            checkPoolLowWatermark(ins);
         }
         else
         {
@@ -559,8 +579,10 @@ int16_t canardHandleRxFrame(CanardInstance* ins, const CanardCANFrame* frame, ui
         {
             releaseStatePayload(ins, rx_state);
             prepareForNextTransfer(rx_state);
+            notifyPoolOutOfMemory(ins, CanardPoolConsumerRxPayload, data_type_id, transfer_type);
             return -CANARD_ERROR_OUT_OF_MEMORY;
         }
+        checkPoolLowWatermark(ins);
         rx_state->payload_crc = (uint16_t)(((uint16_t) frame->data[0]) | (uint16_t)((uint16_t) frame->data[1] << 8U));
         rx_state->calculated_crc = crcAddSignature(0xFFFFU, data_type_signature);
         rx_state->calculated_crc = crcAdd((uint16_t)rx_state->calculated_crc,
@@ -574,8 +596,10 @@ int16_t canardHandleRxFrame(CanardInstance* ins, const CanardCANFrame* frame, ui
         {
             releaseStatePayload(ins, rx_state);
             prepareForNextTransfer(rx_state);
+            notifyPoolOutOfMemory(ins, CanardPoolConsumerRxPayload, data_type_id, transfer_type);
             return -CANARD_ERROR_OUT_OF_MEMORY;
         }
+        checkPoolLowWatermark(ins);
         rx_state->calculated_crc = crcAdd((uint16_t)rx_state->calculated_crc,
                                           frame->data, (uint8_t)(frame->data_len - 1));
     }
@@ -670,32 +694,18 @@ int16_t canardHandleRxFrame(CanardInstance* ins, const CanardCANFrame* frame, ui
 
 void canardCleanupStaleTransfers(CanardInstance* ins, uint64_t current_time_usec)
 {
-    CanardRxState* prev = ins->rx_states, * state = ins->rx_states;
+    CanardRxState* prev = NULL, * state = ins->rx_states;
 
     while (state != NULL)
     {
         if ((current_time_usec - state->timestamp_usec) > TRANSFER_TIMEOUT_USEC)
         {
-            if (state == ins->rx_states)
-            {
-                releaseStatePayload(ins, state);
-                ins->rx_states = canardRxFromIdx(&ins->allocator, ins->rx_states->next);
-                freeBlock(&ins->allocator, state);
-                state = ins->rx_states;
-                prev = state;
-            }
-            else
-            {
-                releaseStatePayload(ins, state);
-                prev->next = state->next;
-                freeBlock(&ins->allocator, state);
-                state = canardRxFromIdx(&ins->allocator, prev->next);
-            }
+            state = removeRxState(ins, prev, state);
         }
         else
         {
             prev = state;
-            state = canardRxFromIdx(&ins->allocator, state->next);
+            state = canardRxFromIdx(RX_STATE_ALLOCATOR(ins), state->next);
         }
     }
 
@@ -715,14 +725,14 @@ void canardCleanupStaleTransfers(CanardInstance* ins, uint64_t current_time_usec
             if (item == ins->tx_queue)
             {
                 ins->tx_queue = ins->tx_queue->next;
-                freeBlock(&ins->allocator, item);
+                freeBlock(&ins->allocator, CanardPoolConsumerTx, item);
                 item = ins->tx_queue;
                 prev_item = item;
             }
             else
             {
                 prev_item->next = item->next;
-                freeBlock(&ins->allocator, item);
+                freeBlock(&ins->allocator, CanardPoolConsumerTx, item);
                 item = prev_item->next;
             }
         }
@@ -735,6 +745,71 @@ void canardCleanupStaleTransfers(CanardInstance* ins, uint64_t current_time_usec
 #endif
 }
 
+void canardReset(CanardInstance* ins, uint8_t flags)
+{
+    CANARD_ASSERT(ins != NULL);
+
+    const bool reset_rx = (flags & CANARD_RESET_RX_STATES) != 0U;
+    const bool reset_tx = (flags & CANARD_RESET_TX_QUEUE) != 0U;
+
+    // The general pool can be reinitialized as a whole only if nothing in it survives the reset
+    const bool rx_in_pool = (ins->rx_states != NULL) && !reset_rx;
+    const bool tx_in_pool = (ins->tx_queue != NULL) && !reset_tx;
+
+    if (!rx_in_pool && !tx_in_pool)
+    {
+        ins->rx_states = NULL;
+        ins->tx_queue = NULL;
+#if CANARD_RX_STATE_ARRAY_SIZE > 0
+        resetPoolAllocator(&ins->rx_state_allocator);
+#endif
+        resetPoolAllocator(&ins->allocator);
+    }
+    else if (reset_rx)
+    {
+        CanardRxState* state = ins->rx_states;
+        while (state != NULL)
+        {
+            state = removeRxState(ins, NULL, state);
+        }
+    }
+    else if (reset_tx)
+    {
+        while (ins->tx_queue != NULL)
+        {
+            canardPopTxQueue(ins);
+        }
+    }
+    else
+    {
+        // Nothing to do
+    }
+
+    ins->pool_below_watermark = false;
+}
+
+uint16_t canardPurgeRxStatesFromNode(CanardInstance* ins, uint8_t source_node_id)
+{
+    CANARD_ASSERT(ins != NULL);
+
+    uint16_t purged = 0;
+    CanardRxState* prev = NULL, * state = ins->rx_states;
+    while (state != NULL)
+    {
+        if (SOURCE_ID_FROM_DESCRIPTOR(state->dtid_tt_snid_dnid) == source_node_id)
+        {
+            state = removeRxState(ins, prev, state);
+            purged++;
+        }
+        else
+        {
+            prev = state;
+            state = canardRxFromIdx(RX_STATE_ALLOCATOR(ins), state->next);
+        }
+    }
+    return purged;
+}
+
 int16_t canardDecodeScalar(const CanardRxTransfer* transfer,
                            uint32_t bit_offset,
                            uint8_t bit_length,
@@ -1007,7 +1082,7 @@ void canardReleaseRxTransferPayload(CanardInstance* ins, CanardRxTransfer* trans
     while (transfer->payload_middle != NULL)
     {
         CanardBufferBlock* const temp = transfer->payload_middle->next;
-        freeBlock(&ins->allocator, transfer->payload_middle);
+        freeBlock(&ins->allocator, CanardPoolConsumerRxPayload, transfer->payload_middle);
         transfer->payload_middle = temp;
     }
 
@@ -1022,6 +1097,191 @@ CanardPoolAllocatorStatistics canardGetPoolAllocatorStatistics(CanardInstance* i
     return ins->allocator.statistics;
 }
 
+int16_t canardSetPoolQuota(CanardInstance* ins,
+                           CanardPoolConsumer consumer,
+                           uint16_t reserved_blocks,
+                           uint16_t max_blocks)
+{
+    CANARD_ASSERT(ins != NULL);
+
+    if ((uint32_t)consumer >= CANARD_POOL_NUM_CONSUMERS || reserved_blocks > max_blocks)
+    {
+        return -CANARD_ERROR_INVALID_ARGUMENT;
+    }
+
+    CanardPoolAllocator* const allocator =
+        (consumer == CanardPoolConsumerRxState) ? RX_STATE_ALLOCATOR(ins) : &ins->allocator;
+
+    uint32_t total_reserved = reserved_blocks;
+    for (uint8_t i = 0; i < CANARD_POOL_NUM_CONSUMERS; i++)
+    {
+        if (i != (uint8_t)consumer)
+        {
+            total_reserved += allocator->consumers[i].reserved_blocks;
+        }
+    }
+    if (total_reserved > allocator->statistics.capacity_blocks)
+    {
+        return -CANARD_ERROR_INVALID_ARGUMENT;
+    }
+
+#if CANARD_ALLOCATE_SEM
+    canard_allocate_sem_take(allocator);
+#endif
+    allocator->consumers[consumer].reserved_blocks = reserved_blocks;
+    allocator->consumers[consumer].max_blocks = max_blocks;
+#if CANARD_ALLOCATE_SEM
+    canard_allocate_sem_give(allocator);
+#endif
+    return CANARD_OK;
+}
+
+CanardPoolConsumerStatistics canardGetPoolConsumerStatistics(const CanardInstance* ins,
+                                                             CanardPoolConsumer consumer)
+{
+    CANARD_ASSERT((uint32_t)consumer < CANARD_POOL_NUM_CONSUMERS);
+    if (consumer == CanardPoolConsumerRxState)
+    {
+        return RX_STATE_ALLOCATOR(ins)->consumers[consumer];
+    }
+    return ins->allocator.consumers[consumer];
+}
+
+void canardSetPoolHooks(CanardInstance* ins,
+                        uint16_t low_watermark_blocks,
+                        CanardOnPoolLowWatermark on_low_watermark,
+                        CanardOnPoolOutOfMemory on_out_of_memory)
+{
+    CANARD_ASSERT(ins != NULL);
+    ins->pool_low_watermark_blocks = low_watermark_blocks;
+    ins->on_pool_low_watermark = on_low_watermark;
+    ins->on_pool_out_of_memory = on_out_of_memory;
+    ins->pool_below_watermark = false;
+}
+
+uint16_t canardGetPoolUsageBreakdown(const CanardInstance* ins,
+                                     CanardPoolUsageEntry* out_entries,
+                                     uint16_t max_entries)
+{
+    CANARD_ASSERT(ins != NULL);
+    CANARD_ASSERT((out_entries != NULL) || (max_entries == 0));
+
+    // Cast away const to reuse the index helpers; the allocators are not modified
+    CanardPoolAllocator* const allocator = (CanardPoolAllocator*) &ins->allocator;
+    CanardPoolAllocator* const rx_state_allocator = (CanardPoolAllocator*) RX_STATE_ALLOCATOR(ins);
+    uint16_t num_entries = 0;
+
+    for (CanardRxState* state = ins->rx_states; (state != NULL) && (num_entries < max_entries);
+         state = canardRxFromIdx(rx_state_allocator, state->next))
+    {
+        uint16_t blocks = 1;
+        for (CanardBufferBlock* block = canardBufferFromIdx(allocator, state->buffer_blocks);
+             block != NULL;
+             block = block->next)
+        {
+            blocks++;
+        }
+        CanardPoolUsageEntry* const entry = &out_entries[num_entries++];
+        entry->data_type_id = DATA_TYPE_FROM_DESCRIPTOR(state->dtid_tt_snid_dnid);
+        entry->transfer_type = TRANSFER_TYPE_FROM_DESCRIPTOR(state->dtid_tt_snid_dnid);
+        entry->node_id = SOURCE_ID_FROM_DESCRIPTOR(state->dtid_tt_snid_dnid);
+        entry->tx = false;
+        entry->blocks = blocks;
+    }
+    const uint16_t first_tx_entry = num_entries;
+
+    for (const CanardTxQueueItem* item = ins->tx_queue; item != NULL; item = item->next)
+    {
+        const CanardTransferType transfer_type = extractTransferType(item->frame.id);
+        const uint16_t data_type_id = extractDataType(item->frame.id);
+        const uint8_t node_id = (transfer_type == CanardTransferTypeBroadcast) ?
+                                (uint8_t)CANARD_BROADCAST_NODE_ID : DEST_ID_FROM_ID(item->frame.id);
+
+        CanardPoolUsageEntry* entry = NULL;
+        for (uint16_t i = first_tx_entry; i < num_entries; i++)
+        {
+            if ((out_entries[i].data_type_id == data_type_id) &&
+                (out_entries[i].transfer_type == (uint8_t)transfer_type) &&
+                (out_entries[i].node_id == node_id))
+            {
+                entry = &out_entries[i];
+                break;
+            }
+        }
+        if (entry == NULL)
+        {
+            if (num_entries >= max_entries)
+            {
+                continue;
+            }
+            entry = &out_entries[num_entries++];
+            entry->data_type_id = data_type_id;
+            entry->transfer_type = (uint8_t)transfer_type;
+            entry->node_id = node_id;
+            entry->tx = true;
+            entry->blocks = 0;
+        }
+        entry->blocks++;
+    }
+
+    return num_entries;
+}
+
+int16_t canardMakeAcceptanceFilters(const CanardAcceptedTransfer* accepted,
+                                    uint16_t num_accepted,
+                                    uint8_t local_node_id,
+                                    CanardAcceptanceFilter* out_filters,
+                                    uint16_t max_filters)
+{
+    CANARD_ASSERT((accepted != NULL) || (num_accepted == 0));
+    CANARD_ASSERT((out_filters != NULL) || (max_filters == 0));
+
+    // Every filter rejects standard, remote and error frames
+    static const uint32_t FlagsMask = CANARD_CAN_FRAME_EFF | CANARD_CAN_FRAME_RTR | CANARD_CAN_FRAME_ERR;
+    uint16_t num_filters = 0;
+
+    for (uint16_t i = 0; i < num_accepted; i++)
+    {
+        const uint32_t dtid = accepted[i].data_type_id;
+        CanardAcceptanceFilter filter;
+        if (accepted[i].transfer_type == (uint8_t)CanardTransferTypeBroadcast)
+        {
+            filter.id = CANARD_CAN_FRAME_EFF | (dtid << 8U);
+            filter.mask = FlagsMask | (0xFFFFU << 8U) | (1U << 7U);
+            if (dtid < (1U << ANON_MSG_DATA_TYPE_ID_BIT_LEN))
+            {
+                // Anonymous transfers keep only the lowest bits of the data type ID, next to the discriminator
+                CanardAcceptanceFilter anonymous;
+                anonymous.id = CANARD_CAN_FRAME_EFF | (dtid << 8U) | CANARD_BROADCAST_NODE_ID;
+                anonymous.mask = FlagsMask | (((1U << ANON_MSG_DATA_TYPE_ID_BIT_LEN) - 1U) << 8U) | (1U << 7U) | 0x7FU;
+                if (max_filters == 0)
+                {
+                    return -CANARD_ERROR_INVALID_ARGUMENT;
+                }
+                addAcceptanceFilter(out_filters, &num_filters, max_filters, anonymous);
+            }
+        }
+        else
+        {
+            if (local_node_id == CANARD_BROADCAST_NODE_ID)
+            {
+                continue;
+            }
+            const uint32_t request = (accepted[i].transfer_type == (uint8_t)CanardTransferTypeRequest) ? 1U : 0U;
+            filter.id = CANARD_CAN_FRAME_EFF | ((dtid & 0xFFU) << 16U) | (request << 15U) |
+                        ((uint32_t)local_node_id << 8U) | (1U << 7U);
+            filter.mask = FlagsMask | (0xFFU << 16U) | (1U << 15U) | (0x7FU << 8U) | (1U << 7U);
+        }
+        if (max_filters == 0)
+        {
+            return -CANARD_ERROR_INVALID_ARGUMENT;
+        }
+        addAcceptanceFilter(out_filters, &num_filters, max_filters, filter);
+    }
+
+    return (int16_t)num_filters;
+}
+
 uint16_t canardConvertNativeFloatToFloat16(float value)
 {
     CANARD_ASSERT(sizeof(float) == CANARD_SIZEOF_FLOAT);
@@ -1104,6 +1364,111 @@ CANARD_INTERNAL int16_t computeTransferIDForwardDistance(uint8_t a, uint8_t b)
     return d;
 }
 
+CANARD_INTERNAL bool filterCovers(const CanardAcceptanceFilter* outer, const CanardAcceptanceFilter* inner)
+{
+    return ((outer->mask & ~inner->mask) == 0U) && (((outer->id ^ inner->id) & outer->mask) == 0U);
+}
+
+CANARD_INTERNAL CanardAcceptanceFilter mergeFilters(const CanardAcceptanceFilter* a, const CanardAcceptanceFilter* b)
+{
+    CanardAcceptanceFilter merged;
+    merged.mask = a->mask & b->mask & ~(a->id ^ b->id);
+    merged.id = a->id & merged.mask;
+    return merged;
+}
+
+CANARD_INTERNAL uint8_t countBits(uint32_t value)
+{
+    uint8_t count = 0;
+    for (; value != 0U; value &= value - 1U)
+    {
+        count++;
+    }
+    return count;
+}
+
+CANARD_INTERNAL void addAcceptanceFilter(CanardAcceptanceFilter* filters,
+                                         uint16_t* num_filters,
+                                         uint16_t max_filters,
+                                         CanardAcceptanceFilter filter)
+{
+    CANARD_ASSERT(max_filters > 0);
+    filter.id &= filter.mask;
+    for (;;)
+    {
+        // Drop what is already passed, and what the new filter passes anyway
+        uint16_t n = 0;
+        for (uint16_t i = 0; i < *num_filters; i++)
+        {
+            if (filterCovers(&filters[i], &filter))
+            {
+                return;
+            }
+            if (!filterCovers(&filter, &filters[i]))
+            {
+                filters[n++] = filters[i];
+            }
+        }
+        *num_filters = n;
+
+        // Two filters that differ in a single bit become one that ignores that bit, without passing anything more
+        bool combined = false;
+        for (uint16_t i = 0; i < *num_filters; i++)
+        {
+            if ((filters[i].mask == filter.mask) && (countBits(filters[i].id ^ filter.id) == 1U))
+            {
+                filter = mergeFilters(&filters[i], &filter);
+                filters[i] = filters[--(*num_filters)];
+                combined = true;
+                break;
+            }
+        }
+        if (combined)
+        {
+            continue;
+        }
+
+        if (*num_filters < max_filters)
+        {
+            filters[(*num_filters)++] = filter;
+            return;
+        }
+
+        // The set is full, so widen the pair that keeps the most mask bits; index num_filters is the new filter
+        uint16_t best_a = 0;
+        uint16_t best_b = *num_filters;
+        uint8_t best_bits = 0;
+        for (uint16_t a = 0; a < *num_filters; a++)
+        {
+            for (uint16_t b = (uint16_t)(a + 1U); b <= *num_filters; b++)
+            {
+                const CanardAcceptanceFilter* const other = (b < *num_filters) ? &filters[b] : &filter;
+                const CanardAcceptanceFilter merged = mergeFilters(&filters[a], other);
+                const uint8_t bits = countBits(merged.mask);
+                if (bits > best_bits)
+                {
+                    best_bits = bits;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+        if (best_b == *num_filters)
+        {
+            filter = mergeFilters(&filters[best_a], &filter);
+            filters[best_a] = filters[--(*num_filters)];
+        }
+        else
+        {
+            // Make room by merging two existing filters, the merged one goes through the loop again
+            const CanardAcceptanceFilter merged = mergeFilters(&filters[best_a], &filters[best_b]);
+            filters[best_b] = filters[--(*num_filters)];
+            filters[best_a] = filter;
+            filter = merged;
+        }
+    }
+}
+
 CANARD_INTERNAL void incrementTransferID(uint8_t* transfer_id)
 {
     CANARD_ASSERT(transfer_id != NULL);
@@ -1187,6 +1552,7 @@ CANARD_INTERNAL int16_t enqueueTxFrames(CanardInstance* ins,
         CanardTxQueueItem* queue_item = createTxItem(&ins->allocator);
         if (queue_item == NULL)
         {
+            notifyPoolOutOfMemory(ins, CanardPoolConsumerTx, extractDataType(can_id), extractTransferType(can_id));
             return -CANARD_ERROR_OUT_OF_MEMORY;
         }
 
@@ -1223,8 +1589,9 @@ CANARD_INTERNAL int16_t enqueueTxFrames(CanardInstance* ins,
         const uint16_t total_bytes = transfer->payload_len + 2; // including CRC
         const uint8_t bytes_per_frame = frame_max_data_len-1; // sot/eot byte consumes one byte
         const uint16_t frames_needed = (total_bytes + (bytes_per_frame-1)) / bytes_per_frame;
-        const uint16_t blocks_available = ins->allocator.statistics.capacity_blocks - ins->allocator.statistics.current_usage_blocks;
+        const uint16_t blocks_available = availableBlocks(&ins->allocator, CanardPoolConsumerTx);
         if (blocks_available < frames_needed) {
+            notifyPoolOutOfMemory(ins, CanardPoolConsumerTx, extractDataType(can_id), extractTransferType(can_id));
             return -CANARD_ERROR_OUT_OF_MEMORY;
         }
 
@@ -1280,9 +1647,40 @@ CANARD_INTERNAL int16_t enqueueTxFrames(CanardInstance* ins,
         }
     }
 
+    checkPoolLowWatermark(ins);
     return result;
 }
 
+CANARD_INTERNAL void checkPoolLowWatermark(CanardInstance* ins)
+{
+    const uint16_t free_blocks =
+        (uint16_t)(ins->allocator.statistics.capacity_blocks - ins->allocator.statistics.current_usage_blocks);
+
+    if (free_blocks > ins->pool_low_watermark_blocks)
+    {
+        ins->pool_below_watermark = false;
+    }
+    else if (!ins->pool_below_watermark)
+    {
+        ins->pool_below_watermark = true;
+        if (ins->on_pool_low_watermark != NULL)
+        {
+            ins->on_pool_low_watermark(ins, free_blocks);
+        }
+    }
+}
+
+CANARD_INTERNAL void notifyPoolOutOfMemory(CanardInstance* ins,
+                                           CanardPoolConsumer consumer,
+                                           uint16_t data_type_id,
+                                           CanardTransferType transfer_type)
+{
+    if (ins->on_pool_out_of_memory != NULL)
+    {
+        ins->on_pool_out_of_memory(ins, consumer, data_type_id, transfer_type);
+    }
+}
+
 /**
  * Puts frame on on the TX queue. Higher priority placed first
  */
@@ -1337,7 +1735,7 @@ CANARD_INTERNAL void pushTxQueue(CanardInstance* ins, CanardTxQueueItem* item)
  */
 CANARD_INTERNAL CanardTxQueueItem* createTxItem(CanardPoolAllocator* allocator)
 {
-    CanardTxQueueItem* item = (CanardTxQueueItem*) allocateBlock(allocator);
+    CanardTxQueueItem* item = (CanardTxQueueItem*) allocateBlock(allocator, CanardPoolConsumerTx);
     if (item == NULL)
     {
         return NULL;
@@ -1454,7 +1852,7 @@ CANARD_INTERNAL CanardRxState* traverseRxStates(CanardInstance* ins, uint32_t tr
 
     if (states == NULL) // initialize CanardRxStates
     {
-        states = createRxState(&ins->allocator, transfer_descriptor);
+        states = createRxState(RX_STATE_ALLOCATOR(ins), transfer_descriptor);
 
         if(states == NULL)
         {
@@ -1488,7 +1886,7 @@ CANARD_INTERNAL CanardRxState* findRxState(CanardInstance *ins, uint32_t transfe
         {
             return state;
         }
-        state = canardRxFromIdx(&ins->allocator, state->next);
+        state = canardRxFromIdx(RX_STATE_ALLOCATOR(ins), state->next);
     }
     return NULL;
 }
@@ -1498,14 +1896,14 @@ CANARD_INTERNAL CanardRxState* findRxState(CanardInstance *ins, uint32_t transfe
  */
 CANARD_INTERNAL CanardRxState* prependRxState(CanardInstance* ins, uint32_t transfer_descriptor)
 {
-    CanardRxState* state = createRxState(&ins->allocator, transfer_descriptor);
+    CanardRxState* state = createRxState(RX_STATE_ALLOCATOR(ins), transfer_descriptor);
 
     if(state == NULL)
     {
         return NULL;
     }
 
-    state->next = canardRxToIdx(&ins->allocator, ins->rx_states);
+    state->next = canardRxToIdx(RX_STATE_ALLOCATOR(ins), ins->rx_states);
     ins->rx_states = state;
     return state;
 }
@@ -1518,7 +1916,7 @@ CANARD_INTERNAL CanardRxState* createRxState(CanardPoolAllocator* allocator, uin
         .dtid_tt_snid_dnid = transfer_descriptor
     };
 
-    CanardRxState* state = (CanardRxState*) allocateBlock(allocator);
+    CanardRxState* state = (CanardRxState*) allocateBlock(allocator, CanardPoolConsumerRxState);
     if (state == NULL)
     {
         return NULL;
@@ -1534,13 +1932,30 @@ CANARD_INTERNAL uint64_t releaseStatePayload(CanardInstance* ins, CanardRxState*
     {
         CanardBufferBlock* block = canardBufferFromIdx(&ins->allocator, rxstate->buffer_blocks);
         CanardBufferBlock* const temp = block->next;
-        freeBlock(&ins->allocator, block);
+        freeBlock(&ins->allocator, CanardPoolConsumerRxPayload, block);
         rxstate->buffer_blocks = canardBufferToIdx(&ins->allocator, temp);
     }
     rxstate->payload_len = 0;
     return CANARD_OK;
 }
 
+CANARD_INTERNAL CanardRxState* removeRxState(CanardInstance* ins, CanardRxState* prev, CanardRxState* state)
+{
+    CanardRxState* const next = canardRxFromIdx(RX_STATE_ALLOCATOR(ins), state->next);
+    releaseStatePayload(ins, state);
+    if (prev == NULL)
+    {
+        CANARD_ASSERT(ins->rx_states == state);
+        ins->rx_states = next;
+    }
+    else
+    {
+        prev->next = state->next;
+    }
+    freeBlock(RX_STATE_ALLOCATOR(ins), CanardPoolConsumerRxState, state);
+    return next;
+}
+
 /*
  *  CanardBufferBlock functions
  */
@@ -1646,7 +2061,7 @@ CANARD_INTERNAL int16_t bufferBlockPushBytes(CanardPoolAllocator* allocator,
 
 CANARD_INTERNAL CanardBufferBlock* createBufferBlock(CanardPoolAllocator* allocator)
 {
-    CanardBufferBlock* block = (CanardBufferBlock*) allocateBlock(allocator);
+    CanardBufferBlock* block = (CanardBufferBlock*) allocateBlock(allocator, CanardPoolConsumerRxPayload);
     if (block == NULL)
     {
         return NULL;
@@ -1888,6 +2303,11 @@ CANARD_INTERNAL uint16_t crcAdd(uint16_t crc_val, const uint8_t* bytes, size_t l
 /*
  *  Pool Allocator functions
  */
+#if CANARD_ALLOCATE_LOCKFREE
+#define FREE_HEAD_INDEX_MASK                        0xFFFFU
+#define FREE_HEAD_TAG_INCREMENT                     0x10000U
+#endif
+
 CANARD_INTERNAL void initPoolAllocator(CanardPoolAllocator* allocator,
                                        void* buf,
                                        uint16_t buf_len)
@@ -1895,6 +2315,16 @@ CANARD_INTERNAL void initPoolAllocator(CanardPoolAllocator* allocator,
     size_t current_index = 0;
     CanardPoolAllocatorBlock *abuf = buf;
     allocator->arena = buf;
+#if CANARD_ALLOCATE_LOCKFREE
+    while (current_index < buf_len)
+    {
+        // Blocks are linked by index; the last block gets 0, which terminates the list
+        abuf[current_index].next_index = (uint16_t)((current_index + 2U < (size_t)buf_len + 1U) ?
+                                                    (current_index + 2U) : 0U);
+        current_index++;
+    }
+    allocator->free_head = (buf_len > 0) ? 1U : 0U;
+#else
     CanardPoolAllocatorBlock** current_block = &(allocator->free_list);
     while (current_index < buf_len)
     {
@@ -1903,23 +2333,182 @@ CANARD_INTERNAL void initPoolAllocator(CanardPoolAllocator* allocator,
         current_index++;
     }
     *current_block = NULL;
+#endif
 
     allocator->statistics.capacity_blocks = buf_len;
     allocator->statistics.current_usage_blocks = 0;
     allocator->statistics.peak_usage_blocks = 0;
+    for (uint8_t i = 0; i < CANARD_POOL_NUM_CONSUMERS; i++)
+    {
+        allocator->consumers[i].current_usage_blocks = 0;
+        allocator->consumers[i].peak_usage_blocks = 0;
+        allocator->consumers[i].reserved_blocks = 0;
+        allocator->consumers[i].max_blocks = buf_len;
+        allocator->consumers[i].denied_allocations = 0;
+    }
     // user should initialize semaphore after the canardInit
     // or at first call of canard_allocate_sem_take
     allocator->semaphore = NULL;
 }
 
-CANARD_INTERNAL void* allocateBlock(CanardPoolAllocator* allocator)
+CANARD_INTERNAL void resetPoolAllocator(CanardPoolAllocator* allocator)
+{
+    void* const semaphore = allocator->semaphore;
+    const uint16_t peak_usage_blocks = allocator->statistics.peak_usage_blocks;
+    CanardPoolConsumerStatistics consumers[CANARD_POOL_NUM_CONSUMERS];
+    memcpy(consumers, allocator->consumers, sizeof(consumers));
+
+    initPoolAllocator(allocator, allocator->arena, allocator->statistics.capacity_blocks);
+
+    allocator->semaphore = semaphore;
+    allocator->statistics.peak_usage_blocks = peak_usage_blocks;
+    for (uint8_t i = 0; i < CANARD_POOL_NUM_CONSUMERS; i++)
+    {
+        allocator->consumers[i].peak_usage_blocks = consumers[i].peak_usage_blocks;
+        allocator->consumers[i].reserved_blocks = consumers[i].reserved_blocks;
+        allocator->consumers[i].max_blocks = consumers[i].max_blocks;
+        allocator->consumers[i].denied_allocations = consumers[i].denied_allocations;
+    }
+}
+
+CANARD_INTERNAL uint32_t reservedForOtherConsumers(const CanardPoolAllocator* allocator, CanardPoolConsumer consumer)
+{
+    // Blocks that other consumers are entitled to but have not taken yet
+    uint32_t reserved_for_others = 0;
+    for (uint8_t i = 0; i < CANARD_POOL_NUM_CONSUMERS; i++)
+    {
+        const CanardPoolConsumerStatistics* const other = &allocator->consumers[i];
+#if CANARD_ALLOCATE_LOCKFREE
+        const uint16_t other_usage = __atomic_load_n(&other->current_usage_blocks, __ATOMIC_ACQUIRE);
+#else
+        const uint16_t other_usage = other->current_usage_blocks;
+#endif
+        if ((i != (uint8_t)consumer) && (other_usage < other->reserved_blocks))
+        {
+            reserved_for_others += (uint32_t)(other->reserved_blocks - other_usage);
+        }
+    }
+    return reserved_for_others;
+}
+
+CANARD_INTERNAL uint16_t availableBlocks(const CanardPoolAllocator* allocator, CanardPoolConsumer consumer)
+{
+    const CanardPoolConsumerStatistics* const own = &allocator->consumers[consumer];
+#if CANARD_ALLOCATE_LOCKFREE
+    const uint16_t usage = __atomic_load_n(&allocator->statistics.current_usage_blocks, __ATOMIC_ACQUIRE);
+    const uint16_t own_usage = __atomic_load_n(&own->current_usage_blocks, __ATOMIC_ACQUIRE);
+#else
+    const uint16_t usage = allocator->statistics.current_usage_blocks;
+    const uint16_t own_usage = own->current_usage_blocks;
+#endif
+
+    const uint32_t reserved_for_others = reservedForOtherConsumers(allocator, consumer);
+    const uint32_t free_blocks = (uint32_t)(allocator->statistics.capacity_blocks - usage);
+    const uint32_t pool_left = (free_blocks > reserved_for_others) ? (free_blocks - reserved_for_others) : 0U;
+    const uint32_t quota_left = (own->max_blocks > own_usage) ? (uint32_t)(own->max_blocks - own_usage) : 0U;
+
+    return (uint16_t)MIN(pool_left, quota_left);
+}
+
+#if CANARD_ALLOCATE_LOCKFREE
+
+CANARD_INTERNAL void updatePeakUsage(uint16_t* peak_usage_blocks, uint16_t usage_blocks)
+{
+    uint16_t peak = __atomic_load_n(peak_usage_blocks, __ATOMIC_RELAXED);
+    while ((peak < usage_blocks) &&
+           !__atomic_compare_exchange_n(peak_usage_blocks, &peak, usage_blocks, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        // peak has been reloaded by the failed exchange
+    }
+}
+
+CANARD_INTERNAL void* allocateBlock(CanardPoolAllocator* allocator, CanardPoolConsumer consumer)
 {
+    CANARD_ASSERT((uint32_t)consumer < CANARD_POOL_NUM_CONSUMERS);
+    CanardPoolConsumerStatistics* const stats = &allocator->consumers[consumer];
+
+    /*
+     * Claim the block in the usage counters before touching the free list. A free block is pushed back to the
+     * list before the counters are decremented, so as long as the counters do not exceed the capacity there is
+     * guaranteed to be a block in the list for every successful claim.
+     */
+    const uint16_t own_usage = __atomic_add_fetch(&stats->current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+    const uint16_t usage = __atomic_add_fetch(&allocator->statistics.current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+
+    if ((own_usage > stats->max_blocks) ||
+        ((uint32_t)usage + reservedForOtherConsumers(allocator, consumer) > allocator->statistics.capacity_blocks))
+    {
+        (void)__atomic_sub_fetch(&allocator->statistics.current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+        (void)__atomic_sub_fetch(&stats->current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+        (void)__atomic_add_fetch(&stats->denied_allocations, 1U, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    CanardPoolAllocatorBlock* const blocks = (CanardPoolAllocatorBlock*) allocator->arena;
+    CanardPoolAllocatorBlock* result = NULL;
+    uint32_t head = __atomic_load_n(&allocator->free_head, __ATOMIC_ACQUIRE);
+    uint32_t new_head = 0;
+    do
+    {
+        const uint32_t index = head & FREE_HEAD_INDEX_MASK;
+        CANARD_ASSERT(index != 0);
+        if (index == 0)
+        {
+            (void)__atomic_sub_fetch(&allocator->statistics.current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+            (void)__atomic_sub_fetch(&stats->current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+            (void)__atomic_add_fetch(&stats->denied_allocations, 1U, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        result = &blocks[index - 1U];
+        // The block may be taken concurrently, in which case the value read here is stale, but then the tag
+        // has changed as well and the exchange below fails.
+        const uint32_t next = __atomic_load_n(&result->next_index, __ATOMIC_RELAXED);
+        new_head = ((head & ~(uint32_t)FREE_HEAD_INDEX_MASK) + FREE_HEAD_TAG_INCREMENT) | next;
+    }
+    while (!__atomic_compare_exchange_n(&allocator->free_head, &head, new_head, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    updatePeakUsage(&allocator->statistics.peak_usage_blocks, usage);
+    updatePeakUsage(&stats->peak_usage_blocks, own_usage);
+    return result;
+}
+
+CANARD_INTERNAL void freeBlock(CanardPoolAllocator* allocator, CanardPoolConsumer consumer, void* p)
+{
+    CANARD_ASSERT((uint32_t)consumer < CANARD_POOL_NUM_CONSUMERS);
+    CanardPoolAllocatorBlock* const block = (CanardPoolAllocatorBlock*) p;
+    const uint32_t index = (uint32_t)(block - (CanardPoolAllocatorBlock*) allocator->arena) + 1U;
+    CANARD_ASSERT(index <= allocator->statistics.capacity_blocks);
+
+    uint32_t head = __atomic_load_n(&allocator->free_head, __ATOMIC_ACQUIRE);
+    uint32_t new_head = 0;
+    do
+    {
+        __atomic_store_n(&block->next_index, (uint16_t)(head & FREE_HEAD_INDEX_MASK), __ATOMIC_RELAXED);
+        new_head = ((head & ~(uint32_t)FREE_HEAD_INDEX_MASK) + FREE_HEAD_TAG_INCREMENT) | index;
+    }
+    while (!__atomic_compare_exchange_n(&allocator->free_head, &head, new_head, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    CANARD_ASSERT(allocator->consumers[consumer].current_usage_blocks > 0);
+    (void)__atomic_sub_fetch(&allocator->consumers[consumer].current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+    CANARD_ASSERT(allocator->statistics.current_usage_blocks > 0);
+    (void)__atomic_sub_fetch(&allocator->statistics.current_usage_blocks, 1U, __ATOMIC_ACQ_REL);
+}
+
+#else
+
+CANARD_INTERNAL void* allocateBlock(CanardPoolAllocator* allocator, CanardPoolConsumer consumer)
+{
+    CANARD_ASSERT((uint32_t)consumer < CANARD_POOL_NUM_CONSUMERS);
 #if CANARD_ALLOCATE_SEM
     canard_allocate_sem_take(allocator);
 #endif
-    // Check if there are any blocks available in the free list.
-    if (allocator->free_list == NULL)
+    // Check if there are any blocks available in the free list, and whether the consumer may take one.
+    if (allocator->free_list == NULL || availableBlocks(allocator, consumer) == 0)
     {
+        allocator->consumers[consumer].denied_allocations++;
 #if CANARD_ALLOCATE_SEM
         canard_allocate_sem_give(allocator);
 #endif
@@ -1936,14 +2525,21 @@ CANARD_INTERNAL void* allocateBlock(CanardPoolAllocator* allocator)
     {
         allocator->statistics.peak_usage_blocks = allocator->statistics.current_usage_blocks;
     }
+    CanardPoolConsumerStatistics* const stats = &allocator->consumers[consumer];
+    stats->current_usage_blocks++;
+    if (stats->peak_usage_blocks < stats->current_usage_blocks)
+    {
+        stats->peak_usage_blocks = stats->current_usage_blocks;
+    }
 #if CANARD_ALLOCATE_SEM
     canard_allocate_sem_give(allocator);
 #endif
     return result;
 }
 
-CANARD_INTERNAL void freeBlock(CanardPoolAllocator* allocator, void* p)
+CANARD_INTERNAL void freeBlock(CanardPoolAllocator* allocator, CanardPoolConsumer consumer, void* p)
 {
+    CANARD_ASSERT((uint32_t)consumer < CANARD_POOL_NUM_CONSUMERS);
 #if CANARD_ALLOCATE_SEM
     canard_allocate_sem_take(allocator);
 #endif
@@ -1954,7 +2550,11 @@ CANARD_INTERNAL void freeBlock(CanardPoolAllocator* allocator, void* p)
 
     CANARD_ASSERT(allocator->statistics.current_usage_blocks > 0);
     allocator->statistics.current_usage_blocks--;
+    CANARD_ASSERT(allocator->consumers[consumer].current_usage_blocks > 0);
+    allocator->consumers[consumer].current_usage_blocks--;
 #if CANARD_ALLOCATE_SEM
     canard_allocate_sem_give(allocator);
 #endif
 }
+
+#endif // CANARD_ALLOCATE_LOCKFREE
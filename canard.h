@@ -92,6 +92,24 @@ extern "C" {
 #ifndef CANARD_ALLOCATE_SEM
 #define CANARD_ALLOCATE_SEM 0
 #endif
+
+/// When enabled, the pool allocator uses a lock-free free list (GCC/Clang atomic builtins), so blocks can be
+/// allocated and freed concurrently, e.g. from a CAN RX interrupt and the main thread, without a semaphore.
+#ifndef CANARD_ALLOCATE_LOCKFREE
+#define CANARD_ALLOCATE_LOCKFREE 0
+#endif
+
+/// When non-zero, this many blocks at the start of the memory arena are set aside as a dense array that holds only
+/// RX transfer states, while payload blocks and TX items come from the rest of the arena. Walking the RX sessions
+/// then touches a small contiguous region instead of cache lines scattered across the whole arena.
+#ifndef CANARD_RX_STATE_ARRAY_SIZE
+#define CANARD_RX_STATE_ARRAY_SIZE 0
+#endif
+
+#if CANARD_ALLOCATE_SEM && CANARD_ALLOCATE_LOCKFREE
+#error "CANARD_ALLOCATE_SEM and CANARD_ALLOCATE_LOCKFREE are mutually exclusive"
+#endif
+
 /// Error code definitions; inverse of these values may be returned from API calls.
 #define CANARD_OK                                      0
 // Value 1 is omitted intentionally, since -1 is often used in 3rd party code
@@ -309,6 +327,9 @@ typedef union CanardPoolAllocatorBlock_u
 {
     char bytes[CANARD_MEM_BLOCK_SIZE];
     union CanardPoolAllocatorBlock_u* next;
+#if CANARD_ALLOCATE_LOCKFREE
+    uint16_t next_index;                    ///< Index of the next free block plus one, zero if none
+#endif
 } CanardPoolAllocatorBlock;
 
 /**
@@ -322,6 +343,83 @@ typedef struct
     uint16_t peak_usage_blocks;             ///< Maximum number of blocks used since initialization
 } CanardPoolAllocatorStatistics;
 
+/**
+ * Consumers of the memory pool. Every block taken from the pool is accounted to exactly one of these, which
+ * allows the application to cap or reserve pool capacity per consumer. Refer to canardSetPoolQuota().
+ */
+typedef enum
+{
+    CanardPoolConsumerRxState   = 0,        ///< RX transfer states (one block per tracked session)
+    CanardPoolConsumerRxPayload = 1,        ///< Buffer blocks holding multi-frame RX payload
+    CanardPoolConsumerTx        = 2         ///< TX queue items
+} CanardPoolConsumer;
+
+#define CANARD_POOL_NUM_CONSUMERS                   3U
+
+/**
+ * Per-consumer usage statistics and limits of the memory pool allocator.
+ */
+typedef struct
+{
+    uint16_t current_usage_blocks;          ///< Number of blocks that are currently held by this consumer
+    uint16_t peak_usage_blocks;             ///< Maximum number of blocks held by this consumer since initialization
+    uint16_t reserved_blocks;               ///< Number of blocks other consumers are not allowed to take
+    uint16_t max_blocks;                    ///< Maximum number of blocks this consumer is allowed to hold
+    uint32_t denied_allocations;            ///< Number of allocations refused due to the quota or exhausted pool
+} CanardPoolConsumerStatistics;
+
+/**
+ * This function will be invoked by the library when the number of free pool blocks drops to or below the low
+ * watermark configured with canardSetPoolHooks(). It is invoked once per crossing; it will be invoked again only
+ * after the number of free blocks has risen above the watermark.
+ * The callback is invoked from within canardHandleRxFrame() or the transmission functions, so it must not call
+ * any other library functions; it is meant to record the event so that the application can shed load later.
+ */
+typedef void (* CanardOnPoolLowWatermark)(CanardInstance* ins,                  ///< Library instance
+                                          uint16_t free_blocks);                ///< Number of free pool blocks
+
+/**
+ * This function will be invoked by the library every time a transfer is dropped because the memory pool could not
+ * provide a block. The same restrictions apply as for CanardOnPoolLowWatermark.
+ */
+typedef void (* CanardOnPoolOutOfMemory)(CanardInstance* ins,                   ///< Library instance
+                                         CanardPoolConsumer consumer,           ///< Consumer that was refused
+                                         uint16_t data_type_id,                 ///< Data type of the dropped transfer
+                                         CanardTransferType transfer_type);     ///< Refer to CanardTransferType
+
+/**
+ * One entry of the pool usage breakdown returned by canardGetPoolUsageBreakdown().
+ */
+typedef struct
+{
+    uint16_t data_type_id;                  ///< Data type ID of the session
+    uint8_t transfer_type;                  ///< See CanardTransferType
+    uint8_t node_id;                        ///< Source node ID of RX sessions; destination node ID of TX frames,
+                                            ///< or zero for broadcasts
+    bool tx;                                ///< True if the blocks are TX queue items, false for an RX session
+    uint16_t blocks;                        ///< Number of pool blocks held, including the RX state itself
+} CanardPoolUsageEntry;
+
+/**
+ * A kind of transfer the node wants to receive, input of canardMakeAcceptanceFilters().
+ */
+typedef struct
+{
+    uint16_t data_type_id;
+    uint8_t transfer_type;                  ///< See CanardTransferType
+} CanardAcceptedTransfer;
+
+/**
+ * CAN acceptance filter; a frame passes if (frame ID & mask) == (id & mask).
+ * The ID and mask include the flags CANARD_CAN_FRAME_EFF, CANARD_CAN_FRAME_RTR and CANARD_CAN_FRAME_ERR, which have
+ * the same values as their SocketCAN counterparts.
+ */
+typedef struct
+{
+    uint32_t id;
+    uint32_t mask;
+} CanardAcceptanceFilter;
+
 /**
  * INTERNAL DEFINITION, DO NOT USE DIRECTLY.
  * Buffer block for received data.
@@ -340,8 +438,15 @@ typedef struct
     // user should initialize semaphore after the canardInit
     // or at first call of canard_allocate_sem_take
     void *semaphore;
+#if CANARD_ALLOCATE_LOCKFREE
+    // Index of the first free block plus one in the lower 16 bits, modification counter in the upper
+    // 16 bits. The counter changes on every update, which protects the compare-and-swap against ABA.
+    uint32_t free_head;
+#else
     CanardPoolAllocatorBlock* free_list;
+#endif
     CanardPoolAllocatorStatistics statistics;
+    CanardPoolConsumerStatistics consumers[CANARD_POOL_NUM_CONSUMERS];
     void *arena;
 } CanardPoolAllocator;
 
@@ -383,12 +488,20 @@ struct CanardInstance
     CanardOnTransferReception on_reception;         ///< Function the library calls after RX transfer is complete
 
     CanardPoolAllocator allocator;                  ///< Pool allocator
+#if CANARD_RX_STATE_ARRAY_SIZE > 0
+    CanardPoolAllocator rx_state_allocator;         ///< Dense pool that holds the RX transfer states only
+#endif
 
     CanardRxState* rx_states;                       ///< RX transfer states
     CanardTxQueueItem* tx_queue;                    ///< TX frames awaiting transmission
 
     void* user_reference;                           ///< User pointer that can link this instance with other objects
 
+    CanardOnPoolLowWatermark on_pool_low_watermark; ///< Optional, see canardSetPoolHooks()
+    CanardOnPoolOutOfMemory on_pool_out_of_memory;  ///< Optional, see canardSetPoolHooks()
+    uint16_t pool_low_watermark_blocks;             ///< Free block count at which on_pool_low_watermark is invoked
+    bool pool_below_watermark;                      ///< True if the low watermark has been reported and not cleared
+
 #if CANARD_ENABLE_TAO_OPTION
     bool tao_disabled;                              ///< True if TAO is disabled
 #endif
@@ -624,6 +737,34 @@ int16_t canardHandleRxFrame(CanardInstance* ins,
 void canardCleanupStaleTransfers(CanardInstance* ins,
                                  uint64_t current_time_usec);
 
+/**
+ * Flags for canardReset().
+ */
+#define CANARD_RESET_RX_STATES                      (1U << 0U)  ///< Drop all RX sessions and their payload
+#define CANARD_RESET_TX_QUEUE                       (1U << 1U)  ///< Drop all frames awaiting transmission
+
+/**
+ * Drops RX sessions and/or TX frames as selected by 'flags' (see CANARD_RESET_*).
+ *
+ * When everything held in the pool is being dropped, the pool is reinitialized in one pass over the arena instead
+ * of releasing the blocks one by one, which also restores the original order of the free list. Pool quotas and
+ * peak usage statistics are preserved. Useful e.g. after the node ID has been changed with
+ * canardForgetLocalNodeID(), when all prior sessions become garbage.
+ *
+ * Must not be called from within the library callbacks or concurrently with any other library function.
+ */
+void canardReset(CanardInstance* ins,
+                 uint8_t flags);
+
+/**
+ * Drops all RX sessions from the given source node together with their payload. This is useful when a node is
+ * known to have left the bus, so that its sessions do not occupy the pool until they time out.
+ * Pass CANARD_BROADCAST_NODE_ID to drop the sessions of anonymous transfers.
+ * Returns the number of sessions dropped.
+ */
+uint16_t canardPurgeRxStatesFromNode(CanardInstance* ins,
+                                     uint8_t source_node_id);
+
 /**
  * This function can be used to extract values from received UAVCAN transfers. It decodes a scalar value -
  * boolean, integer, character, or floating point - from the specified bit position in the RX transfer buffer.
@@ -700,9 +841,84 @@ void canardReleaseRxTransferPayload(CanardInstance* ins,
  * Returns a copy of the pool allocator usage statistics.
  * Refer to the type CanardPoolAllocatorStatistics.
  * Use this function to determine worst case memory needs of your application.
+ * If CANARD_RX_STATE_ARRAY_SIZE is set, the RX state array is not included; refer to
+ * canardGetPoolConsumerStatistics() for its usage.
  */
 CanardPoolAllocatorStatistics canardGetPoolAllocatorStatistics(CanardInstance* ins);
 
+/**
+ * Configures the memory pool limits of a single consumer (RX states, RX payload or TX queue).
+ *
+ * 'reserved_blocks' is the number of blocks that are kept available for this consumer; other consumers will be
+ * refused allocations that would eat into the reservation. 'max_blocks' is the maximum number of blocks the consumer
+ * may hold at any time. For example, reserving blocks for CanardPoolConsumerTx guarantees that a flood of multi-frame
+ * RX transfers cannot prevent the node from transmitting.
+ *
+ * By default nothing is reserved and every consumer may use the whole pool. The limits only affect future
+ * allocations; blocks that are already held are not released.
+ *
+ * Returns CANARD_OK, or -CANARD_ERROR_INVALID_ARGUMENT if the consumer is unknown, if 'reserved_blocks' exceeds
+ * 'max_blocks', or if the sum of all reservations would exceed the pool capacity.
+ */
+int16_t canardSetPoolQuota(CanardInstance* ins,
+                           CanardPoolConsumer consumer,
+                           uint16_t reserved_blocks,
+                           uint16_t max_blocks);
+
+/**
+ * Returns a copy of the usage statistics and limits of a single pool consumer.
+ * Refer to the type CanardPoolConsumerStatistics.
+ * If CANARD_RX_STATE_ARRAY_SIZE is set, the statistics of CanardPoolConsumerRxState refer to the RX state array.
+ */
+CanardPoolConsumerStatistics canardGetPoolConsumerStatistics(const CanardInstance* ins,
+                                                             CanardPoolConsumer consumer);
+
+/**
+ * Installs the memory pool diagnostic hooks. Either callback can be NULL.
+ * 'on_low_watermark' is invoked when the number of free pool blocks drops to 'low_watermark_blocks' or below,
+ * which allows the application to shed low-priority load before the pool runs dry.
+ * 'on_out_of_memory' is invoked whenever a transfer is dropped because of pool exhaustion or a pool quota.
+ */
+void canardSetPoolHooks(CanardInstance* ins,
+                        uint16_t low_watermark_blocks,
+                        CanardOnPoolLowWatermark on_low_watermark,
+                        CanardOnPoolOutOfMemory on_out_of_memory);
+
+/**
+ * Walks the RX states and the TX queue and reports how many pool blocks are held by each of them.
+ * Every RX session (data type, transfer type and source node) produces one entry; TX frames are aggregated per
+ * data type, transfer type and destination node.
+ *
+ * At most 'max_entries' entries are written; if the array is too small, the remaining sessions are not reported,
+ * which can be detected by comparing the sum of the blocks against canardGetPoolAllocatorStatistics().
+ *
+ * Returns the number of entries written.
+ */
+uint16_t canardGetPoolUsageBreakdown(const CanardInstance* ins,
+                                     CanardPoolUsageEntry* out_entries,
+                                     uint16_t max_entries);
+
+/**
+ * Computes a small set of acceptance filters that pass the frames of the given transfers, so that the CAN
+ * controller or the kernel can drop the rest of the bus traffic before it reaches canardHandleRxFrame().
+ * Service transfers pass only if they are addressed to 'local_node_id'; they are left out while the node ID is not
+ * set, since an anonymous node can't receive them. Messages with a data type ID that fits into an anonymous
+ * transfer also pass when they are sent anonymously. The filters have to be made again when the local node ID
+ * changes, e.g. after dynamic node ID allocation.
+ *
+ * Filters that differ in a single bit are combined without passing anything more. If the result still doesn't fit
+ * into 'max_filters', the most similar filters are widened into one, which lets some unwanted frames through;
+ * those are rejected by the should_accept callback as usual.
+ *
+ * Returns the number of filters written, or -CANARD_ERROR_INVALID_ARGUMENT if 'max_filters' is zero while some
+ * transfer needs a filter.
+ */
+int16_t canardMakeAcceptanceFilters(const CanardAcceptedTransfer* accepted,
+                                    uint16_t num_accepted,
+                                    uint8_t local_node_id,
+                                    CanardAcceptanceFilter* out_filters,
+                                    uint16_t max_filters);
+
 /**
  * Float16 marshaling helpers.
  * These functions convert between the native float and 16-bit float.
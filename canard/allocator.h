@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2022 Siddharth B Purohit, CubePilot Pty Ltd
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#ifndef WITH_SEMAPHORE
+#include <atomic>
+#endif
+
+/*
+  the number of blocks of the statically allocated pool that
+  Canard::allocate() takes objects from before it falls back to
+  CANARD_MALLOC. Set to 0 to only use arenas added at runtime
+ */
+#ifndef CANARD_CXX_POOL_BLOCKS
+#define CANARD_CXX_POOL_BLOCKS 16U
+#endif
+
+/*
+  the size of a pool block, objects that are larger always come from
+  the heap
+ */
+#ifndef CANARD_CXX_POOL_BLOCK_SIZE
+#define CANARD_CXX_POOL_BLOCK_SIZE (16U * sizeof(void*))
+#endif
+
+/*
+  when disabled, Canard::allocate() fails once the pool is exhausted
+  instead of using CANARD_MALLOC
+ */
+#ifndef CANARD_CXX_POOL_HEAP_FALLBACK
+#define CANARD_CXX_POOL_HEAP_FALLBACK 1
+#endif
+
+/*
+  the number of arenas the pool can take blocks from, including the
+  static one
+ */
+#ifndef CANARD_CXX_POOL_MAX_ARENAS
+#define CANARD_CXX_POOL_MAX_ARENAS 4U
+#endif
+
+namespace Canard {
+
+/// @brief allocator of fixed size blocks carved from one or more arenas
+/// @note the default pool is shared by all interfaces, which may be served from different threads. Without
+/// WITH_SEMAPHORE it is guarded by a spin lock, so it must not be used from an interrupt handler
+class BlockAllocator {
+public:
+    /// @brief usage of the pool and of the heap fallback, in blocks and allocations
+    struct Statistics {
+        uint32_t capacity_blocks;        ///< blocks in all arenas
+        uint32_t used_blocks;            ///< blocks currently allocated
+        uint32_t peak_used_blocks;       ///< highest number of blocks allocated at once
+        uint32_t heap_allocations;       ///< objects currently allocated from the heap
+        uint32_t total_heap_allocations; ///< objects ever allocated from the heap
+        uint32_t failed_allocations;     ///< allocations that neither the pool nor the heap could serve
+    };
+
+    /// @brief size of a block, the configured size rounded up to the maximum alignment
+    static constexpr size_t BLOCK_SIZE = (CANARD_CXX_POOL_BLOCK_SIZE + alignof(max_align_t) - 1U) / alignof(max_align_t) * alignof(max_align_t);
+
+    BlockAllocator() {}
+
+    // delete copy constructor and assignment operator
+    BlockAllocator(const BlockAllocator&) = delete;
+    BlockAllocator& operator=(const BlockAllocator&) = delete;
+
+    /// @brief add memory to take blocks from
+    /// @param mem start of the arena, it is aligned up internally
+    /// @param size size of the arena in bytes
+    /// @return number of blocks added, 0 if the arena is too small or there are too many arenas
+    uint32_t add_arena(void* mem, size_t size) {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        if (mem == nullptr || num_arenas >= CANARD_CXX_POOL_MAX_ARENAS) {
+            return 0;
+        }
+        const uintptr_t start = ((uintptr_t)mem + alignof(max_align_t) - 1U) & ~(uintptr_t)(alignof(max_align_t) - 1U);
+        const size_t skipped = (size_t)(start - (uintptr_t)mem);
+        if (size < skipped + BLOCK_SIZE) {
+            return 0;
+        }
+        const uint32_t num_blocks = (uint32_t)((size - skipped) / BLOCK_SIZE);
+        Arena &arena = arenas[num_arenas++];
+        arena.start = start;
+        arena.end = start + num_blocks * BLOCK_SIZE;
+        arena.num_blocks = num_blocks;
+        for (uint32_t i = num_blocks; i > 0; i--) {
+            FreeBlock* block = (FreeBlock*)(start + (i - 1U) * BLOCK_SIZE);
+            block->next = free_list;
+            free_list = block;
+        }
+        stats.capacity_blocks += num_blocks;
+        return num_blocks;
+    }
+
+    /// @brief remove an arena that was added before, only possible while none of its blocks is in use
+    /// @param mem start of the arena as passed to add_arena()
+    /// @return true if the arena was removed
+    bool remove_arena(void* mem) {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        for (uint8_t i = 0; i < num_arenas; i++) {
+            Arena &arena = arenas[i];
+            if ((uintptr_t)mem > arena.start || arena.start - (uintptr_t)mem >= alignof(max_align_t)) {
+                continue;
+            }
+            uint32_t num_free = 0;
+            for (const FreeBlock* block = free_list; block != nullptr; block = block->next) {
+                num_free += contains(arena, block) ? 1U : 0U;
+            }
+            if (num_free != arena.num_blocks) {
+                return false;
+            }
+            FreeBlock** link = &free_list;
+            while (*link != nullptr) {
+                if (contains(arena, *link)) {
+                    *link = (*link)->next;
+                } else {
+                    link = &(*link)->next;
+                }
+            }
+            stats.capacity_blocks -= arena.num_blocks;
+            arenas[i] = arenas[--num_arenas];
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief take a block from the pool
+    /// @param size size of the object
+    /// @return nullptr if the object doesn't fit into a block or the pool is exhausted
+    void* allocate(size_t size) {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        if (size > BLOCK_SIZE || free_list == nullptr) {
+            return nullptr;
+        }
+        FreeBlock* block = free_list;
+        free_list = block->next;
+        stats.used_blocks++;
+        if (stats.used_blocks > stats.peak_used_blocks) {
+            stats.peak_used_blocks = stats.used_blocks;
+        }
+        return block;
+    }
+
+    /// @brief return a block to the pool
+    /// @param ptr block returned by allocate()
+    /// @return false if ptr doesn't belong to the pool
+    bool deallocate(void* ptr) {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        for (uint8_t i = 0; i < num_arenas; i++) {
+            if (contains(arenas[i], ptr)) {
+                FreeBlock* block = (FreeBlock*)ptr;
+                block->next = free_list;
+                free_list = block;
+                stats.used_blocks--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief account for an object the caller allocated from the heap instead
+    /// @param ptr result of the heap allocation
+    void record_heap_allocation(const void* ptr) {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        if (ptr != nullptr) {
+            stats.heap_allocations++;
+            stats.total_heap_allocations++;
+        } else {
+            stats.failed_allocations++;
+        }
+    }
+
+    /// @brief account for an object the caller returned to the heap
+    void record_heap_free() {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        stats.heap_allocations--;
+    }
+
+    /// @brief account for an allocation that failed without trying the heap
+    void record_failure() {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        stats.failed_allocations++;
+    }
+
+    /// @brief get the usage statistics
+    Statistics get_statistics() {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem);
+#else
+        SpinLock lock(spin);
+#endif
+        return stats;
+    }
+
+    /// @brief the pool used by Canard::allocate(), starting out with CANARD_CXX_POOL_BLOCKS static blocks
+    static BlockAllocator& get_default() {
+        struct DefaultPool {
+            DefaultPool() {
+#if CANARD_CXX_POOL_BLOCKS > 0
+                allocator.add_arena(storage, sizeof(storage));
+#endif
+            }
+#if CANARD_CXX_POOL_BLOCKS > 0
+            alignas(max_align_t) uint8_t storage[CANARD_CXX_POOL_BLOCKS * BLOCK_SIZE];
+#endif
+            BlockAllocator allocator;
+        };
+        static DefaultPool pool;
+        return pool.allocator;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+#ifndef WITH_SEMAPHORE
+    /// @brief holds the lock for its lifetime, the critical sections are a few instructions long
+    class SpinLock {
+    public:
+        SpinLock(std::atomic_flag &_flag) : flag(_flag) {
+            while (flag.test_and_set(std::memory_order_acquire)) {
+            }
+        }
+        ~SpinLock() {
+            flag.clear(std::memory_order_release);
+        }
+        SpinLock(const SpinLock&) = delete;
+        SpinLock& operator=(const SpinLock&) = delete;
+    private:
+        std::atomic_flag &flag;
+    };
+#endif
+
+    struct Arena {
+        uintptr_t start;
+        uintptr_t end;
+        uint32_t num_blocks;
+    };
+
+    static bool contains(const Arena &arena, const void* ptr) {
+        return (uintptr_t)ptr >= arena.start && (uintptr_t)ptr < arena.end;
+    }
+
+    FreeBlock* free_list = nullptr;
+    Arena arenas[CANARD_CXX_POOL_MAX_ARENAS];
+    uint8_t num_arenas = 0;
+    Statistics stats {};
+#ifdef WITH_SEMAPHORE
+    Canard::Semaphore sem;
+#else
+    std::atomic_flag spin = ATOMIC_FLAG_INIT;
+#endif
+};
+
+} // namespace Canard
@@ -21,6 +21,8 @@
  *
  */
 
+#pragma once
+
 #include <stdint.h>
 
 namespace Canard {
@@ -120,4 +122,120 @@ ArgCallback<T, msgtype>* allocate_arg_callback(T* arg, void (*cb)(T* arg, const
     return allocate<ArgCallback<T, msgtype>>(arg, cb);
 }
 
+/// @brief Callback to a member function fixed at compile time, for use as the Handler of
+/// Subscriber, Server or Client so that the call can be inlined.
+/// @tparam T type of object to call the callback on
+/// @tparam msgtype type of message handled by the callback
+/// @tparam method callback member function
+template <typename T, typename msgtype, void (T::*method)(const CanardRxTransfer& transfer, const msgtype& msg)>
+class MethodHandler {
+public:
+    /// @brief Constructor
+    /// @param _obj object to call the callback on
+    MethodHandler(T* _obj) : obj(_obj) {}
+
+    void operator()(const CanardRxTransfer& transfer, const msgtype& msg) const {
+        (obj->*method)(transfer, msg);
+    }
+private:
+    T *obj;
+};
+
+/// @brief Callback to a function fixed at compile time, see MethodHandler.
+/// @tparam msgtype type of message handled by the callback
+/// @tparam function callback function
+template <typename msgtype, void (*function)(const CanardRxTransfer& transfer, const msgtype& msg)>
+class FunctionHandler {
+public:
+    void operator()(const CanardRxTransfer& transfer, const msgtype& msg) const {
+        function(transfer, msg);
+    }
+};
+
+/// @brief Callback to a function fixed at compile time that takes a context argument, see MethodHandler.
+/// @tparam T type of object to pass to the callback
+/// @tparam msgtype type of message handled by the callback
+/// @tparam function callback function
+template <typename T, typename msgtype, void (*function)(T* arg, const CanardRxTransfer& transfer, const msgtype& msg)>
+class ArgHandler {
+public:
+    /// @brief Constructor
+    /// @param _arg argument to pass to the callback
+    ArgHandler(T* _arg) : arg(_arg) {}
+
+    void operator()(const CanardRxTransfer& transfer, const msgtype& msg) const {
+        function(arg, transfer, msg);
+    }
+private:
+    T* arg;
+};
+
+/// @brief Base class for the outcome of a single service request.
+/// @tparam rsptype type of the response
+template <typename rsptype>
+class ResponseCallback {
+public:
+    virtual ~ResponseCallback() = default;
+    /// @brief called with the response to the request
+    virtual void handle_response(const CanardRxTransfer& transfer, const rsptype& msg) = 0;
+    /// @brief called instead if no response arrived before the deadline
+    /// @param destination_node_id node the request was sent to
+    virtual void handle_timeout(uint8_t destination_node_id) = 0;
+};
+
+/// @brief Static response callback class.
+/// @tparam rsptype type of the response
+template <typename rsptype>
+class StaticResponseCallback : public ResponseCallback<rsptype> {
+public:
+    /// @brief constructor
+    /// @param _response_cb function called with the response
+    /// @param _timeout_cb function called on timeout, may be nullptr
+    StaticResponseCallback(void (*_response_cb)(const CanardRxTransfer& transfer, const rsptype& msg),
+                           void (*_timeout_cb)(uint8_t destination_node_id)) :
+        response_cb(_response_cb), timeout_cb(_timeout_cb) {}
+
+    void handle_response(const CanardRxTransfer& transfer, const rsptype& msg) override {
+        response_cb(transfer, msg);
+    }
+    void handle_timeout(uint8_t destination_node_id) override {
+        if (timeout_cb != nullptr) {
+            timeout_cb(destination_node_id);
+        }
+    }
+private:
+    void (*response_cb)(const CanardRxTransfer& transfer, const rsptype& msg);
+    void (*timeout_cb)(uint8_t destination_node_id);
+};
+
+/// @brief Object response callback class.
+/// @tparam T type of object to call the callbacks on
+/// @tparam rsptype type of the response
+template <typename T, typename rsptype>
+class ObjResponseCallback : public ResponseCallback<rsptype> {
+public:
+    /// @brief Constructor
+    /// @param _obj object to call the callbacks on
+    /// @param _response_cb member function called with the response
+    /// @param _timeout_cb member function called on timeout, may be nullptr
+    ObjResponseCallback(T* _obj, void (T::*_response_cb)(const CanardRxTransfer& transfer, const rsptype& msg),
+                        void (T::*_timeout_cb)(uint8_t destination_node_id)) :
+        obj(_obj), response_cb(_response_cb), timeout_cb(_timeout_cb) {}
+
+    void handle_response(const CanardRxTransfer& transfer, const rsptype& msg) override {
+        if (obj != nullptr) {
+            (obj->*response_cb)(transfer, msg);
+        }
+    }
+    void handle_timeout(uint8_t destination_node_id) override {
+        if (obj != nullptr && timeout_cb != nullptr) {
+            (obj->*timeout_cb)(destination_node_id);
+        }
+    }
+private:
+    T *obj;
+    void (T::*response_cb)(const CanardRxTransfer& transfer, const rsptype& msg);
+    void (T::*timeout_cb)(uint8_t destination_node_id);
+};
+
 } // namespace Canard
@@ -27,15 +27,63 @@
 #include <canard.h>
 #include "helpers.h"
 
+/*
+  when enabled, lookups read an immutable snapshot of the dispatch
+  table without taking a lock, and registrations publish a new
+  snapshot that holds every handler, growing it on the heap as
+  needed. Lookups are lock-free but not wait-free: pinning the
+  snapshot is retried when a registration publishes a new one.
+  Meant for multi-threaded hosts where handlers are rarely added or
+  removed; requires C++11 atomics and threads
+ */
+#ifndef CANARD_HANDLER_LIST_RCU
+#define CANARD_HANDLER_LIST_RCU 0
+#endif
+
+#if CANARD_HANDLER_LIST_RCU
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
+
 #ifndef CANARD_NUM_HANDLERS
 #define CANARD_NUM_HANDLERS 3
 #endif
 
 /*
-  the number of buckets helps reduce CPU usage when there are many handlers
+  the number of distinct (transfer type, data type ID) pairs each
+  interface can dispatch through a binary search of its sorted
+  table. Pairs that don't fit are kept in an overflow list which is
+  searched linearly, so this only affects performance. The setting
+  is global, every interface gets a table of this size. In RCU mode
+  it is the initial number of handlers a snapshot holds, snapshots
+  grow beyond it.
+  Each slot is a key and a pointer, so CANARD_NUM_HANDLERS tables of
+  16 slots take about 3 x 140 bytes of static RAM on a 32-bit MCU,
+  where the hash buckets this replaces took 3 x 32 bytes. 64-bit
+  hosts default to 32 slots
+ */
+#ifndef CANARD_HANDLER_TABLE_SIZE
+#if UINTPTR_MAX > 0xFFFFFFFFU
+#define CANARD_HANDLER_TABLE_SIZE 32U
+#else
+#define CANARD_HANDLER_TABLE_SIZE 16U
+#endif
+#endif
+
+// the hash buckets are gone, the setting is ignored
+#ifdef CANARD_NUM_RX_BUCKETS
+#warning "CANARD_NUM_RX_BUCKETS is no longer used, set CANARD_HANDLER_TABLE_SIZE instead"
+#endif
+
+/*
+  the number of snapshot buffers per interface in RCU mode. A buffer
+  can be reused once no reader is left in it; with three buffers a
+  registration never waits for a reader that is still dispatching on
+  the same thread
  */
-#ifndef CANARD_NUM_RX_BUCKETS
-#define CANARD_NUM_RX_BUCKETS 8U
+#ifndef CANARD_HANDLER_SNAPSHOTS
+#define CANARD_HANDLER_SNAPSHOTS 3U
 #endif
 
 namespace Canard {
@@ -66,10 +114,25 @@ public:
     /// @return true if the message is handled by this handler list
     static bool accept_message(uint8_t index,  uint16_t msgid, CanardTransferType transfer_type, uint64_t &signature) NOINLINE_FUNC
     {
+#if CANARD_HANDLER_LIST_RCU
+        const uint32_t key = make_key(transfer_type, msgid);
+        {
+            SnapshotReader reader(table[index]);
+            const Snapshot* snap = reader.snapshot;
+            if (snap != nullptr) {
+                const uint16_t pos = lower_bound(*snap, key);
+                if (pos < snap->num_entries && snap->entries[pos].key == key) {
+                    signature = snap->entries[pos].handler->signature;
+                    return true;
+                }
+            }
+        }
+        return false;
+#else
 #ifdef WITH_SEMAPHORE
         WITH_SEMAPHORE(sem[index]);
 #endif
-        HandlerList* entry = head[index][msgid % CANARD_NUM_RX_BUCKETS];
+        HandlerList* entry = find_handlers(index, make_key(transfer_type, msgid));
         while (entry != nullptr) {
             if (entry->msgid == msgid && entry->transfer_type == transfer_type) {
                 signature = entry->signature;
@@ -78,6 +141,7 @@ public:
             entry = entry->next;
         }
         return false;
+#endif
     }
 
     /// @brief handle a message if it is handled by this handler list
@@ -85,21 +149,65 @@ public:
     /// @param transfer transfer object of the request
     static void handle_message(uint8_t index, const CanardRxTransfer& transfer) NOINLINE_FUNC
     {
+        const uint32_t key = make_key((CanardTransferType)transfer.transfer_type, transfer.data_type_id);
+#if CANARD_HANDLER_LIST_RCU
+        SnapshotReader reader(table[index]);
+        const Snapshot* snap = reader.snapshot;
+        if (snap == nullptr) {
+            return;
+        }
+        HandlerRun run(key, snap->entries + lower_bound(*snap, key), snap->entries + snap->num_entries);
+#else
 #ifdef WITH_SEMAPHORE
         WITH_SEMAPHORE(sem[index]);
 #endif
-        HandlerList* entry = head[index][transfer.data_type_id % CANARD_NUM_RX_BUCKETS];
-        while (entry != nullptr) {
-            if (transfer.data_type_id == entry->msgid &&
-                entry->transfer_type == transfer.transfer_type) {
-                if (entry->handle_message(transfer) &&
-                    transfer.transfer_type != CanardTransferTypeBroadcast) {
-                    // we only allow one request or response for non-broadcast
-                    break;
-                }
-            }
-            entry = entry->next;
+        HandlerRun run(key, find_handlers(index, key));
+#endif
+        dispatch_run(run, transfer);
+    }
+
+    /// @brief list the transfers the handlers of an interface accept, e.g. for canardMakeAcceptanceFilters()
+    /// @param index Index of the handler list
+    /// @param[out] out_transfers array to fill, each transfer appears once
+    /// @param max_transfers size of the array
+    /// @return number of transfers, more than max_transfers if the array was too small
+    static uint16_t get_accepted_transfers(uint8_t index, CanardAcceptedTransfer* out_transfers, uint16_t max_transfers) NOINLINE_FUNC
+    {
+        uint16_t num = 0;
+#if CANARD_HANDLER_LIST_RCU
+        SnapshotReader reader(table[index]);
+        const Snapshot* snap = reader.snapshot;
+        for (uint16_t i = 0; snap != nullptr && i < snap->num_entries; i++) {
+            add_accepted_transfer(snap->entries[i].key, out_transfers, max_transfers, num);
         }
+#else
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem[index]);
+#endif
+        const DispatchTable &t = table[index];
+        for (uint16_t i = 0; i < t.num_slots; i++) {
+            add_accepted_transfer(t.slots[i].key, out_transfers, max_transfers, num);
+        }
+        for (const HandlerList* entry = t.overflow; entry != nullptr; entry = entry->next) {
+            add_accepted_transfer(make_key(entry->transfer_type, entry->msgid), out_transfers, max_transfers, num);
+        }
+#endif
+        return num;
+    }
+
+    /// @brief counter that changes whenever a handler of the interface is registered or removed, so
+    /// that acceptance filters made from get_accepted_transfers() can be refreshed. It doesn't change
+    /// with the local node ID, which the service filters depend on as well
+    /// @param index Index of the handler list
+    static uint32_t get_generation(uint8_t index) {
+#if CANARD_HANDLER_LIST_RCU
+        return table[index].generation.load();
+#else
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(sem[index]);
+#endif
+        return table[index].generation;
+#endif
     }
 
     /// @brief Method to handle a message implemented by the derived class
@@ -107,7 +215,23 @@ public:
     /// @return true if the message is for this consumer
     virtual bool handle_message(const CanardRxTransfer& transfer) = 0;
 
+    /// @brief handlers that return the same non-null group decode a transfer the same way,
+    /// so the first of them can serve the others from a single decode
+    virtual const void* decode_group() const { return nullptr; }
+
 protected:
+    class HandlerRun;
+
+    /// @brief handle a message as the first of the remaining handlers in the run. An
+    /// implementation may also serve the handlers that follow it by taking them from the run
+    /// @param transfer transfer object of the request
+    /// @param run handlers registered for the transfer that haven't been called yet
+    /// @return true if the message is for this consumer
+    virtual bool handle_run(const CanardRxTransfer& transfer, HandlerRun& run) {
+        (void)run;
+        return handle_message(transfer);
+    }
+
     virtual ~HandlerList() {}
     uint8_t index;
     HandlerList* next;
@@ -115,13 +239,97 @@ protected:
     static Canard::Semaphore sem[CANARD_NUM_HANDLERS];
 #endif
 
+#if CANARD_HANDLER_LIST_RCU
+    // add ourselves to the handler list by publishing a new snapshot. If the snapshot can't grow
+    // the handler isn't registered, which is counted as a failed allocation of the default pool
+    void link(void) NOINLINE_FUNC {
+        DispatchTable &t = table[index];
+        std::lock_guard<std::recursive_mutex> lock(t.writer_lock);
+        const Snapshot* current = t.current.load();
+        const uint16_t num_entries = (current != nullptr) ? current->num_entries : 0U;
+        Snapshot* free_snap = nullptr;
+        if (num_entries < UINT16_MAX) {
+            free_snap = acquire_free_snapshot(t, (uint16_t)(num_entries + 1U), false);
+        }
+        if (free_snap == nullptr) {
+            BlockAllocator::get_default().record_failure();
+            return;
+        }
+        t.generation.fetch_add(1);
+        const uint32_t key = make_key(transfer_type, msgid);
+        Snapshot &snap = *free_snap;
+        uint16_t n = 0;
+        bool inserted = false;
+        for (uint16_t i = 0; i < num_entries; i++) {
+            // newest first among the handlers of the same key
+            if (!inserted && current->entries[i].key >= key) {
+                snap.entries[n++] = Entry { key, this };
+                inserted = true;
+            }
+            snap.entries[n++] = current->entries[i];
+        }
+        if (!inserted) {
+            snap.entries[n++] = Entry { key, this };
+        }
+        snap.num_entries = n;
+        t.current.store(&snap);
+    }
+
+    // remove ourselves from the handler list and wait until no reader can see us anymore
+    void unlink(void) NOINLINE_FUNC {
+        DispatchTable &t = table[index];
+        {
+            std::lock_guard<std::recursive_mutex> lock(t.writer_lock);
+            t.generation.fetch_add(1);
+            const Snapshot* current = t.current.load();
+            if (current == nullptr || !in_snapshot(*current)) {
+                // never registered, the snapshot couldn't grow
+                return;
+            }
+            // every registration and removal changes the number of entries by one, so the snapshot published
+            // before the current one is large enough once its readers have left, even if the heap is exhausted
+            Snapshot &snap = *acquire_free_snapshot(t, (uint16_t)(current->num_entries - 1U), true);
+            uint16_t n = 0;
+            for (uint16_t i = 0; i < current->num_entries; i++) {
+                if (current->entries[i].handler != this) {
+                    snap.entries[n++] = current->entries[i];
+                }
+            }
+            snap.num_entries = n;
+            t.current.store(&snap);
+        }
+        // readers on this thread, e.g. the dispatch that destroys an unrelated handler, can't be waited for
+        // and are left out; destroying a handler from within its own dispatch is not supported in any mode
+        wait_for_readers(t);
+    }
+#else
     // add ourselves to the handler list
     void link(void) NOINLINE_FUNC {
 #ifdef WITH_SEMAPHORE
         WITH_SEMAPHORE(sem[index]);
 #endif
-        next = head[index][msgid % CANARD_NUM_RX_BUCKETS];
-        head[index][msgid % CANARD_NUM_RX_BUCKETS] = this;
+        DispatchTable &t = table[index];
+        t.generation++;
+        const uint32_t key = make_key(transfer_type, msgid);
+        uint16_t pos = lower_bound(t, key);
+        if (pos < t.num_slots && t.slots[pos].key == key) {
+            next = t.slots[pos].handlers;
+            t.slots[pos].handlers = this;
+            return;
+        }
+        if (t.num_slots >= CANARD_HANDLER_TABLE_SIZE || in_overflow(t, key)) {
+            // every key lives in exactly one place, so keep further handlers of an overflowed key there too
+            next = t.overflow;
+            t.overflow = this;
+            return;
+        }
+        for (uint16_t i = t.num_slots; i > pos; i--) {
+            t.slots[i] = t.slots[i - 1];
+        }
+        t.slots[pos].key = key;
+        t.slots[pos].handlers = this;
+        t.num_slots++;
+        next = nullptr;
     }
 
     // remove ourselves from the handler list
@@ -129,22 +337,312 @@ protected:
 #ifdef WITH_SEMAPHORE
         WITH_SEMAPHORE(sem[index]);
 #endif
-        HandlerList* entry = head[index][msgid % CANARD_NUM_RX_BUCKETS];
-        if (entry == this) {
-            head[index][msgid % CANARD_NUM_RX_BUCKETS] = next;
+        DispatchTable &t = table[index];
+        t.generation++;
+        const uint32_t key = make_key(transfer_type, msgid);
+        const uint16_t pos = lower_bound(t, key);
+        if (pos < t.num_slots && t.slots[pos].key == key) {
+            if (remove_from(t.slots[pos].handlers) && t.slots[pos].handlers == nullptr) {
+                for (uint16_t i = pos; i + 1U < t.num_slots; i++) {
+                    t.slots[i] = t.slots[i + 1U];
+                }
+                t.num_slots--;
+            }
             return;
         }
-        while (entry != nullptr) {
-            if (entry->next == this) {
-                entry->next = next;
+        remove_from(t.overflow);
+    }
+#endif
+
+private:
+    static constexpr uint32_t make_key(CanardTransferType _transfer_type, uint16_t _msgid) {
+        return ((uint32_t)_transfer_type << 16U) | _msgid;
+    }
+
+    /// @brief append the transfer of a key unless it is listed already; keeps counting past the end of the array
+    static void add_accepted_transfer(uint32_t key, CanardAcceptedTransfer* out_transfers, uint16_t max_transfers, uint16_t &num) {
+        const uint16_t num_written = (num < max_transfers) ? num : max_transfers;
+        for (uint16_t i = 0; i < num_written; i++) {
+            if (make_key((CanardTransferType)out_transfers[i].transfer_type, out_transfers[i].data_type_id) == key) {
                 return;
             }
-            entry = entry->next;
         }
+        if (num < max_transfers) {
+            out_transfers[num].data_type_id = (uint16_t)(key & 0xFFFFU);
+            out_transfers[num].transfer_type = (uint8_t)(key >> 16U);
+        }
+        num++;
     }
 
+#if CANARD_HANDLER_LIST_RCU
+    /// @brief one registered handler in a snapshot
+    struct Entry {
+        uint32_t key;
+        HandlerList* handler;
+    };
+
+    /// @brief immutable, sorted copy of the registered handlers, latest first among equal keys
+    struct Snapshot {
+        Entry* entries; ///< heap buffer, only reallocated while the snapshot is neither published nor read
+        uint16_t capacity;
+        uint16_t num_entries;
+        std::atomic<uint32_t> readers;
+    };
+
+    /// @brief per interface set of snapshots, of which one is published at a time
+    struct DispatchTable {
+        Snapshot snapshots[CANARD_HANDLER_SNAPSHOTS];
+        std::atomic<const Snapshot*> current;
+        std::recursive_mutex writer_lock; ///< serializes writers
+        std::atomic<uint32_t> generation; ///< changes with every registration and removal
+    };
+
+    struct SnapshotReader;
+
+    /// @brief the innermost reader of this thread, readers nest when a handler dispatches again
+    static SnapshotReader* &innermost_reader() {
+        static thread_local SnapshotReader* reader;
+        return reader;
+    }
+
+    /// @brief pins the published snapshot for the lifetime of the object
+    struct SnapshotReader {
+        explicit SnapshotReader(DispatchTable &t) : outer(innermost_reader()) {
+            innermost_reader() = this;
+            for (;;) {
+                Snapshot* snap = const_cast<Snapshot*>(t.current.load());
+                if (snap == nullptr) {
+                    break;
+                }
+                snap->readers.fetch_add(1);
+                // the writer only reuses a snapshot that isn't published, so if it is still published
+                // after we registered, it stays intact until we leave
+                if (t.current.load() == snap) {
+                    snapshot = snap;
+                    break;
+                }
+                snap->readers.fetch_sub(1);
+            }
+        }
+        ~SnapshotReader() {
+            if (snapshot != nullptr) {
+                snapshot->readers.fetch_sub(1);
+            }
+            innermost_reader() = outer;
+        }
+        SnapshotReader(const SnapshotReader&) = delete;
+        Snapshot* snapshot = nullptr;
+        SnapshotReader* const outer;
+    };
+
+    /// @brief whether this handler is registered in the snapshot
+    bool in_snapshot(const Snapshot &snap) const {
+        for (uint16_t i = 0; i < snap.num_entries; i++) {
+            if (snap.entries[i].handler == this) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief number of readers of the snapshot on this thread
+    static uint32_t own_readers(const Snapshot &snap) {
+        uint32_t num = 0;
+        for (const SnapshotReader* reader = innermost_reader(); reader != nullptr; reader = reader->outer) {
+            num += (reader->snapshot == &snap) ? 1U : 0U;
+        }
+        return num;
+    }
+
+    static uint16_t lower_bound(const Snapshot &snap, uint32_t key) {
+        uint16_t low = 0;
+        uint16_t high = snap.num_entries;
+        while (low < high) {
+            const uint16_t mid = (uint16_t)((low + high) / 2U);
+            if (snap.entries[mid].key < key) {
+                low = (uint16_t)(mid + 1U);
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    /// @brief find a snapshot that is neither published nor read and holds num_entries, growing one if
+    /// needed; called with the writer lock held
+    /// @param must_succeed wait for a large enough snapshot to become free if the heap is exhausted,
+    /// otherwise return nullptr
+    static Snapshot* acquire_free_snapshot(DispatchTable &t, uint16_t num_entries, bool must_succeed) {
+        for (;;) {
+            Snapshot* free_snap = nullptr;
+            for (Snapshot &snap : t.snapshots) {
+                if (&snap != t.current.load() && snap.readers.load() == 0U) {
+                    if (snap.capacity >= num_entries) {
+                        return &snap;
+                    }
+                    free_snap = &snap;
+                }
+            }
+            if (free_snap != nullptr) {
+                // grow in steps, so that registering many handlers doesn't copy them over and over
+                uint32_t capacity = (free_snap->capacity > 0U) ? free_snap->capacity * 2U : CANARD_HANDLER_TABLE_SIZE;
+                capacity = (capacity < num_entries) ? num_entries : ((capacity > UINT16_MAX) ? UINT16_MAX : capacity);
+                Entry* entries = static_cast<Entry*>(CANARD_MALLOC(capacity * sizeof(Entry)));
+                if (entries != nullptr) {
+                    CANARD_FREE(free_snap->entries);
+                    free_snap->entries = entries;
+                    free_snap->capacity = (uint16_t)capacity;
+                    return free_snap;
+                }
+                if (!must_succeed) {
+                    return nullptr;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /// @brief wait until every reader of an unpublished snapshot on other threads has left
+    static void wait_for_readers(DispatchTable &t) {
+        for (Snapshot &snap : t.snapshots) {
+            const uint32_t own = own_readers(snap);
+            while (&snap != t.current.load() && snap.readers.load() > own) {
+                std::this_thread::yield();
+            }
+        }
+    }
+#else
+    /// @brief one key of the dispatch table and the handlers registered for it, latest first
+    struct DispatchSlot {
+        uint32_t key;
+        HandlerList* handlers;
+    };
+
+    /// @brief per interface dispatch table, sorted by key
+    struct DispatchTable {
+        DispatchSlot slots[CANARD_HANDLER_TABLE_SIZE];
+        uint16_t num_slots;
+        HandlerList* overflow; ///< handlers of keys that did not fit into the table
+        uint32_t generation; ///< changes with every registration and removal
+    };
+
+    /// @brief index of the first slot with a key not less than the given one
+    static uint16_t lower_bound(const DispatchTable &t, uint32_t key) {
+        uint16_t low = 0;
+        uint16_t high = t.num_slots;
+        while (low < high) {
+            const uint16_t mid = (uint16_t)((low + high) / 2U);
+            if (t.slots[mid].key < key) {
+                low = (uint16_t)(mid + 1U);
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    static bool in_overflow(const DispatchTable &t, uint32_t key) {
+        for (const HandlerList* entry = t.overflow; entry != nullptr; entry = entry->next) {
+            if (make_key(entry->transfer_type, entry->msgid) == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief first handler to try for the key; the caller still has to match the entries
+    static HandlerList* find_handlers(uint8_t index, uint32_t key) {
+        const DispatchTable &t = table[index];
+        const uint16_t pos = lower_bound(t, key);
+        if (pos < t.num_slots && t.slots[pos].key == key) {
+            return t.slots[pos].handlers;
+        }
+        return t.overflow;
+    }
+#endif
+
+protected:
+    /// @brief the handlers registered for the key of one transfer, in dispatch order
+    class HandlerRun {
+    public:
+        /// @brief the handler next() would return, nullptr at the end of the run
+        HandlerList* peek() const { return current; }
+
+        /// @brief take the next handler from the run
+        HandlerList* next() {
+            HandlerList* entry = current;
+            if (entry != nullptr) {
+                advance();
+            }
+            return entry;
+        }
+
+    private:
+        friend class HandlerList;
+        // run over a list that may hold handlers of other keys too
+        HandlerRun(uint32_t _key, HandlerList* list) : key(_key) {
+            current = match(list);
+        }
+#if CANARD_HANDLER_LIST_RCU
+        // run over the snapshot entries starting at pos
+        HandlerRun(uint32_t _key, const Entry* _pos, const Entry* _end) : key(_key), pos(_pos), end(_end) {
+            current = (pos < end && pos->key == key) ? pos->handler : nullptr;
+        }
+#endif
+        HandlerList* match(HandlerList* entry) const {
+            while (entry != nullptr && make_key(entry->transfer_type, entry->msgid) != key) {
+                entry = entry->next;
+            }
+            return entry;
+        }
+        void advance() {
+#if CANARD_HANDLER_LIST_RCU
+            if (pos != nullptr) {
+                pos++;
+                current = (pos < end && pos->key == key) ? pos->handler : nullptr;
+                return;
+            }
+#endif
+            current = match(current->next);
+        }
+        uint32_t key;
+        HandlerList* current;
+#if CANARD_HANDLER_LIST_RCU
+        const Entry* pos = nullptr;
+        const Entry* end = nullptr;
+#endif
+    };
+
 private:
-    static HandlerList* head[CANARD_NUM_HANDLERS][CANARD_NUM_RX_BUCKETS];
+    /// @brief call the handlers of a run
+    /// @return true once a request or response has been consumed
+    static bool dispatch_run(HandlerRun &run, const CanardRxTransfer& transfer) {
+        for (HandlerList* entry = run.next(); entry != nullptr; entry = run.next()) {
+            if (entry->handle_run(transfer, run) &&
+                transfer.transfer_type != CanardTransferTypeBroadcast) {
+                // we only allow one request or response for non-broadcast
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // remove ourselves from a singly-linked list of handlers
+    bool remove_from(HandlerList* &list_head) {
+        if (list_head == this) {
+            list_head = next;
+            return true;
+        }
+        for (HandlerList* entry = list_head; entry != nullptr; entry = entry->next) {
+            if (entry->next == this) {
+                entry->next = next;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static DispatchTable table[CANARD_NUM_HANDLERS];
     uint16_t msgid;
     uint64_t signature;
     CanardTransferType transfer_type;
@@ -152,5 +650,5 @@ private:
 
 } // namespace Canard
 
-#define DEFINE_HANDLER_LIST_HEADS() Canard::HandlerList* Canard::HandlerList::head[CANARD_NUM_HANDLERS][CANARD_NUM_RX_BUCKETS] = {}
+#define DEFINE_HANDLER_LIST_HEADS() Canard::HandlerList::DispatchTable Canard::HandlerList::table[CANARD_NUM_HANDLERS] = {}
 #define DEFINE_HANDLER_LIST_SEMAPHORES() Canard::Semaphore Canard::HandlerList::sem[CANARD_NUM_HANDLERS] = {}
@@ -17,10 +17,24 @@
 #define CANARD_FREE free
 #endif
 
+#include "allocator.h"
+
 namespace Canard {
+/// @brief create an object in a pool block, or on the heap if the pool can't take it
 template<typename T, typename ...Args>
 T* allocate(Args...args) {
-    auto ret = CANARD_MALLOC(sizeof(T));
+    BlockAllocator &pool = BlockAllocator::get_default();
+    auto ret = pool.allocate(sizeof(T));
+#if CANARD_CXX_POOL_HEAP_FALLBACK
+    if (ret == nullptr) {
+        ret = CANARD_MALLOC(sizeof(T));
+        pool.record_heap_allocation(ret);
+    }
+#else
+    if (ret == nullptr) {
+        pool.record_failure();
+    }
+#endif
     if (ret == nullptr) {
         return nullptr;
     }
@@ -34,7 +48,11 @@ void deallocate(T* ptr) {
         return;
     }
     ptr->~T();
-    CANARD_FREE(ptr);
+    BlockAllocator &pool = BlockAllocator::get_default();
+    if (!pool.deallocate(ptr)) {
+        CANARD_FREE(ptr);
+        pool.record_heap_free();
+    }
 }
 
-}
\ No newline at end of file
+}
@@ -30,8 +30,82 @@
 #define CANARD_IFACE_ALL 0xFF
 #endif
 
+/*
+  when enabled, publishers, clients and servers encode into one of a
+  few scratch buffers per interface instead of each embedding a buffer
+  for the largest message of its type. The buffers only need to cover
+  the sends in progress at the same time, including those made from
+  callbacks of a send on a loopback interface
+ */
+#ifndef CANARD_CXX_SHARED_ENCODE_BUFFER
+#define CANARD_CXX_SHARED_ENCODE_BUFFER 0
+#endif
+
+#ifndef CANARD_CXX_ENCODE_BUFFER_SIZE
+#define CANARD_CXX_ENCODE_BUFFER_SIZE 512U
+#endif
+
+#ifndef CANARD_CXX_ENCODE_BUFFERS
+#define CANARD_CXX_ENCODE_BUFFERS 2U
+#endif
+
 namespace Canard {
 
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+/// @brief scratch buffer to encode a message into, taken from the interface's set for the lifetime of the object
+class EncodeBuffer {
+public:
+    /// @param index index of the interface
+    EncodeBuffer(uint8_t index) : pool(get_pool(index)) {
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(pool.sem);
+#endif
+        for (uint8_t i = 0; i < CANARD_CXX_ENCODE_BUFFERS; i++) {
+            if (!pool.in_use[i]) {
+                pool.in_use[i] = true;
+                slot = i;
+                break;
+            }
+        }
+    }
+
+    ~EncodeBuffer() {
+        if (slot >= CANARD_CXX_ENCODE_BUFFERS) {
+            return;
+        }
+#ifdef WITH_SEMAPHORE
+        WITH_SEMAPHORE(pool.sem);
+#endif
+        pool.in_use[slot] = false;
+    }
+
+    EncodeBuffer(const EncodeBuffer&) = delete;
+    EncodeBuffer& operator=(const EncodeBuffer&) = delete;
+
+    /// @brief the buffer, nullptr if all buffers of the interface are in use
+    uint8_t* data() {
+        return (slot < CANARD_CXX_ENCODE_BUFFERS) ? pool.buffers[slot] : nullptr;
+    }
+
+private:
+    struct Pool {
+        uint8_t buffers[CANARD_CXX_ENCODE_BUFFERS][CANARD_CXX_ENCODE_BUFFER_SIZE];
+        bool in_use[CANARD_CXX_ENCODE_BUFFERS];
+#ifdef WITH_SEMAPHORE
+        Canard::Semaphore sem;
+#endif
+    };
+
+    static Pool &get_pool(uint8_t index) {
+        static Pool pools[CANARD_NUM_HANDLERS];
+        return pools[index];
+    }
+
+    Pool &pool;
+    uint8_t slot = CANARD_CXX_ENCODE_BUFFERS;
+};
+#endif
+
 struct Transfer {
     CanardTransferType transfer_type; ///< Type of transfer: CanardTransferTypeBroadcast, CanardTransferTypeRequest, CanardTransferTypeResponse
     uint64_t data_type_signature; ///< Signature of the message/service
@@ -60,12 +60,12 @@ protected:
         switch (transfer.transfer_type)
         {
         case CanardTransferTypeBroadcast:
-            transfer.inout_transfer_id = TransferObject::get_tid_ptr(interface.get_index(),transfer.data_type_id, CanardTransferTypeBroadcast, interface.get_node_id(), destination_node_id);
+            transfer.inout_transfer_id = get_tid_ptr(transfer.data_type_id, CanardTransferTypeBroadcast, destination_node_id);
             transfer.priority = priority;
             transfer.timeout_ms = timeout;
             return interface.broadcast(transfer);
         case CanardTransferTypeRequest:
-            transfer.inout_transfer_id = TransferObject::get_tid_ptr(interface.get_index(),transfer.data_type_id, CanardTransferTypeRequest, interface.get_node_id(), destination_node_id);
+            transfer.inout_transfer_id = get_tid_ptr(transfer.data_type_id, CanardTransferTypeRequest, destination_node_id);
             transfer.priority = priority;
             transfer.timeout_ms = timeout;
             return interface.request(destination_node_id, transfer);
@@ -74,9 +74,26 @@ protected:
             return false;
         }
     }
+
+    /// @brief transfer ID pointer for a transfer from this node, cached from the last lookup
+    /// @return nullptr if no transfer ID could be allocated
+    uint8_t* get_tid_ptr(uint16_t data_type_id, CanardTransferType transfer_type, uint8_t destination_node_id) {
+        const uint32_t transfer_desc = MAKE_TRANSFER_DESCRIPTOR(data_type_id, transfer_type, interface.get_node_id(), destination_node_id);
+        const uint32_t generation = TransferObject::get_generation(interface.get_index());
+        if (cached_tid_ptr == nullptr || cached_transfer_desc != transfer_desc || cached_generation != generation) {
+            cached_tid_ptr = TransferObject::get_tid_ptr(interface.get_index(), data_type_id, transfer_type, interface.get_node_id(), destination_node_id);
+            cached_transfer_desc = transfer_desc;
+            cached_generation = generation;
+        }
+        return cached_tid_ptr;
+    }
+
 private:
     uint8_t priority = CANARD_TRANSFER_PRIORITY_MEDIUM; ///< Priority of the message
     uint32_t timeout = 1000; ///< Timeout of the message in ms
+    uint8_t* cached_tid_ptr = nullptr; ///< transfer ID of the last transfer descriptor we sent
+    uint32_t cached_transfer_desc = 0;
+    uint32_t cached_generation = 0;
 };
 
 template <typename msgtype>
@@ -105,6 +122,13 @@ public:
         if (canfd) {
             return false;
         }
+#endif
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+        EncodeBuffer buffer(interface.get_index());
+        uint8_t* msg_buf = buffer.data();
+        if (msg_buf == nullptr) {
+            return false;
+        }
 #endif
         // encode the message
         uint32_t len = msgtype::cxx_iface::encode(&msg, msg_buf 
@@ -116,25 +140,122 @@ public:
         );
         // send the message if encoded successfully
         if (len > 0) {
-            Transfer msg_transfer {};
-            msg_transfer.transfer_type = CanardTransferTypeBroadcast;
-            msg_transfer.data_type_id = msgtype::cxx_iface::ID;
-            msg_transfer.data_type_signature = msgtype::cxx_iface::SIGNATURE;
-            msg_transfer.payload = msg_buf;
-            msg_transfer.payload_len = len;
+            return broadcast(msg_buf, len, canfd);
+        }
+        return false;
+    }
+
+    /// @brief Broadcast a message that is encoded already, e.g. one that is sent on several interfaces
+    /// @param payload encoded message
+    /// @param payload_len length of the encoded message
+    /// @return true if the message was put into the queue successfully
+    bool broadcast(const uint8_t* payload, uint32_t payload_len) {
+        return broadcast(payload, payload_len, interface.is_canfd());
+    }
+
+    /// @brief Broadcast a message that is encoded already
+    /// @param payload encoded message, with the tail array optimisation applied unless canfd is set
+    /// @param payload_len length of the encoded message
+    /// @param canfd true if the message should be sent as CAN FD
+    /// @return true if the message was put into the queue successfully
+    bool broadcast(const uint8_t* payload, uint32_t payload_len, bool canfd) {
+#if !CANARD_ENABLE_CANFD
+        if (canfd) {
+            return false;
+        }
+#endif
+        Transfer msg_transfer {};
+        msg_transfer.transfer_type = CanardTransferTypeBroadcast;
+        msg_transfer.data_type_id = msgtype::cxx_iface::ID;
+        msg_transfer.data_type_signature = msgtype::cxx_iface::SIGNATURE;
+        msg_transfer.payload = payload;
+        msg_transfer.payload_len = payload_len;
 #if CANARD_ENABLE_CANFD
-            msg_transfer.canfd = canfd;
+        msg_transfer.canfd = canfd;
 #endif
 #if CANARD_MULTI_IFACE
-            msg_transfer.iface_mask = CANARD_IFACE_ALL;
+        msg_transfer.iface_mask = CANARD_IFACE_ALL;
 #endif
-            return send(msg_transfer);
-        }
-        return false;
+        return send(msg_transfer);
     }
 private:
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+    static_assert(msgtype::cxx_iface::MAX_SIZE <= CANARD_CXX_ENCODE_BUFFER_SIZE, "CANARD_CXX_ENCODE_BUFFER_SIZE is too small for this message");
+#else
     uint8_t msg_buf[msgtype::cxx_iface::MAX_SIZE]; ///< Buffer to store the encoded message
+#endif
 };
+
+/// @brief Publisher that sends at most once per interval. Messages published in between
+/// replace each other, and the latest one is sent once the interval has passed
+/// @tparam msgtype type of the message
+template <typename msgtype>
+class CoalescingPublisher : public Publisher<msgtype> {
+public:
+    /// @brief counters of what happened to the published messages
+    struct Statistics {
+        uint32_t sent; ///< messages put into the queue
+        uint32_t coalesced; ///< messages replaced by a newer one before they were sent
+        uint32_t dropped; ///< messages the interface didn't accept
+    };
+
+    /// @brief CoalescingPublisher constructor
+    /// @param _interface Interface to send on
+    /// @param _min_interval_usec minimum time between two messages
+    CoalescingPublisher(Interface &_interface, uint32_t _min_interval_usec) :
+    Publisher<msgtype>(_interface),
+    min_interval_usec(_min_interval_usec)
+    {}
+
+    // delete copy constructor and assignment operator
+    CoalescingPublisher(const CoalescingPublisher&) = delete;
+
+    /// @brief send the message now if the interval has passed, otherwise keep it for update()
+    /// @param msg message to send
+    /// @param now_usec current time in microseconds
+    /// @return false if the message was sent and the interface didn't accept it
+    bool publish(const msgtype& msg, uint64_t now_usec) {
+        if (pending) {
+            stats.coalesced++;
+        }
+        latest = msg;
+        pending = true;
+        return update(now_usec);
+    }
+
+    /// @brief send the kept message once the interval has passed, to be called periodically
+    /// @param now_usec current time in microseconds
+    /// @return false if a message was sent and the interface didn't accept it
+    bool update(uint64_t now_usec) {
+        if (!pending || now_usec < next_send_usec) {
+            return true;
+        }
+        pending = false;
+        next_send_usec = now_usec + min_interval_usec;
+        if (!Publisher<msgtype>::broadcast(latest)) {
+            stats.dropped++;
+            return false;
+        }
+        stats.sent++;
+        return true;
+    }
+
+    /// @brief true if a message is waiting for the interval to pass
+    bool is_pending() const { return pending; }
+
+    /// @brief change the minimum time between two messages, from the next message on
+    void set_min_interval_usec(uint32_t _min_interval_usec) { min_interval_usec = _min_interval_usec; }
+
+    const Statistics& get_statistics() const { return stats; }
+
+private:
+    msgtype latest {};
+    bool pending = false;
+    uint32_t min_interval_usec;
+    uint64_t next_send_usec = 0;
+    Statistics stats {};
+};
+
 } // namespace Canard
 
 /// @brief Macro to create a publisher
@@ -25,18 +25,27 @@
 #include "handler_list.h"
 #include "interface.h"
 #include "publisher.h"
+#include "callbacks.h"
+
+/*
+  the default number of requests an AsyncClient can have outstanding
+ */
+#ifndef CANARD_CLIENT_MAX_PENDING
+#define CANARD_CLIENT_MAX_PENDING 8U
+#endif
 
 namespace Canard {
 
 /// @brief Client class to handle service requests
 /// @tparam rsptype Service type
-template <typename rsptype>
+/// @tparam Handler type of the callback, see Subscriber
+template <typename rsptype, typename Handler = Callback<rsptype>&>
 class Client : public HandlerList, public Sender {
 public:
     /// @brief Client constructor
     /// @param _interface Interface object
     /// @param _cb Callback object
-    Client(Interface &_interface, Callback<rsptype> &_cb) NOINLINE_FUNC :
+    Client(Interface &_interface, Handler _cb) NOINLINE_FUNC :
     HandlerList(CanardTransferTypeResponse, rsptype::cxx_iface::ID, rsptype::cxx_iface::SIGNATURE, _interface.get_index()),
     Sender(_interface),
     server_node_id(255),
@@ -85,6 +94,13 @@ public:
         if (canfd) {
             return false;
         }
+#endif
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+        EncodeBuffer buffer(interface.get_index());
+        uint8_t* req_buf = buffer.data();
+        if (req_buf == nullptr) {
+            return false;
+        }
 #endif
         // encode the message
         uint32_t len = rsptype::cxx_iface::req_encode(&msg, req_buf 
@@ -107,7 +123,11 @@ public:
 #if CANARD_MULTI_IFACE
         req_transfer.iface_mask = CANARD_IFACE_ALL;
 #endif
-        transfer_id = *TransferObject::get_tid_ptr(interface.get_index(), rsptype::cxx_iface::ID, CanardTransferTypeRequest, interface.get_node_id(), destination_node_id);
+        const uint8_t* tid_ptr = get_tid_ptr(rsptype::cxx_iface::ID, CanardTransferTypeRequest, destination_node_id);
+        if (tid_ptr == nullptr) {
+            return false;
+        }
+        transfer_id = *tid_ptr;
         server_node_id = destination_node_id;
         return send(req_transfer, destination_node_id);
     }
@@ -115,9 +135,192 @@ public:
 private:
     uint8_t server_node_id;
 
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+    static_assert(rsptype::cxx_iface::REQ_MAX_SIZE <= CANARD_CXX_ENCODE_BUFFER_SIZE, "CANARD_CXX_ENCODE_BUFFER_SIZE is too small for this request");
+#else
     uint8_t req_buf[rsptype::cxx_iface::REQ_MAX_SIZE];
-    Callback<rsptype> &cb;
+#endif
+    Handler cb;
     uint8_t transfer_id;
 };
 
+/// @brief Client with a callback type known at compile time
+template <typename rsptype, typename Handler>
+using InlineClient = Client<rsptype, Handler>;
+
+/// @brief Client class that can have several requests outstanding at once, each with its own
+/// callback and deadline. Deadlines are checked by calling process() periodically
+/// @tparam rsptype Service type
+/// @tparam MAX_PENDING maximum number of outstanding requests
+template <typename rsptype, uint8_t MAX_PENDING = CANARD_CLIENT_MAX_PENDING>
+class AsyncClient : public HandlerList, public Sender {
+public:
+    /// @brief AsyncClient constructor
+    /// @param _interface Interface object
+    AsyncClient(Interface &_interface) NOINLINE_FUNC :
+    HandlerList(CanardTransferTypeResponse, rsptype::cxx_iface::ID, rsptype::cxx_iface::SIGNATURE, _interface.get_index()),
+    Sender(_interface) {
+        // link ourselves into the handler list
+        link();
+    }
+
+    // delete copy constructor and assignment operator
+    AsyncClient(const AsyncClient&) = delete;
+
+    // destructor
+    ~AsyncClient() NOINLINE_FUNC {
+        // unlink ourselves from the handler list
+        unlink();
+    }
+
+    /// @brief handles incoming responses to any of the outstanding requests
+    /// @param transfer transfer object of the response
+    bool handle_message(const CanardRxTransfer& transfer) override NOINLINE_FUNC {
+        for (uint8_t i = 0; i < MAX_PENDING; i++) {
+            Pending &p = pending[i];
+            if (p.cb == nullptr || p.destination_node_id != transfer.source_node_id ||
+                p.transfer_id != transfer.transfer_id) {
+                continue;
+            }
+            rsptype msg {};
+            if (rsptype::cxx_iface::rsp_decode(&transfer, &msg)) {
+                return false;
+            }
+            // free the slot first, so that the callback can make a new request
+            ResponseCallback<rsptype> *cb = p.cb;
+            p.cb = nullptr;
+            num_pending--;
+            cb->handle_response(transfer, msg);
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief makes service request, the deadline is now plus the timeout set on the client
+    /// @param destination_node_id node id of the server
+    /// @param msg message containing the request
+    /// @param cb callback for the response or the timeout, has to stay valid until either is reported
+    /// @param now_usec current time in microseconds, on the same clock as passed to process()
+    /// @return false if the request couldn't be queued or too many requests are outstanding
+    bool request(uint8_t destination_node_id, typename rsptype::cxx_iface::reqtype& msg, ResponseCallback<rsptype> &cb, uint64_t now_usec) {
+        return request(destination_node_id, msg, cb, now_usec, interface.is_canfd());
+    }
+
+    /// @brief makes service request with CAN FD option
+    /// @param destination_node_id node id of the server
+    /// @param msg message containing the request
+    /// @param cb callback for the response or the timeout, has to stay valid until either is reported
+    /// @param now_usec current time in microseconds, on the same clock as passed to process()
+    /// @param canfd true if CAN FD is to be used
+    /// @return false if the request couldn't be queued or too many requests are outstanding
+    bool request(uint8_t destination_node_id, typename rsptype::cxx_iface::reqtype& msg, ResponseCallback<rsptype> &cb, uint64_t now_usec, bool canfd) NOINLINE_FUNC {
+#if !CANARD_ENABLE_CANFD
+        if (canfd) {
+            return false;
+        }
+#endif
+        Pending* p = nullptr;
+        for (uint8_t i = 0; i < MAX_PENDING; i++) {
+            if (pending[i].cb == nullptr) {
+                p = &pending[i];
+                break;
+            }
+        }
+        if (p == nullptr) {
+            return false;
+        }
+        const uint8_t* tid_ptr = get_tid_ptr(rsptype::cxx_iface::ID, CanardTransferTypeRequest, destination_node_id);
+        if (tid_ptr == nullptr) {
+            return false;
+        }
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+        EncodeBuffer buffer(interface.get_index());
+        uint8_t* req_buf = buffer.data();
+        if (req_buf == nullptr) {
+            return false;
+        }
+#endif
+        // encode the message
+        uint32_t len = rsptype::cxx_iface::req_encode(&msg, req_buf
+#if CANARD_ENABLE_CANFD
+        , !canfd
+#elif CANARD_ENABLE_TAO_OPTION
+        , true
+#endif
+        );
+        Transfer req_transfer {};
+        req_transfer.transfer_type = CanardTransferTypeRequest;
+        req_transfer.data_type_id = rsptype::cxx_iface::ID;
+        req_transfer.data_type_signature = rsptype::cxx_iface::SIGNATURE;
+        req_transfer.payload = req_buf;
+        req_transfer.payload_len = len;
+#if CANARD_ENABLE_CANFD
+        req_transfer.canfd = canfd;
+#endif
+#if CANARD_MULTI_IFACE
+        req_transfer.iface_mask = CANARD_IFACE_ALL;
+#endif
+        // register the request before sending, the response may arrive before send() returns
+        p->destination_node_id = destination_node_id;
+        p->transfer_id = *tid_ptr;
+        p->deadline_usec = now_usec + (uint64_t)get_timeout_ms() * 1000U;
+        p->cb = &cb;
+        num_pending++;
+        if (!send(req_transfer, destination_node_id)) {
+            if (p->cb == &cb) {
+                p->cb = nullptr;
+                num_pending--;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief report the requests that passed their deadline as timed out
+    /// @param now_usec current time in microseconds
+    void process(uint64_t now_usec) NOINLINE_FUNC {
+        for (uint8_t i = 0; i < MAX_PENDING; i++) {
+            Pending &p = pending[i];
+            if (p.cb == nullptr || p.deadline_usec > now_usec) {
+                continue;
+            }
+            ResponseCallback<rsptype> *cb = p.cb;
+            p.cb = nullptr;
+            num_pending--;
+            cb->handle_timeout(p.destination_node_id);
+        }
+    }
+
+    /// @brief forget the outstanding requests of a callback without reporting them, e.g. before destroying it
+    /// @param cb callback passed to request()
+    void cancel(const ResponseCallback<rsptype> &cb) {
+        for (uint8_t i = 0; i < MAX_PENDING; i++) {
+            if (pending[i].cb == &cb) {
+                pending[i].cb = nullptr;
+                num_pending--;
+            }
+        }
+    }
+
+    /// @brief number of requests waiting for a response
+    uint8_t get_num_pending() const { return num_pending; }
+
+private:
+    /// @brief one outstanding request, the slot is free when cb is nullptr
+    struct Pending {
+        ResponseCallback<rsptype> *cb;
+        uint64_t deadline_usec;
+        uint8_t destination_node_id;
+        uint8_t transfer_id;
+    };
+
+    Pending pending[MAX_PENDING] {};
+    uint8_t num_pending = 0;
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+    static_assert(rsptype::cxx_iface::REQ_MAX_SIZE <= CANARD_CXX_ENCODE_BUFFER_SIZE, "CANARD_CXX_ENCODE_BUFFER_SIZE is too small for this request");
+#else
+    uint8_t req_buf[rsptype::cxx_iface::REQ_MAX_SIZE];
+#endif
+};
+
 } // namespace Canard
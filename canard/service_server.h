@@ -24,12 +24,33 @@
 #pragma once
 #include "handler_list.h"
 #include "interface.h"
+#include "callbacks.h"
+
+/*
+  the default number of requests a Server can defer the response to
+ */
+#ifndef CANARD_SERVER_MAX_DEFERRED
+#define CANARD_SERVER_MAX_DEFERRED 4U
+#endif
 
 namespace Canard {
 
+/// @brief context of a request that is answered after the callback returned, see Server::defer()
+struct ResponseToken {
+    uint8_t source_node_id; ///< node that made the request
+    uint8_t transfer_id; ///< transfer ID of the request
+    uint8_t priority; ///< priority of the request
+    bool canfd; ///< true if the request was CAN FD
+    uint8_t iface_mask; ///< interfaces to respond on
+    uint8_t slot; ///< entry in the table of deferred requests
+    uint8_t sequence; ///< tells a reused entry from the one the token was issued for
+};
+
 /// @brief Server class to handle service requests
 /// @tparam reqtype 
-template <typename reqtype>
+/// @tparam MAX_DEFERRED maximum number of requests with a deferred response
+/// @tparam Handler type of the callback, see Subscriber
+template <typename reqtype, uint8_t MAX_DEFERRED = CANARD_SERVER_MAX_DEFERRED, typename Handler = Callback<reqtype>&>
 class Server : public HandlerList {
 
 public:
@@ -37,7 +58,7 @@ public:
     /// @param _interface Interface object
     /// @param _cb Callback object
     /// @param _index HandlerList instance id
-    Server(Interface &_interface, Callback<reqtype> &_cb) NOINLINE_FUNC :
+    Server(Interface &_interface, Handler _cb) NOINLINE_FUNC :
     HandlerList(CanardTransferTypeRequest, reqtype::cxx_iface::ID, reqtype::cxx_iface::SIGNATURE, _interface.get_index()),
     interface(_interface),
     cb(_cb) {
@@ -57,7 +78,6 @@ public:
     bool handle_message(const CanardRxTransfer& transfer) override NOINLINE_FUNC {
         reqtype msg {};
         if (!reqtype::cxx_iface::req_decode(&transfer, &msg)) {
-            transfer_id = transfer.transfer_id;
             cb(transfer, msg);
             return true;
         }
@@ -69,22 +89,134 @@ public:
     /// @param msg message containing the response
     /// @return true if the response was put into the queue successfully
     bool respond(const CanardRxTransfer& transfer, typename reqtype::cxx_iface::rsptype& msg) NOINLINE_FUNC {
+        ResponseToken token {};
+        fill_token(transfer, token);
+        return send_response(token, msg);
+    }
+
+    /// @brief keep the context of a request to respond to it after the callback returned
+    /// @param transfer transfer object of the request, as passed to the callback
+    /// @param[out] token context to pass to respond() or cancel() later
+    /// @return false if too many responses are deferred already
+    bool defer(const CanardRxTransfer& transfer, ResponseToken &token) NOINLINE_FUNC {
+        for (uint8_t i = 0; i < MAX_DEFERRED; i++) {
+            Deferred &d = deferred[i];
+            if (d.used) {
+                continue;
+            }
+            d.used = true;
+            d.sequence++;
+            d.timestamp_usec = transfer.timestamp_usec;
+            num_deferred++;
+            fill_token(transfer, token);
+            token.slot = i;
+            token.sequence = d.sequence;
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Send the response to a deferred request
+    /// @param token context returned by defer()
+    /// @param msg message containing the response
+    /// @return false if the token expired, was used already or the response couldn't be queued
+    bool respond(const ResponseToken& token, typename reqtype::cxx_iface::rsptype& msg) NOINLINE_FUNC {
+        if (!release(token)) {
+            return false;
+        }
+        return send_response(token, msg);
+    }
+
+    /// @brief give up on a deferred request without responding
+    /// @param token context returned by defer()
+    void cancel(const ResponseToken& token) {
+        (void)release(token);
+    }
+
+    /// @brief drop the deferred requests the client has given up on, i.e. those older than the timeout
+    /// @param now_usec current time in microseconds, on the clock of the transfer timestamps
+    void process(uint64_t now_usec) NOINLINE_FUNC {
+        for (uint8_t i = 0; i < MAX_DEFERRED; i++) {
+            Deferred &d = deferred[i];
+            if (d.used && d.timestamp_usec + (uint64_t)timeout * 1000U <= now_usec) {
+                d.used = false;
+                num_deferred--;
+            }
+        }
+    }
+
+    /// @brief number of requests waiting for a deferred response
+    uint8_t get_num_deferred() const { return num_deferred; }
+
+    /// @brief Set the timeout for the response
+    /// @param _timeout timeout in milliseconds
+    void set_timeout_ms(uint32_t _timeout) {
+        timeout = _timeout;
+    }
+
+private:
+    /// @brief one request with a deferred response
+    struct Deferred {
+        bool used;
+        uint8_t sequence;
+        uint64_t timestamp_usec;
+    };
+
+    void fill_token(const CanardRxTransfer& transfer, ResponseToken &token) const {
+        token.source_node_id = transfer.source_node_id;
+        token.transfer_id = transfer.transfer_id;
+        token.priority = transfer.priority;
+#if CANARD_ENABLE_CANFD
+        token.canfd = transfer.canfd;
+#else
+        token.canfd = false;
+#endif
+#if CANARD_MULTI_IFACE
+        token.iface_mask = iface_mask;
+#else
+        token.iface_mask = CANARD_IFACE_ALL;
+#endif
+    }
+
+    bool release(const ResponseToken& token) {
+        if (token.slot >= MAX_DEFERRED) {
+            return false;
+        }
+        Deferred &d = deferred[token.slot];
+        if (!d.used || d.sequence != token.sequence) {
+            return false;
+        }
+        d.used = false;
+        num_deferred--;
+        return true;
+    }
+
+    bool send_response(const ResponseToken& token, typename reqtype::cxx_iface::rsptype& msg) NOINLINE_FUNC {
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+        EncodeBuffer buffer(interface.get_index());
+        uint8_t* rsp_buf = buffer.data();
+        if (rsp_buf == nullptr) {
+            return false;
+        }
+#endif
         // encode the message
         uint32_t len = reqtype::cxx_iface::rsp_encode(&msg, rsp_buf
 #if CANARD_ENABLE_CANFD
-        , !transfer.canfd
+        , !token.canfd
 #elif CANARD_ENABLE_TAO_OPTION
         , true
 #endif
         );
         // send the message if encoded successfully
         if (len > 0) {
+            // responses carry the transfer ID of the request
+            uint8_t transfer_id = token.transfer_id;
             Transfer rsp_transfer;
 #if CANARD_ENABLE_CANFD
-            rsp_transfer.canfd = transfer.canfd;
+            rsp_transfer.canfd = token.canfd;
 #endif
 #if CANARD_MULTI_IFACE
-            rsp_transfer.iface_mask = iface_mask;
+            rsp_transfer.iface_mask = token.iface_mask;
 #endif
             rsp_transfer.transfer_type = CanardTransferTypeResponse;
             rsp_transfer.inout_transfer_id = &transfer_id;
@@ -92,29 +224,31 @@ public:
             rsp_transfer.data_type_signature = reqtype::cxx_iface::SIGNATURE;
             rsp_transfer.payload = rsp_buf;
             rsp_transfer.payload_len = len;
-            rsp_transfer.priority = transfer.priority;
+            rsp_transfer.priority = token.priority;
             rsp_transfer.timeout_ms = timeout;
-            return interface.respond(transfer.source_node_id, rsp_transfer);
+            return interface.respond(token.source_node_id, rsp_transfer);
         }
         return false;
     }
 
-    /// @brief Set the timeout for the response
-    /// @param _timeout timeout in milliseconds
-    void set_timeout_ms(uint32_t _timeout) {
-        timeout = _timeout;
-    }
-
-private:
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+    static_assert(reqtype::cxx_iface::RSP_MAX_SIZE <= CANARD_CXX_ENCODE_BUFFER_SIZE, "CANARD_CXX_ENCODE_BUFFER_SIZE is too small for this response");
+#else
     uint8_t rsp_buf[reqtype::cxx_iface::RSP_MAX_SIZE];
+#endif
     Interface &interface;
-    Callback<reqtype> &cb;
+    Handler cb;
 
     uint32_t timeout = 1000;
-    uint8_t transfer_id = 0;
 #if CANARD_MULTI_IFACE
     uint8_t iface_mask = CANARD_IFACE_ALL;
 #endif
+    Deferred deferred[MAX_DEFERRED] {};
+    uint8_t num_deferred = 0;
 };
 
+/// @brief Server with a callback type known at compile time
+template <typename reqtype, typename Handler>
+using InlineServer = Server<reqtype, CANARD_SERVER_MAX_DEFERRED, Handler>;
+
 } // namespace Canard
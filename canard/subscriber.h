@@ -30,19 +30,68 @@
 
 namespace Canard {
 
-/// @brief Class to handle broadcast messages
-/// @tparam msgtype 
+/// @brief tag shared by all subscribers to one message type, whatever their callback type
+/// @tparam msgtype type of the message
+template <typename msgtype>
+struct DecodeGroup {
+    static const char tag;
+};
+
 template <typename msgtype>
-class Subscriber : public HandlerList {
+const char DecodeGroup<msgtype>::tag = 0;
+
+/// @brief Base of all subscribers to a message type, through which the subscribers of
+/// a decode group call each other's callbacks
+/// @tparam msgtype type of the message
+template <typename msgtype>
+class SubscriberBase : public HandlerList {
+public:
+    SubscriberBase(uint8_t _index) :
+    HandlerList(CanardTransferTypeBroadcast, msgtype::cxx_iface::ID, msgtype::cxx_iface::SIGNATURE, _index) {}
+
+    /// @brief call the callback with a message decoded by another subscriber of the group
+    /// @param transfer transfer object
+    /// @param msg decoded message
+    virtual void call(const CanardRxTransfer& transfer, const msgtype& msg) = 0;
+
+    /// @brief subscribers of the same message type share one decode per transfer
+    const void* decode_group() const override {
+        return &DecodeGroup<msgtype>::tag;
+    }
+
+protected:
+    /// @brief take the subscribers to the same message type that follow in the run, and call
+    /// them with the message if it was decoded
+    /// @param transfer transfer object
+    /// @param run handlers that haven't been called for this transfer yet
+    /// @param msg decoded message, nullptr if it failed to decode
+    void call_group(const CanardRxTransfer& transfer, HandlerRun& run, const msgtype* msg) {
+        while (run.peek() != nullptr && run.peek()->decode_group() == decode_group()) {
+            // only a SubscriberBase<msgtype> returns this group
+            SubscriberBase* sub = static_cast<SubscriberBase*>(run.next());
+            if (msg != nullptr) {
+                sub->call(transfer, *msg);
+            }
+        }
+    }
+};
+
+/// @brief Class to handle broadcast messages. All subscribers to the same message
+/// type on an interface are served from a single decode of each transfer
+/// @tparam msgtype 
+/// @tparam Handler type of the callback. By default a reference to a Callback object, called
+/// virtually; a functor type such as MethodHandler is stored by value and can be inlined
+template <typename msgtype, typename Handler = Callback<msgtype>&>
+class Subscriber : public SubscriberBase<msgtype> {
 public:
     /// @brief Subscriber Constructor
     /// @param _cb callback function
     /// @param _index HandlerList instance id
-    Subscriber(Callback<msgtype> &_cb, uint8_t _index) NOINLINE_FUNC :
-    HandlerList(CanardTransferTypeBroadcast, msgtype::cxx_iface::ID, msgtype::cxx_iface::SIGNATURE, _index),
+    Subscriber(Handler _cb, uint8_t _index) NOINLINE_FUNC :
+    SubscriberBase<msgtype>(_index),
     cb (_cb) {
         // link ourselves into the handler list
-        link();
+        this->link();
     }
 
     // delete copy constructor and assignment operator
@@ -51,7 +100,7 @@ public:
     // destructor, remove the entry from the singly-linked list
     ~Subscriber() NOINLINE_FUNC {
         // unlink ourselves from the handler list
-        unlink();
+        this->unlink();
     }
 
     /// @brief parse the message and call the callback
@@ -65,10 +114,34 @@ public:
         return false;
     }
 
+    void call(const CanardRxTransfer& transfer, const msgtype& msg) override {
+        cb(transfer, msg);
+    }
+
+protected:
+    /// @brief decode the message once and call our callback as well as those of the
+    /// subscribers to the same message type that follow us
+    /// @param transfer transfer object
+    /// @param run handlers that haven't been called for this transfer yet
+    bool handle_run(const CanardRxTransfer& transfer, HandlerList::HandlerRun& run) override NOINLINE_FUNC {
+        msgtype msg {};
+        const bool decoded = !msgtype::cxx_iface::decode(&transfer, &msg);
+        if (decoded) {
+            cb(transfer, msg);
+        }
+        this->call_group(transfer, run, decoded ? &msg : nullptr);
+        return decoded;
+    }
+
 private:
-    Callback<msgtype> &cb;
+    Handler cb;
 };
 
+/// @brief Subscriber with a callback type known at compile time, e.g.
+/// InlineSubscriber<msgtype, MethodHandler<T, msgtype, &T::method>> sub{MethodHandler<...>{this}, index};
+template <typename msgtype, typename Handler>
+using InlineSubscriber = Subscriber<msgtype, Handler>;
+
 template <typename T, typename msgtype>
 class SubscriberArgCb {
 public:
@@ -0,0 +1,84 @@
+/*
+ * Measures the cost of HandlerList::accept_message() followed by HandlerList::handle_message() as the number of
+ * registered handlers grows. Not part of the test suite; run the binary directly.
+ */
+#include "common.h"
+#include <canard/handler_list.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Canard;
+
+DEFINE_HANDLER_LIST_HEADS();
+
+namespace {
+
+class NopHandler : public HandlerList {
+public:
+    NopHandler(CanardTransferType _transfer_type, uint16_t _msgid) :
+    HandlerList(_transfer_type, _msgid, _msgid, 0) {
+        link();
+    }
+    ~NopHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        calls++;
+        return true;
+    }
+    static uint32_t calls;
+};
+
+uint32_t NopHandler::calls;
+
+CanardTransferType transfer_type_of(uint32_t i) {
+    return (i % 3U == 0U) ? CanardTransferTypeBroadcast :
+           (i % 3U == 1U) ? CanardTransferTypeRequest : CanardTransferTypeResponse;
+}
+
+uint16_t msgid_of(uint32_t i) {
+    // spread the IDs like real data types, which are far from contiguous
+    return (uint16_t)((i * 1031U) % 20000U);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const uint32_t iterations = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1000000U;
+    const uint32_t handler_counts[] = { 8, 16, 32, 64, 128 };
+
+    printf("table_size=%u\n", (unsigned)CANARD_HANDLER_TABLE_SIZE);
+    for (const uint32_t num_handlers : handler_counts) {
+        std::vector<NopHandler*> handlers;
+        for (uint32_t i = 0; i < num_handlers; i++) {
+            handlers.push_back(new NopHandler(transfer_type_of(i), msgid_of(i)));
+        }
+
+        NopHandler::calls = 0;
+        const auto started = std::chrono::steady_clock::now();
+        for (uint32_t n = 0; n < iterations; n++) {
+            // every handler is hit in turn, with a miss every fourth transfer
+            const uint32_t i = (n * 11U) % (num_handlers + num_handlers / 3U);
+            CanardRxTransfer transfer {};
+            transfer.data_type_id = (i < num_handlers) ? msgid_of(i) : (uint16_t)(20001U + i);
+            transfer.transfer_type = (uint8_t)transfer_type_of(i);
+            uint64_t signature = 0;
+            if (HandlerList::accept_message(0, transfer.data_type_id, (CanardTransferType)transfer.transfer_type,
+                                            signature)) {
+                HandlerList::handle_message(0, transfer);
+            }
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        printf("handlers=%3u accept+dispatch=%.1f ns (%u dispatched)\n",
+               (unsigned)num_handlers, ns / iterations, (unsigned)NopHandler::calls);
+
+        for (NopHandler* handler : handlers) {
+            delete handler;
+        }
+    }
+    return 0;
+}
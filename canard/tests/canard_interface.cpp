@@ -6,10 +6,29 @@
 
 using namespace Canard;
 
-void CanardInterface::init(void* mem_arena, size_t mem_arena_size) {
+void CanardInterface::init(void* mem_arena, size_t mem_arena_size, size_t cxx_pool_size) {
+    // keep the part left for libcanard aligned
+    cxx_pool_size = (cxx_pool_size + alignof(max_align_t) - 1U) & ~(alignof(max_align_t) - 1U);
+    if (cxx_pool_size > 0 && cxx_pool_size < mem_arena_size &&
+        BlockAllocator::get_default().add_arena(mem_arena, cxx_pool_size) > 0) {
+        cxx_pool_arena = mem_arena;
+        mem_arena = (uint8_t*)mem_arena + cxx_pool_size;
+        mem_arena_size -= cxx_pool_size;
+    }
     canardInit(&canard, mem_arena, mem_arena_size, onTransferReception, shouldAcceptTransfer, this);
 }
 
+bool CanardInterface::release_cxx_pool() {
+    if (cxx_pool_arena == nullptr) {
+        return true;
+    }
+    if (!BlockAllocator::get_default().remove_arena(cxx_pool_arena)) {
+        return false;
+    }
+    cxx_pool_arena = nullptr;
+    return true;
+}
+
 bool CanardInterface::broadcast(const Transfer &bcast_transfer) {
 #if CANARD_ENABLE_DEADLINE
     // get current time in microseconds
@@ -17,7 +17,15 @@ public:
     CanardInterface& operator=(const CanardInterface&) = delete;
     CanardInterface() = delete;
 
-    void init(void* mem_arena, size_t mem_arena_size);
+    /// @brief initialise the canard instance
+    /// @param mem_arena memory for libcanard
+    /// @param mem_arena_size size of the memory
+    /// @param cxx_pool_size bytes at the start of the arena to give to the pool of Canard::allocate()
+    void init(void* mem_arena, size_t mem_arena_size, size_t cxx_pool_size = 0);
+
+    /// @brief take the arena shared in init() back from the pool of Canard::allocate()
+    /// @return false if objects are still allocated from it
+    bool release_cxx_pool();
 
     /// @brief broadcast message to all listeners on Interface
     /// @param bc_transfer
@@ -50,6 +58,9 @@ public:
     uint8_t get_node_id() const override { return canard.node_id; }
 
     CanardInstance canard {};
+
+private:
+    void* cxx_pool_arena = nullptr;
 };
 
 class CanardTestInterface;
@@ -7,6 +7,8 @@
 #include <canard/service_server.h>
 #include <canard/service_client.h>
 #include <time.h>
+#include <thread>
+#include <vector>
 
 DEFINE_HANDLER_LIST_HEADS();
 DEFINE_TRANSFER_OBJECT_HEADS();
@@ -320,4 +322,121 @@ TEST(StaticCanardTest, test_CleanupStaleTransfers)
 }
 #endif
 
+///////////// TESTS for the allocation pool //////////////
+static uint32_t pooled_node_status_calls;
+static void handle_pooled_node_status(const CanardRxTransfer &transfer, const uavcan_protocol_NodeStatus &msg) {
+    (void)transfer;
+    (void)msg;
+    pooled_node_status_calls++;
+}
+
+class PooledClient {
+public:
+    void handle_response(const CanardRxTransfer &transfer, const uavcan_protocol_GetNodeInfoResponse &res) {
+        (void)transfer;
+        (void)res;
+    }
+};
+
+TEST(StaticCanardTest, test_no_heap_after_startup) {
+    CANARD_TEST_INTERFACE_DEFINE(0);
+    CANARD_TEST_INTERFACE_DEFINE(1);
+    // share the first 2kB of each arena with the C++ objects
+    uint8_t buffer0[8192] {};
+    uint8_t buffer1[8192] {};
+    CANARD_TEST_INTERFACE(0).init(buffer0, sizeof(buffer0), 2048);
+    CANARD_TEST_INTERFACE(1).init(buffer1, sizeof(buffer1), 2048);
+    CANARD_TEST_INTERFACE(0).set_node_id(1);
+    CANARD_TEST_INTERFACE(1).set_node_id(2);
+
+    // startup: everything the node will ever need is allocated here
+    const BlockAllocator::Statistics before_startup = BlockAllocator::get_default().get_statistics();
+    ASSERT_GE(before_startup.capacity_blocks, 2U * (2048U / BlockAllocator::BLOCK_SIZE));
+    auto sub0 = allocate_sub_static_callback(&handle_pooled_node_status, 1);
+    auto sub1 = allocate_sub_static_callback(&handle_pooled_node_status, 1);
+    PooledClient client_obj;
+    auto client_cb = allocate_obj_callback(&client_obj, &PooledClient::handle_response);
+    ASSERT_NE(sub0, nullptr);
+    ASSERT_NE(sub1, nullptr);
+    ASSERT_NE(client_cb, nullptr);
+    Client<uavcan_protocol_GetNodeInfoResponse> client(CANARD_TEST_INTERFACE(0), *client_cb);
+    Publisher<uavcan_protocol_NodeStatus> node_status_pub(CANARD_TEST_INTERFACE(0));
+    const BlockAllocator::Statistics after_startup = BlockAllocator::get_default().get_statistics();
+    ASSERT_EQ(after_startup.total_heap_allocations, before_startup.total_heap_allocations);
+    ASSERT_EQ(after_startup.used_blocks, before_startup.used_blocks + 3U);
+
+    // run: publish, and request from more nodes than the transfer ID table holds
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t timestamp = (uint64_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+    uavcan_protocol_NodeStatus msg {};
+    pooled_node_status_calls = 0;
+    for (uint8_t i = 0; i < 50; i++) {
+        ASSERT_TRUE(node_status_pub.broadcast(msg));
+        CANARD_TEST_INTERFACE(0).update_tx(timestamp);
+    }
+    ASSERT_EQ(pooled_node_status_calls, 100U);
+    uavcan_protocol_GetNodeInfoRequest req {};
+    for (uint8_t node_id = 3; node_id < 3U + CANARD_TRANSFER_OBJECT_TABLE_SIZE + 4U; node_id++) {
+        ASSERT_TRUE(client.request(node_id, req));
+        CANARD_TEST_INTERFACE(0).update_tx(timestamp);
+    }
+
+    const BlockAllocator::Statistics after_run = BlockAllocator::get_default().get_statistics();
+    ASSERT_EQ(after_run.total_heap_allocations, before_startup.total_heap_allocations);
+    ASSERT_EQ(after_run.failed_allocations, before_startup.failed_allocations);
+    // the transfer IDs that didn't fit into the table came from the pool
+    ASSERT_GT(after_run.used_blocks, after_startup.used_blocks);
+
+    CANARD_TEST_INTERFACE(0).free();
+    CANARD_TEST_INTERFACE(1).free();
+    deallocate(sub0);
+    deallocate(sub1);
+    ASSERT_EQ(BlockAllocator::get_default().get_statistics().used_blocks, before_startup.used_blocks + 1U);
+    deallocate(client_cb);
+    ASSERT_EQ(BlockAllocator::get_default().get_statistics().used_blocks, before_startup.used_blocks);
+    ASSERT_TRUE(CANARD_TEST_INTERFACE(0).release_cxx_pool());
+    ASSERT_TRUE(CANARD_TEST_INTERFACE(1).release_cxx_pool());
+    ASSERT_EQ(BlockAllocator::get_default().get_statistics().capacity_blocks, before_startup.capacity_blocks - 2U * (2048U / BlockAllocator::BLOCK_SIZE));
+}
+
+// interfaces served from different threads share the pool
+TEST(StaticCanardTest, test_block_allocator_threads) {
+    static const uint32_t NUM_THREADS = 4;
+    static const uint32_t ITERATIONS = 20000;
+    alignas(max_align_t) static uint8_t arena[8 * BlockAllocator::BLOCK_SIZE];
+    BlockAllocator pool;
+    ASSERT_EQ(pool.add_arena(arena, sizeof(arena)), 8U);
+
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> collisions(NUM_THREADS, 0);
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&pool, &collisions, t]() {
+            for (uint32_t i = 0; i < ITERATIONS; i++) {
+                uint8_t* block = (uint8_t*)pool.allocate(BlockAllocator::BLOCK_SIZE);
+                if (block == nullptr) {
+                    continue;
+                }
+                // a block handed out twice gets overwritten by the other thread
+                memset(block, (int)t, BlockAllocator::BLOCK_SIZE);
+                std::this_thread::yield();
+                for (size_t j = 0; j < BlockAllocator::BLOCK_SIZE; j++) {
+                    collisions[t] += (block[j] != (uint8_t)t) ? 1U : 0U;
+                }
+                ASSERT_TRUE(pool.deallocate(block));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        ASSERT_EQ(collisions[t], 0U);
+    }
+    const BlockAllocator::Statistics stats = pool.get_statistics();
+    ASSERT_EQ(stats.used_blocks, 0U);
+    ASSERT_LE(stats.peak_used_blocks, 8U);
+    ASSERT_TRUE(pool.remove_arena(arena));
+}
+
 } // namespace StaticCanardTest
\ No newline at end of file
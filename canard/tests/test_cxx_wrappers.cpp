@@ -151,6 +151,147 @@ TEST(StaticCoreTest, test_multiple_subscribers) {
     ASSERT_EQ(TestSubscriber0::call_counts, 5);
 }
 
+///////////// TESTS for encode buffers //////////////
+static uint32_t encoded_node_status_calls;
+static void handle_encoded_node_status(const CanardRxTransfer &transfer, const uavcan_protocol_NodeStatus &msg) {
+    (void)transfer;
+    ASSERT_EQ(msg.uptime_sec, 77U);
+    encoded_node_status_calls++;
+}
+
+TEST(StaticCoreTest, test_broadcast_encoded) {
+    CXX_TEST_INTERFACE(0).set_node_id(1);
+    CXX_TEST_INTERFACE(1).set_node_id(2);
+    StaticCallback<uavcan_protocol_NodeStatus> cb(handle_encoded_node_status);
+    Subscriber<uavcan_protocol_NodeStatus> sub(cb, 1);
+    Publisher<uavcan_protocol_NodeStatus> pub(CXX_TEST_INTERFACE(0));
+
+    // encode once, e.g. to send the same message on several interfaces
+    uavcan_protocol_NodeStatus msg {};
+    msg.uptime_sec = 77;
+    uint8_t buf[uavcan_protocol_NodeStatus::cxx_iface::MAX_SIZE];
+    const uint32_t len = uavcan_protocol_NodeStatus::cxx_iface::encode(&msg, buf
+#if CANARD_ENABLE_CANFD
+        , true
+#elif CANARD_ENABLE_TAO_OPTION
+        , true
+#endif
+        );
+    encoded_node_status_calls = 0;
+    ASSERT_TRUE(pub.broadcast(buf, len));
+    ASSERT_TRUE(pub.broadcast(buf, len));
+    ASSERT_EQ(encoded_node_status_calls, 2U);
+
+#if CANARD_CXX_SHARED_ENCODE_BUFFER
+    // no per-object buffer for the largest response
+    ASSERT_LT(sizeof(Server<uavcan_protocol_GetNodeInfoRequest>), (size_t)uavcan_protocol_GetNodeInfoRequest::cxx_iface::RSP_MAX_SIZE);
+    {
+        // with every buffer of the interface taken, encoding fails
+        static_assert(CANARD_CXX_ENCODE_BUFFERS == 2, "test expects two buffers");
+        EncodeBuffer taken0(0);
+        EncodeBuffer taken1(0);
+        ASSERT_NE(taken1.data(), nullptr);
+        ASSERT_FALSE(pub.broadcast(msg));
+        // other interfaces have their own buffers
+        Publisher<uavcan_protocol_NodeStatus> pub1(CXX_TEST_INTERFACE(1));
+        ASSERT_TRUE(pub1.broadcast(msg));
+    }
+    ASSERT_TRUE(pub.broadcast(msg));
+    ASSERT_EQ(encoded_node_status_calls, 3U);
+#endif
+    CXX_TEST_INTERFACE(0).free();
+    CXX_TEST_INTERFACE(1).free();
+}
+
+TEST(StaticCoreTest, test_coalescing_publisher) {
+    CXX_TEST_INTERFACE(0).set_node_id(1);
+    CXX_TEST_INTERFACE(1).set_node_id(2);
+    StaticCallback<uavcan_protocol_NodeStatus> cb(handle_encoded_node_status);
+    Subscriber<uavcan_protocol_NodeStatus> sub(cb, 1);
+    CoalescingPublisher<uavcan_protocol_NodeStatus> pub(CXX_TEST_INTERFACE(0), 1000);
+    uavcan_protocol_NodeStatus msg {};
+    msg.uptime_sec = 77;
+    encoded_node_status_calls = 0;
+
+    // publishing at 10 kHz with a 1 kHz limit: the first goes out, the rest of the millisecond coalesces
+    for (uint64_t now = 0; now < 1000; now += 100) {
+        ASSERT_TRUE(pub.publish(msg, now));
+    }
+    ASSERT_EQ(encoded_node_status_calls, 1U);
+    ASSERT_TRUE(pub.is_pending());
+    ASSERT_EQ(pub.get_statistics().coalesced, 8U);
+
+    // the latest message goes out once the interval has passed
+    pub.update(999);
+    ASSERT_EQ(encoded_node_status_calls, 1U);
+    pub.update(1000);
+    ASSERT_EQ(encoded_node_status_calls, 2U);
+    ASSERT_FALSE(pub.is_pending());
+    pub.update(5000);
+    ASSERT_EQ(encoded_node_status_calls, 2U);
+    // after a pause a message is sent right away
+    ASSERT_TRUE(pub.publish(msg, 5000));
+    ASSERT_EQ(encoded_node_status_calls, 3U);
+    ASSERT_EQ(pub.get_statistics().sent, 3U);
+    ASSERT_EQ(pub.get_statistics().dropped, 0U);
+    CXX_TEST_INTERFACE(0).free();
+    CXX_TEST_INTERFACE(1).free();
+}
+
+///////////// TESTS for callbacks known at compile time //////////////
+class InlineNode {
+public:
+    InlineNode(Interface &_interface) :
+        node_status_sub(MethodHandler<InlineNode, uavcan_protocol_NodeStatus, &InlineNode::handle_node_status>{this}, _interface.get_index()),
+        server(_interface, MethodHandler<InlineNode, uavcan_protocol_GetNodeInfoRequest, &InlineNode::handle_request>{this}) {}
+
+    void handle_node_status(const CanardRxTransfer &transfer, const uavcan_protocol_NodeStatus &msg) {
+        (void)transfer;
+        ASSERT_EQ(msg.uptime_sec, 42U);
+        node_status_calls++;
+    }
+    void handle_request(const CanardRxTransfer &transfer, const uavcan_protocol_GetNodeInfoRequest &req) {
+        (void)req;
+        uavcan_protocol_GetNodeInfoResponse res {};
+        res.status.uptime_sec = 43;
+        server.respond(transfer, res);
+    }
+    uint32_t node_status_calls = 0;
+    InlineSubscriber<uavcan_protocol_NodeStatus, MethodHandler<InlineNode, uavcan_protocol_NodeStatus, &InlineNode::handle_node_status>> node_status_sub;
+    InlineServer<uavcan_protocol_GetNodeInfoRequest, MethodHandler<InlineNode, uavcan_protocol_GetNodeInfoRequest, &InlineNode::handle_request>> server;
+};
+
+struct CountingFunctor {
+    uint32_t *calls;
+    uint32_t uptime_sec;
+    template <typename msgtype>
+    void operator()(const CanardRxTransfer &transfer, const msgtype &msg) const {
+        (void)transfer;
+        ASSERT_EQ(msg.status.uptime_sec, uptime_sec);
+        (*calls)++;
+    }
+};
+
+TEST(StaticCoreTest, test_inline_handlers) {
+    CXX_TEST_INTERFACE(0).set_node_id(1);
+    CXX_TEST_INTERFACE(1).set_node_id(2);
+    InlineNode node(CXX_TEST_INTERFACE(1));
+    uint32_t response_calls = 0;
+    InlineClient<uavcan_protocol_GetNodeInfoResponse, CountingFunctor> client(CXX_TEST_INTERFACE(0), CountingFunctor{&response_calls, 43});
+
+    Publisher<uavcan_protocol_NodeStatus> node_status_pub(CXX_TEST_INTERFACE(0));
+    uavcan_protocol_NodeStatus msg {};
+    msg.uptime_sec = 42;
+    ASSERT_TRUE(node_status_pub.broadcast(msg));
+    ASSERT_EQ(node.node_status_calls, 1U);
+
+    uavcan_protocol_GetNodeInfoRequest req {};
+    ASSERT_TRUE(client.request(2, req));
+    ASSERT_EQ(response_calls, 1U);
+    CXX_TEST_INTERFACE(0).free();
+    CXX_TEST_INTERFACE(1).free();
+}
+
 //////////// TESTS FOR SERVICE //////////////
 
 // test single server single client
@@ -226,6 +367,125 @@ void handle_get_node_info_request1(const CanardRxTransfer &transfer, const uavca
     get_node_info_server1.respond(transfer, res);
 }
 
+class AsyncRequester {
+public:
+    void handle_response(const CanardRxTransfer &transfer, const uavcan_protocol_GetNodeInfoResponse &res) {
+        ASSERT_EQ(transfer.source_node_id, 2);
+        ASSERT_EQ(res.status.uptime_sec, 1);
+        responses++;
+    }
+    void handle_timeout(uint8_t destination_node_id) {
+        timed_out_nodes[timeouts++] = destination_node_id;
+    }
+    uint32_t responses;
+    uint32_t timeouts;
+    uint8_t timed_out_nodes[8];
+    ObjResponseCallback<AsyncRequester, uavcan_protocol_GetNodeInfoResponse> cb{this, &AsyncRequester::handle_response, &AsyncRequester::handle_timeout};
+};
+
+TEST(StaticCoreTest, test_async_client) {
+    AsyncClient<uavcan_protocol_GetNodeInfoResponse, 4> client(CXX_TEST_INTERFACE(0));
+    client.set_timeout_ms(100);
+    CXX_TEST_INTERFACE(0).set_node_id(1);
+    CXX_TEST_INTERFACE(1).set_node_id(2);
+
+    AsyncRequester requester {};
+    uavcan_protocol_GetNodeInfoRequest req {};
+    // node 2 answers right away
+    ASSERT_TRUE(client.request(2, req, requester.cb, 1000));
+    ASSERT_EQ(requester.responses, 1U);
+    ASSERT_EQ(client.get_num_pending(), 0U);
+
+    // nobody answers for the other nodes, and only four requests fit
+    for (uint8_t node_id = 10; node_id < 14; node_id++) {
+        ASSERT_TRUE(client.request(node_id, req, requester.cb, 1000U + node_id * 10000U));
+    }
+    ASSERT_FALSE(client.request(14, req, requester.cb, 1000));
+    ASSERT_EQ(client.get_num_pending(), 4U);
+    // node 2 answering the requests to the other nodes doesn't complete them
+    ASSERT_EQ(requester.responses, 1U);
+
+    // the deadlines are 100ms after each request
+    client.process(1000U + 11U * 10000U + 100000U);
+    ASSERT_EQ(requester.timeouts, 2U);
+    ASSERT_EQ(requester.timed_out_nodes[0], 10U);
+    ASSERT_EQ(requester.timed_out_nodes[1], 11U);
+    ASSERT_EQ(client.get_num_pending(), 2U);
+
+    // freed slots take new requests
+    ASSERT_TRUE(client.request(2, req, requester.cb, 2000000U));
+    ASSERT_EQ(requester.responses, 2U);
+
+    client.cancel(requester.cb);
+    ASSERT_EQ(client.get_num_pending(), 0U);
+    client.process(UINT64_MAX);
+    ASSERT_EQ(requester.timeouts, 2U);
+    CXX_TEST_INTERFACE(0).free();
+    CXX_TEST_INTERFACE(1).free();
+}
+
+class DeferringServer {
+public:
+    DeferringServer(Interface &_interface) : server(_interface, server_cb) {}
+    void handle_request(const CanardRxTransfer &transfer, const uavcan_protocol_GetNodeInfoRequest &req) {
+        (void)req;
+        if (num_tokens < 4 && server.defer(transfer, tokens[num_tokens])) {
+            num_tokens++;
+            return;
+        }
+        // too busy to defer, answer right away
+        uavcan_protocol_GetNodeInfoResponse res {};
+        res.status.uptime_sec = 1;
+        server.respond(transfer, res);
+    }
+    ResponseToken tokens[4] {};
+    uint8_t num_tokens = 0;
+    ObjCallback<DeferringServer, uavcan_protocol_GetNodeInfoRequest> server_cb{this, &DeferringServer::handle_request};
+    Server<uavcan_protocol_GetNodeInfoRequest, 2> server;
+};
+
+TEST(StaticCoreTest, test_deferred_response) {
+    CXX_TEST_INTERFACE(0).set_node_id(1);
+    CXX_TEST_INTERFACE(1).set_node_id(2);
+    DeferringServer deferring(CXX_TEST_INTERFACE(1));
+    AsyncClient<uavcan_protocol_GetNodeInfoResponse> client(CXX_TEST_INTERFACE(0));
+    AsyncRequester requester {};
+    uavcan_protocol_GetNodeInfoRequest req {};
+
+    // two requests are deferred, the third one is answered right away
+    for (uint8_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(client.request(2, req, requester.cb, 0));
+    }
+    ASSERT_EQ(deferring.num_tokens, 2U);
+    ASSERT_EQ(deferring.server.get_num_deferred(), 2U);
+    ASSERT_EQ(requester.responses, 1U);
+    ASSERT_EQ(client.get_num_pending(), 2U);
+    ASSERT_EQ(deferring.tokens[0].source_node_id, 1U);
+
+    // complete them out of order
+    uavcan_protocol_GetNodeInfoResponse res {};
+    res.status.uptime_sec = 1;
+    ASSERT_TRUE(deferring.server.respond(deferring.tokens[1], res));
+    ASSERT_TRUE(deferring.server.respond(deferring.tokens[0], res));
+    ASSERT_EQ(requester.responses, 3U);
+    ASSERT_EQ(client.get_num_pending(), 0U);
+    ASSERT_EQ(deferring.server.get_num_deferred(), 0U);
+    // a token can only be used once
+    ASSERT_FALSE(deferring.server.respond(deferring.tokens[0], res));
+
+    // deferred requests expire with the server timeout
+    deferring.num_tokens = 0;
+    ASSERT_TRUE(client.request(2, req, requester.cb, 0));
+    ASSERT_EQ(deferring.server.get_num_deferred(), 1U);
+    deferring.server.set_timeout_ms(10);
+    deferring.server.process(UINT64_MAX / 2U);
+    ASSERT_EQ(deferring.server.get_num_deferred(), 0U);
+    ASSERT_FALSE(deferring.server.respond(deferring.tokens[0], res));
+    client.cancel(requester.cb);
+    CXX_TEST_INTERFACE(0).free();
+    CXX_TEST_INTERFACE(1).free();
+}
+
 TEST(StaticCoreTest, test_service) {
     // create client for service uavcan_protocol_GetNodeInfo on interface CoreTestInterface
     // with response callback function handle_get_node_info_response
@@ -396,4 +656,207 @@ TEST(StaticCoreTest, test_multiple_clients) {
     CXX_TEST_INTERFACE(1).free();
 }
 
+///////////// TESTS for the HandlerList dispatch table //////////////
+class CountingHandler : public HandlerList {
+public:
+    CountingHandler(CanardTransferType _transfer_type, uint16_t _msgid) :
+    HandlerList(_transfer_type, _msgid, 1000U + _msgid, 2) {
+        link();
+    }
+    ~CountingHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        calls++;
+        return true;
+    }
+    uint32_t calls;
+};
+
+TEST(StaticCoreTest, test_handler_dispatch_table) {
+    // more keys than the table holds, so some of them end up in the overflow list
+    static const uint16_t NUM_KEYS = CANARD_HANDLER_TABLE_SIZE + 8U;
+    CountingHandler* handlers[NUM_KEYS];
+    for (uint16_t i = 0; i < NUM_KEYS; i++) {
+        // register in a scattered order, alternating between broadcasts and requests
+        const uint16_t msgid = (uint16_t)((i * 37U) % 1000U);
+        handlers[i] = new CountingHandler((i % 2U) ? CanardTransferTypeRequest : CanardTransferTypeBroadcast, msgid);
+        handlers[i]->calls = 0;
+    }
+    // a second subscriber to a key in the table and one in the overflow list
+    CountingHandler extra_table(CanardTransferTypeBroadcast, 0);
+    CountingHandler extra_overflow(CanardTransferTypeRequest, (uint16_t)(((NUM_KEYS - 1U) * 37U) % 1000U));
+    extra_table.calls = 0;
+    extra_overflow.calls = 0;
+
+    for (uint16_t i = 0; i < NUM_KEYS; i++) {
+        const uint16_t msgid = (uint16_t)((i * 37U) % 1000U);
+        const CanardTransferType transfer_type = (i % 2U) ? CanardTransferTypeRequest : CanardTransferTypeBroadcast;
+        uint64_t signature = 0;
+        ASSERT_TRUE(HandlerList::accept_message(2, msgid, transfer_type, signature));
+        ASSERT_EQ(signature, 1000U + msgid);
+        CanardRxTransfer transfer {};
+        transfer.data_type_id = msgid;
+        transfer.transfer_type = (uint8_t)transfer_type;
+        HandlerList::handle_message(2, transfer);
+        // the request handler registered last takes the request of the last key
+        ASSERT_EQ(handlers[i]->calls, (i == NUM_KEYS - 1U) ? 0U : 1U);
+    }
+    // both broadcast subscribers are called
+    ASSERT_EQ(extra_table.calls, 1U);
+    ASSERT_EQ(extra_overflow.calls, 1U);
+
+    // unknown keys and wrong transfer types are rejected
+    uint64_t signature = 0;
+    ASSERT_FALSE(HandlerList::accept_message(2, 1, CanardTransferTypeBroadcast, signature));
+    ASSERT_FALSE(HandlerList::accept_message(2, 0, CanardTransferTypeResponse, signature));
+
+    // unregistering keeps the rest reachable
+    for (uint16_t i = 0; i < NUM_KEYS; i += 2U) {
+        delete handlers[i];
+    }
+    for (uint16_t i = 0; i < NUM_KEYS; i++) {
+        const uint16_t msgid = (uint16_t)((i * 37U) % 1000U);
+        const CanardTransferType transfer_type = (i % 2U) ? CanardTransferTypeRequest : CanardTransferTypeBroadcast;
+        const bool registered = (i % 2U) || (msgid == 0);
+        ASSERT_EQ(HandlerList::accept_message(2, msgid, transfer_type, signature), registered);
+    }
+    for (uint16_t i = 1; i < NUM_KEYS; i += 2U) {
+        delete handlers[i];
+    }
+}
+
+TEST(StaticCoreTest, test_acceptance_filters_from_handlers) {
+    static const uint16_t NUM_KEYS = CANARD_HANDLER_TABLE_SIZE + 4U;
+    CanardAcceptedTransfer transfers[NUM_KEYS + 2U];
+    ASSERT_EQ(HandlerList::get_accepted_transfers(2, transfers, NUM_KEYS + 2U), 0U);
+
+    uint32_t generation = HandlerList::get_generation(2);
+    CountingHandler* handlers[NUM_KEYS];
+    for (uint16_t i = 0; i < NUM_KEYS; i++) {
+        handlers[i] = new CountingHandler((i % 2U) ? CanardTransferTypeRequest : CanardTransferTypeBroadcast, (uint16_t)(100U + i));
+        ASSERT_NE(HandlerList::get_generation(2), generation);
+        generation = HandlerList::get_generation(2);
+    }
+    // a second handler of a key is listed once
+    CountingHandler duplicate(CanardTransferTypeBroadcast, 100);
+
+    ASSERT_EQ(HandlerList::get_accepted_transfers(2, transfers, NUM_KEYS + 2U), NUM_KEYS);
+    // a short array reports how many entries it would need
+    ASSERT_GT(HandlerList::get_accepted_transfers(2, transfers, 4), 4U);
+    ASSERT_EQ(HandlerList::get_accepted_transfers(2, transfers, NUM_KEYS), NUM_KEYS);
+
+    CanardAcceptanceFilter filters[8];
+    const int16_t num_filters = canardMakeAcceptanceFilters(transfers, NUM_KEYS, 42, filters, 8);
+    ASSERT_GT(num_filters, 0);
+    for (uint16_t i = 0; i < NUM_KEYS; i++) {
+        const uint32_t id = (i % 2U) ?
+            (CANARD_CAN_FRAME_EFF | ((uint32_t)(100U + i) << 16U) | (1U << 15U) | (42U << 8U) | (1U << 7U) | 10U) :
+            (CANARD_CAN_FRAME_EFF | ((uint32_t)(100U + i) << 8U) | 10U);
+        bool passed = false;
+        for (int16_t f = 0; f < num_filters; f++) {
+            passed = passed || ((id & filters[f].mask) == (filters[f].id & filters[f].mask));
+        }
+        ASSERT_TRUE(passed);
+    }
+
+    for (uint16_t i = 0; i < NUM_KEYS; i++) {
+        delete handlers[i];
+    }
+    ASSERT_NE(HandlerList::get_generation(2), generation);
+    ASSERT_EQ(HandlerList::get_accepted_transfers(2, transfers, NUM_KEYS), 1U);
+    ASSERT_EQ(transfers[0].data_type_id, 100U);
+    ASSERT_EQ(transfers[0].transfer_type, (uint8_t)CanardTransferTypeBroadcast);
+}
+
+///////////// TESTS for shared decoding of subscribers //////////////
+static uint32_t counted_decodes;
+
+struct CountedMessage {
+    uint32_t value;
+    struct cxx_iface {
+        static constexpr uint16_t ID = 20000;
+        static constexpr uint64_t SIGNATURE = 0x1234;
+        static bool decode(const CanardRxTransfer* transfer, CountedMessage* msg) {
+            counted_decodes++;
+            msg->value = transfer->payload_len;
+            // an empty payload fails to decode
+            return transfer->payload_len == 0;
+        }
+    };
+};
+
+static uint32_t counted_calls;
+static const CountedMessage* last_counted_msg;
+static void handle_counted(const CanardRxTransfer &transfer, const CountedMessage &msg) {
+    (void)transfer;
+    counted_calls++;
+    // every subscriber sees the very same decoded message
+    if (last_counted_msg != nullptr) {
+        ASSERT_EQ(last_counted_msg, &msg);
+    }
+    last_counted_msg = &msg;
+    ASSERT_EQ(msg.value, 7U);
+}
+
+TEST(StaticCoreTest, test_subscribers_share_decode) {
+    StaticCallback<CountedMessage> cb(handle_counted);
+    Subscriber<CountedMessage> sub0(cb, 2);
+    Subscriber<CountedMessage> sub1(cb, 2);
+    // subscribers with other callback types join the same group
+    InlineSubscriber<CountedMessage, FunctionHandler<CountedMessage, handle_counted>> inline_sub(
+        FunctionHandler<CountedMessage, handle_counted>{}, 2);
+    Subscriber<CountedMessage> sub2(cb, 2);
+    // a plain handler of the same key still gets called on its own
+    CountingHandler other(CanardTransferTypeBroadcast, CountedMessage::cxx_iface::ID);
+    other.calls = 0;
+
+    CanardRxTransfer transfer {};
+    transfer.data_type_id = CountedMessage::cxx_iface::ID;
+    transfer.transfer_type = CanardTransferTypeBroadcast;
+    transfer.payload_len = 7;
+    counted_decodes = 0;
+    counted_calls = 0;
+    last_counted_msg = nullptr;
+    HandlerList::handle_message(2, transfer);
+    ASSERT_EQ(counted_decodes, 1U);
+    ASSERT_EQ(counted_calls, 4U);
+    ASSERT_EQ(other.calls, 1U);
+
+    // a transfer that fails to decode calls nobody and isn't decoded again
+    transfer.payload_len = 0;
+    counted_decodes = 0;
+    counted_calls = 0;
+    HandlerList::handle_message(2, transfer);
+    ASSERT_EQ(counted_decodes, 1U);
+    ASSERT_EQ(counted_calls, 0U);
+    ASSERT_EQ(other.calls, 2U);
+}
+
+///////////// TESTS for the transfer ID table //////////////
+TEST(StaticCoreTest, test_transfer_id_table) {
+    // more destinations than the table holds, so some of them are allocated individually
+    static const uint16_t NUM_DESTS = CANARD_TRANSFER_OBJECT_TABLE_SIZE + 16U;
+    uint8_t* tid_ptrs[NUM_DESTS];
+    for (uint16_t i = 0; i < NUM_DESTS; i++) {
+        tid_ptrs[i] = TransferObject::get_tid_ptr(2, (uint16_t)(i / 127U), CanardTransferTypeRequest, 10, (uint8_t)(1U + i % 127U));
+        ASSERT_NE(tid_ptrs[i], nullptr);
+        ASSERT_EQ(*tid_ptrs[i], 0);
+        *tid_ptrs[i] = (uint8_t)(i % 32U);
+    }
+    for (uint16_t i = 0; i < NUM_DESTS; i++) {
+        ASSERT_EQ(TransferObject::get_tid_ptr(2, (uint16_t)(i / 127U), CanardTransferTypeRequest, 10, (uint8_t)(1U + i % 127U)), tid_ptrs[i]);
+        ASSERT_EQ(*tid_ptrs[i], i % 32U);
+    }
+    // any part of the descriptor makes a different entry
+    ASSERT_NE(TransferObject::get_tid_ptr(2, 0, CanardTransferTypeBroadcast, 10, 1), tid_ptrs[0]);
+    ASSERT_NE(TransferObject::get_tid_ptr(2, 0, CanardTransferTypeRequest, 11, 1), tid_ptrs[0]);
+
+    const uint32_t generation = TransferObject::get_generation(2);
+    TransferObject::free_tid_ptr(2);
+    ASSERT_NE(TransferObject::get_generation(2), generation);
+    ASSERT_EQ(*TransferObject::get_tid_ptr(2, 0, CanardTransferTypeRequest, 10, 1), 0);
+    TransferObject::free_tid_ptr(2);
+}
+
 } // namespace StaticCoreTest
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "common.h"
+#include <canard/handler_list.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if !CANARD_HANDLER_LIST_RCU
+#error "This test expects CANARD_HANDLER_LIST_RCU=1"
+#endif
+
+using namespace Canard;
+
+DEFINE_HANDLER_LIST_HEADS();
+
+namespace HandlerListRcuTest {
+
+class CountingHandler : public HandlerList {
+public:
+    CountingHandler(CanardTransferType _transfer_type, uint16_t _msgid, uint8_t _index = 0) :
+    HandlerList(_transfer_type, _msgid, _msgid, _index) {
+        link();
+    }
+    ~CountingHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        calls++;
+        return true;
+    }
+    std::atomic<uint32_t> calls {0};
+};
+
+static bool dispatch(uint8_t index, uint16_t msgid, CanardTransferType transfer_type)
+{
+    uint64_t signature = 0;
+    if (!HandlerList::accept_message(index, msgid, transfer_type, signature)) {
+        return false;
+    }
+    EXPECT_EQ(signature, msgid);
+    CanardRxTransfer transfer {};
+    transfer.data_type_id = msgid;
+    transfer.transfer_type = (uint8_t)transfer_type;
+    HandlerList::handle_message(index, transfer);
+    return true;
+}
+
+TEST(HandlerListRcuTest, concurrent_dispatch_and_registration) {
+    // more stable handlers than a snapshot initially holds, so the snapshots grow while being read
+    static const uint16_t NUM_STABLE = CANARD_HANDLER_TABLE_SIZE + 4U;
+    static const uint32_t NUM_READERS = 4;
+    static const uint32_t NUM_WRITERS = 2;
+    static const uint32_t ITERATIONS = 20000;
+
+    std::vector<CountingHandler*> stable;
+    for (uint16_t i = 0; i < NUM_STABLE; i++) {
+        stable.push_back(new CountingHandler(CanardTransferTypeBroadcast, (uint16_t)(100U + i)));
+    }
+
+    std::atomic<bool> stop {false};
+    std::atomic<uint32_t> missed {0};
+    std::vector<std::thread> threads;
+    for (uint32_t r = 0; r < NUM_READERS; r++) {
+        threads.emplace_back([&, r]() {
+            for (uint32_t n = 0; n < ITERATIONS; n++) {
+                const uint16_t i = (uint16_t)((n + r) % NUM_STABLE);
+                if (!dispatch(0, (uint16_t)(100U + i), CanardTransferTypeBroadcast)) {
+                    missed++;
+                }
+                // keys that come and go may or may not be there
+                (void)dispatch(0, (uint16_t)(1000U + (n % 8U)), CanardTransferTypeRequest);
+            }
+        });
+    }
+    for (uint32_t w = 0; w < NUM_WRITERS; w++) {
+        threads.emplace_back([&, w]() {
+            while (!stop) {
+                CountingHandler transient(CanardTransferTypeRequest, (uint16_t)(1000U + w * 4U));
+                CountingHandler transient2(CanardTransferTypeRequest, (uint16_t)(1001U + w * 4U));
+            }
+        });
+    }
+    for (uint32_t r = 0; r < NUM_READERS; r++) {
+        threads[r].join();
+    }
+    stop = true;
+    for (uint32_t w = 0; w < NUM_WRITERS; w++) {
+        threads[NUM_READERS + w].join();
+    }
+
+    ASSERT_EQ(missed, 0U);
+    uint32_t total = 0;
+    for (CountingHandler* handler : stable) {
+        total += handler->calls;
+    }
+    ASSERT_EQ(total, NUM_READERS * ITERATIONS);
+
+    // nothing transient is left behind
+    uint64_t signature = 0;
+    for (uint16_t i = 0; i < 8U; i++) {
+        ASSERT_FALSE(HandlerList::accept_message(0, (uint16_t)(1000U + i), CanardTransferTypeRequest, signature));
+    }
+    for (CountingHandler* handler : stable) {
+        delete handler;
+    }
+    ASSERT_FALSE(HandlerList::accept_message(0, 100, CanardTransferTypeBroadcast, signature));
+}
+
+/// registers and removes another handler from within its own dispatch
+class RegisteringHandler : public HandlerList {
+public:
+    RegisteringHandler() :
+    HandlerList(CanardTransferTypeBroadcast, 5, 5, 1) {
+        link();
+    }
+    ~RegisteringHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        CountingHandler other(CanardTransferTypeBroadcast, 6, 1);
+        EXPECT_TRUE(dispatch(1, 6, CanardTransferTypeBroadcast));
+        EXPECT_EQ(other.calls, 1U);
+        return true;
+    }
+};
+
+TEST(HandlerListRcuTest, registration_from_dispatch) {
+    RegisteringHandler handler;
+    for (uint8_t i = 0; i < 10; i++) {
+        ASSERT_TRUE(dispatch(1, 5, CanardTransferTypeBroadcast));
+    }
+    uint64_t signature = 0;
+    ASSERT_FALSE(HandlerList::accept_message(1, 6, CanardTransferTypeBroadcast, signature));
+}
+
+/// stays in its dispatch until told to leave
+class BlockingHandler : public HandlerList {
+public:
+    BlockingHandler() :
+    HandlerList(CanardTransferTypeBroadcast, 7, 7, 2) {
+        link();
+    }
+    ~BlockingHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        inside = true;
+        while (!leave) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        finished = true;
+        return true;
+    }
+    static std::atomic<bool> inside;
+    static std::atomic<bool> leave;
+    static std::atomic<bool> finished;
+};
+std::atomic<bool> BlockingHandler::inside {false};
+std::atomic<bool> BlockingHandler::leave {false};
+std::atomic<bool> BlockingHandler::finished {false};
+
+static BlockingHandler* blocking_handler;
+
+/// destroys the blocking handler from within its own dispatch, while another thread dispatches to it
+class RemovingHandler : public HandlerList {
+public:
+    RemovingHandler() :
+    HandlerList(CanardTransferTypeBroadcast, 8, 8, 2) {
+        link();
+    }
+    ~RemovingHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        BlockingHandler::leave = true;
+        delete blocking_handler;
+        // the other thread has left the handler before it was freed
+        EXPECT_TRUE(BlockingHandler::finished);
+        return true;
+    }
+};
+
+TEST(HandlerListRcuTest, removal_from_dispatch_waits_for_other_threads) {
+    RemovingHandler remover;
+    blocking_handler = new BlockingHandler();
+    std::thread reader([]() {
+        EXPECT_TRUE(dispatch(2, 7, CanardTransferTypeBroadcast));
+    });
+    while (!BlockingHandler::inside) {
+        std::this_thread::yield();
+    }
+    ASSERT_TRUE(dispatch(2, 8, CanardTransferTypeBroadcast));
+    reader.join();
+    uint64_t signature = 0;
+    ASSERT_FALSE(HandlerList::accept_message(2, 7, CanardTransferTypeBroadcast, signature));
+}
+
+/// registers a handler from another thread and waits for it, from within its dispatch
+class WaitingHandler : public HandlerList {
+public:
+    WaitingHandler(uint16_t _msgid) :
+    HandlerList(CanardTransferTypeBroadcast, _msgid, _msgid, 1) {
+        link();
+    }
+    ~WaitingHandler() {
+        unlink();
+    }
+    bool handle_message(const CanardRxTransfer&) override {
+        // removal waits for this dispatch to finish, so the handler is destroyed afterwards
+        std::thread other([this]() {
+            registered = new CountingHandler(CanardTransferTypeBroadcast, 300, 1);
+        });
+        other.join();
+        calls++;
+        return true;
+    }
+    uint32_t calls = 0;
+    CountingHandler* registered = nullptr;
+};
+
+TEST(HandlerListRcuTest, dispatch_beyond_initial_snapshot_size_takes_no_lock) {
+    // the last handler doesn't fit into the initial snapshot, its dispatch must not block registrations
+    std::vector<CountingHandler*> handlers;
+    for (uint16_t i = 0; i < CANARD_HANDLER_TABLE_SIZE; i++) {
+        handlers.push_back(new CountingHandler(CanardTransferTypeBroadcast, (uint16_t)(200U + i), 1));
+    }
+    WaitingHandler waiting(199);
+    ASSERT_TRUE(dispatch(1, 199, CanardTransferTypeBroadcast));
+    ASSERT_EQ(waiting.calls, 1U);
+    ASSERT_TRUE(dispatch(1, 300, CanardTransferTypeBroadcast));
+    delete waiting.registered;
+    for (uint16_t i = 0; i < CANARD_HANDLER_TABLE_SIZE; i++) {
+        ASSERT_TRUE(dispatch(1, (uint16_t)(200U + i), CanardTransferTypeBroadcast));
+        ASSERT_EQ(handlers[i]->calls, 1U);
+    }
+    for (CountingHandler* handler : handlers) {
+        delete handler;
+    }
+    uint64_t signature = 0;
+    ASSERT_FALSE(HandlerList::accept_message(1, 200, CanardTransferTypeBroadcast, signature));
+    ASSERT_TRUE(HandlerList::accept_message(1, 199, CanardTransferTypeBroadcast, signature));
+}
+
+} // namespace HandlerListRcuTest
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <canard.h>
+#include <simbus_cxx.h>
+#include <vector>
+
+namespace SimBusTest {
+
+#define TEST_DATA_TYPE_ID 20100U
+#define TEST_DATA_TYPE_SIGNATURE 0x1234567890ABCDEFULL
+
+struct Reception {
+    uint64_t timestamp_usec;
+    uint8_t source_node_id;
+    uint16_t payload_len;
+};
+
+struct Node {
+    Node(uint8_t node_id) {
+        canardInit(&canard, arena, sizeof(arena), on_reception, should_accept, this);
+        canardSetLocalNodeID(&canard, node_id);
+    }
+
+    bool broadcast(uint8_t priority, const uint8_t* payload, uint16_t payload_len) {
+        CanardTxTransfer transfer;
+        canardInitTxTransfer(&transfer);
+        transfer.transfer_type = CanardTransferTypeBroadcast;
+        transfer.data_type_signature = TEST_DATA_TYPE_SIGNATURE;
+        transfer.data_type_id = TEST_DATA_TYPE_ID;
+        transfer.inout_transfer_id = &transfer_id;
+        transfer.priority = priority;
+        transfer.payload = payload;
+        transfer.payload_len = payload_len;
+#if CANARD_ENABLE_DEADLINE
+        transfer.deadline_usec = UINT64_MAX;
+#endif
+#if CANARD_MULTI_IFACE
+        transfer.iface_mask = 1U;
+#endif
+        return canardBroadcastObj(&canard, &transfer) > 0;
+    }
+
+    static bool should_accept(const CanardInstance* ins, uint64_t* out_data_type_signature, uint16_t data_type_id,
+                              CanardTransferType transfer_type, uint8_t source_node_id) {
+        (void)ins;
+        (void)transfer_type;
+        (void)source_node_id;
+        *out_data_type_signature = TEST_DATA_TYPE_SIGNATURE;
+        return data_type_id == TEST_DATA_TYPE_ID;
+    }
+
+    static void on_reception(CanardInstance* ins, CanardRxTransfer* transfer) {
+        Node* node = (Node*)ins->user_reference;
+        node->received.push_back({transfer->timestamp_usec, transfer->source_node_id, transfer->payload_len});
+    }
+
+    CanardInstance canard {};
+    uint8_t arena[4096] {};
+    uint8_t transfer_id = 0;
+    std::vector<Reception> received;
+};
+
+static CanardCANFrame make_frame(uint32_t id, const uint8_t* data, uint8_t data_len) {
+    CanardCANFrame frame {};
+    frame.id = id;
+    memcpy(frame.data, data, data_len);
+    frame.data_len = data_len;
+    return frame;
+}
+
+TEST(SimBusTest, frame_bits) {
+    // stuff bits counted exactly, including those in the CRC
+    const uint8_t tail[8] {0, 0, 0, 0, 0, 0, 0, 0xC0};
+    const uint8_t zeros[8] {};
+    const uint8_t alternating[8] {0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55};
+    CanardCANFrame frame = make_frame(CANARD_CAN_FRAME_EFF | 0x1F400A0AU, tail, 8);
+    EXPECT_EQ(simbusFrameBits(&frame, false, nullptr), 147U);
+    frame = make_frame(CANARD_CAN_FRAME_EFF, zeros, 8);
+    EXPECT_EQ(simbusFrameBits(&frame, false, nullptr), 150U);
+    frame = make_frame(CANARD_CAN_FRAME_EFF | 0x12345678U, alternating, 8);
+    EXPECT_EQ(simbusFrameBits(&frame, false, nullptr), 132U);
+
+    // one bit is a microsecond at 1 Mbit/s
+    Canard::SimBus bus(1000000U);
+    EXPECT_EQ(bus.get_frame_duration_nsec(frame), 132000U);
+}
+
+#if CANARD_ENABLE_CANFD
+TEST(SimBusTest, frame_bits_canfd) {
+    uint8_t data[64] {};
+    CanardCANFrame frame = make_frame(CANARD_CAN_FRAME_EFF | 0x12345678U, data, 64);
+    frame.canfd = true;
+    uint32_t data_phase_bits = 0;
+    const uint32_t bits = simbusFrameBits(&frame, true, &data_phase_bits);
+    EXPECT_GT(bits, 64U * 8U);
+    EXPECT_GT(data_phase_bits, 64U * 8U);
+    EXPECT_LT(data_phase_bits, bits);
+
+    // only the data phase gets faster with bit rate switching
+    Canard::SimBus slow(1000000U);
+    Canard::SimBus fast(1000000U, 5000000U);
+    EXPECT_EQ(slow.get_frame_duration_nsec(frame), (uint64_t)bits * 1000U);
+    EXPECT_EQ(fast.get_frame_duration_nsec(frame), (uint64_t)(bits - data_phase_bits) * 1000U + data_phase_bits * 200U);
+
+    // lengths that have no DLC are padded
+    CanardCANFrame padded = make_frame(CANARD_CAN_FRAME_EFF | 0x12345678U, data, 13);
+    CanardCANFrame full = make_frame(CANARD_CAN_FRAME_EFF | 0x12345678U, data, 16);
+    padded.canfd = true;
+    full.canfd = true;
+    EXPECT_EQ(simbusFrameBits(&padded, true, nullptr), simbusFrameBits(&full, true, nullptr));
+}
+#endif
+
+TEST(SimBusTest, arbitration_and_latency) {
+    Canard::SimBus bus(1000000U);
+    Node low(10);
+    Node high(20);
+    Node listener(30);
+    ASSERT_EQ(bus.add_node(low.canard), 0);
+    ASSERT_EQ(bus.add_node(high.canard), 1);
+    ASSERT_EQ(bus.add_node(listener.canard), 2);
+
+    // both queued while the bus is idle, the higher priority one gets the bus first
+    const uint8_t payload[4] {1, 2, 3, 4};
+    ASSERT_TRUE(low.broadcast(CANARD_TRANSFER_PRIORITY_LOWEST, payload, sizeof(payload)));
+    ASSERT_TRUE(high.broadcast(CANARD_TRANSFER_PRIORITY_HIGHEST, payload, sizeof(payload)));
+    const CanardCANFrame low_frame = *canardPeekTxQueue(&low.canard);
+    const CanardCANFrame high_frame = *canardPeekTxQueue(&high.canard);
+
+    EXPECT_EQ(bus.run_until(1000), 2U);
+    ASSERT_EQ(listener.received.size(), 2U);
+    EXPECT_EQ(listener.received[0].source_node_id, 20U);
+    EXPECT_EQ(listener.received[1].source_node_id, 10U);
+
+    // received when the last bit is on the wire, the loser waited for the winner
+    const uint64_t high_nsec = bus.get_frame_duration_nsec(high_frame);
+    const uint64_t low_nsec = bus.get_frame_duration_nsec(low_frame);
+    EXPECT_EQ(listener.received[0].timestamp_usec, high_nsec / 1000U);
+    EXPECT_EQ(listener.received[1].timestamp_usec, (high_nsec + low_nsec) / 1000U);
+    EXPECT_EQ(bus.get_node_statistics(0).arbitration_losses, 1U);
+    EXPECT_EQ(bus.get_node_statistics(1).arbitration_losses, 0U);
+    EXPECT_EQ(bus.get_node_statistics(0).frames, 1U);
+    EXPECT_EQ(bus.get_node_statistics(1).frames, 1U);
+
+    // senders don't receive their own frames
+    EXPECT_EQ(low.received.size(), 1U);
+    EXPECT_EQ(high.received.size(), 1U);
+
+    EXPECT_EQ(bus.get_time_usec(), 1000U);
+    EXPECT_FLOAT_EQ(bus.get_load(), (float)(high_nsec + low_nsec) / 1e6F);
+}
+
+struct Trace {
+    std::vector<uint64_t> starts;
+    std::vector<uint64_t> ends;
+};
+
+static void trace_frame(void* arg, uint8_t node_index, const CanardCANFrame* frame, uint64_t start_nsec, uint64_t end_nsec) {
+    (void)node_index;
+    (void)frame;
+    Trace* trace = (Trace*)arg;
+    trace->starts.push_back(start_nsec);
+    trace->ends.push_back(end_nsec);
+}
+
+TEST(SimBusTest, multi_frame_transfer) {
+    Canard::SimBus bus(500000U);
+    Node sender(10);
+    Node listener(30);
+    bus.add_node(sender.canard);
+    bus.add_node(listener.canard);
+    Trace trace;
+    bus.set_trace(trace_frame, &trace);
+
+    uint8_t payload[40];
+    for (uint8_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = i;
+    }
+    bus.run_until(100);
+    ASSERT_TRUE(sender.broadcast(CANARD_TRANSFER_PRIORITY_MEDIUM, payload, sizeof(payload)));
+
+    // a frame that doesn't end in time stays on the bus
+    bus.run_for(10);
+    EXPECT_EQ(bus.get_time_usec(), 110U);
+    EXPECT_TRUE(listener.received.empty());
+    ASSERT_EQ(trace.starts.size(), 1U);
+
+    bus.run_for(10000);
+    ASSERT_EQ(listener.received.size(), 1U);
+    EXPECT_EQ(listener.received[0].payload_len, sizeof(payload));
+
+    // the frames go back to back, the transfer is complete with the last one
+    ASSERT_GT(trace.starts.size(), 1U);
+    EXPECT_EQ(trace.starts[0], 100000U);
+    for (size_t i = 1; i < trace.starts.size(); i++) {
+        EXPECT_EQ(trace.starts[i], trace.ends[i - 1]);
+    }
+    EXPECT_EQ(listener.received[0].timestamp_usec, trace.ends.back() / 1000U);
+    EXPECT_EQ(bus.get_node_statistics(0).frames, trace.starts.size());
+}
+
+} // namespace SimBusTest
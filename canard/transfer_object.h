@@ -26,6 +26,18 @@
 #include <canard.h>
 #include "helpers.h"
 
+/*
+  the number of transfer descriptors each interface keeps the transfer
+  ID of in its open-addressed table, must be a power of two. Further
+  descriptors are allocated individually and searched linearly. The
+  table costs 5 bytes of static RAM per descriptor and interface; nodes
+  that answer many peers, like DNA, parameter or file servers, should
+  raise it to 64 or more
+ */
+#ifndef CANARD_TRANSFER_OBJECT_TABLE_SIZE
+#define CANARD_TRANSFER_OBJECT_TABLE_SIZE 16U
+#endif
+
 namespace Canard {
 
 #define MAKE_TRANSFER_DESCRIPTOR(data_type_id, transfer_type, src_node_id, dst_node_id)             \
@@ -44,33 +56,45 @@ public:
 #ifdef WITH_SEMAPHORE
         WITH_SEMAPHORE(sem[index]);
 #endif
+        TidTable &t = tid_table[index];
         uint32_t _transfer_desc = MAKE_TRANSFER_DESCRIPTOR(data_type_id, transfer_type, src_node_id, dst_node_id);
-        // check head
-        if (tid_map_head[index] == nullptr) {
-            tid_map_head[index] = allocate<TransferObject>(_transfer_desc);
-            if (tid_map_head[index]  == nullptr) {
-                return nullptr;
+        // keys are stored off by one, so that a zeroed slot is free. The descriptor never has all
+        // bits set as transfer type 3 doesn't exist
+        const uint32_t key = _transfer_desc + 1U;
+        uint32_t slot = hash(_transfer_desc);
+        for (uint32_t probe = 0; probe < CANARD_TRANSFER_OBJECT_TABLE_SIZE; probe++) {
+            if (t.keys[slot] == key) {
+                return &t.tids[slot];
             }
-            return &tid_map_head[index]->tid;
-        } else if (tid_map_head[index]->transfer_desc == _transfer_desc) {
-            return &tid_map_head[index]->tid;
+            if (t.keys[slot] == 0U) {
+                // entries are never removed on their own, so the descriptor isn't further down
+                if (t.num_entries >= CANARD_TRANSFER_OBJECT_TABLE_SIZE - 1U) {
+                    // keep a free slot to end the probing of missing descriptors
+                    break;
+                }
+                t.keys[slot] = key;
+                t.tids[slot] = 0;
+                t.num_entries++;
+                return &t.tids[slot];
+            }
+            slot = (slot + 1U) & (CANARD_TRANSFER_OBJECT_TABLE_SIZE - 1U);
         }
 
-        // search through the list for an existing entry
-        TransferObject *tid_map_ptr = tid_map_head[index];
-        while(tid_map_ptr->next) {
-            tid_map_ptr = tid_map_ptr->next;
+        // the table is full, search through the overflow list for an existing entry
+        for (TransferObject *tid_map_ptr = t.overflow; tid_map_ptr != nullptr; tid_map_ptr = tid_map_ptr->next) {
             if (tid_map_ptr->transfer_desc == _transfer_desc) {
                 return &tid_map_ptr->tid;
             }
         }
 
         // create a new entry, if not found
-        tid_map_ptr->next = allocate<TransferObject>(_transfer_desc);
-        if (tid_map_ptr->next == nullptr) {
+        TransferObject *entry = allocate<TransferObject>(_transfer_desc);
+        if (entry == nullptr) {
             return nullptr;
         }
-        return &tid_map_ptr->next->tid;
+        entry->next = t.overflow;
+        t.overflow = entry;
+        return &entry->tid;
     }
 
     static void free_tid_ptr(uint8_t index) NOINLINE_FUNC {
@@ -80,16 +104,49 @@ public:
 #ifdef WITH_SEMAPHORE
         WITH_SEMAPHORE(sem[index]);
 #endif
-        TransferObject *tid_map_ptr = tid_map_head[index];
+        TidTable &t = tid_table[index];
+        TransferObject *tid_map_ptr = t.overflow;
         while(tid_map_ptr) {
             TransferObject *next = tid_map_ptr->next;
             deallocate(tid_map_ptr);
             tid_map_ptr = next;
         }
-        tid_map_head[index] = nullptr;
+        t.overflow = nullptr;
+        memset(t.keys, 0, sizeof(t.keys));
+        t.num_entries = 0;
+        // invalidate the pointers cached by senders, which read the generation without the semaphore
+        __atomic_store_n(&t.generation, t.generation + 1U, __ATOMIC_RELEASE);
+    }
+
+    /// @brief changes whenever the pointers returned by get_tid_ptr() become invalid; lock-free, so
+    /// that checking a cached pointer costs no semaphore on every send
+    /// @param index Index of the interface
+    static uint32_t get_generation(uint8_t index) {
+        if (index >= CANARD_NUM_HANDLERS) {
+            return 0;
+        }
+        return __atomic_load_n(&tid_table[index].generation, __ATOMIC_ACQUIRE);
     }
+
 private:
-    static TransferObject *tid_map_head[CANARD_NUM_HANDLERS];
+    static_assert((CANARD_TRANSFER_OBJECT_TABLE_SIZE & (CANARD_TRANSFER_OBJECT_TABLE_SIZE - 1U)) == 0U,
+                  "CANARD_TRANSFER_OBJECT_TABLE_SIZE must be a power of two");
+
+    /// @brief per interface transfer IDs, keyed by the transfer descriptor plus one
+    struct TidTable {
+        uint32_t keys[CANARD_TRANSFER_OBJECT_TABLE_SIZE];
+        uint8_t tids[CANARD_TRANSFER_OBJECT_TABLE_SIZE];
+        uint16_t num_entries;
+        uint32_t generation;
+        TransferObject *overflow; ///< descriptors that did not fit into the table
+    };
+
+    static uint32_t hash(uint32_t transfer_desc) {
+        // Fibonacci hashing spreads the descriptors of consecutive node IDs over the table
+        return ((uint32_t)(transfer_desc * 2654435761U) >> 16U) & (CANARD_TRANSFER_OBJECT_TABLE_SIZE - 1U);
+    }
+
+    static TidTable tid_table[CANARD_NUM_HANDLERS];
 #ifdef WITH_SEMAPHORE
     static Canard::Semaphore sem[CANARD_NUM_HANDLERS];
 #endif
@@ -100,6 +157,6 @@ private:
 
 } // namespace Canard
 
-#define DEFINE_TRANSFER_OBJECT_HEADS() Canard::TransferObject* Canard::TransferObject::tid_map_head[CANARD_NUM_HANDLERS] = {nullptr}
+#define DEFINE_TRANSFER_OBJECT_HEADS() Canard::TransferObject::TidTable Canard::TransferObject::tid_table[CANARD_NUM_HANDLERS] = {}
 
 #define DEFINE_TRANSFER_OBJECT_SEMAPHORES() Canard::Semaphore Canard::TransferObject::sem[CANARD_NUM_HANDLERS];
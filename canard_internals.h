@@ -122,9 +122,23 @@ CANARD_INTERNAL void incrementTransferID(uint8_t* transfer_id);
 CANARD_INTERNAL uint64_t releaseStatePayload(CanardInstance* ins,
                                              CanardRxState* rxstate);
 
+/// Unlinks an RX state from the list, releases its payload and returns the state that followed it
+CANARD_INTERNAL CanardRxState* removeRxState(CanardInstance* ins,
+                                             CanardRxState* prev,
+                                             CanardRxState* state);
+
 CANARD_INTERNAL uint16_t dlcToDataLength(uint16_t dlc);
 CANARD_INTERNAL uint16_t dataLengthToDlc(uint16_t data_length);
 
+/// Invokes the low watermark hook if the number of free pool blocks has dropped to the configured watermark
+CANARD_INTERNAL void checkPoolLowWatermark(CanardInstance* ins);
+
+/// Invokes the out of memory hook, if installed
+CANARD_INTERNAL void notifyPoolOutOfMemory(CanardInstance* ins,
+                                           CanardPoolConsumer consumer,
+                                           uint16_t data_type_id,
+                                           CanardTransferType transfer_type);
+
 /// Returns the number of frames enqueued
 CANARD_INTERNAL int16_t enqueueTxFrames(CanardInstance* ins,
                                         uint32_t can_id,
@@ -175,16 +189,71 @@ CANARD_INTERNAL void initPoolAllocator(CanardPoolAllocator* allocator,
                                        uint16_t buf_len);
 
 /**
- * Allocates a block from the given pool allocator.
+ * Returns all blocks to the free list of an allocator that was initialized with initPoolAllocator.
+ * Unlike initPoolAllocator, this keeps the semaphore, the consumer limits and the peak usage statistics.
  */
-CANARD_INTERNAL void* allocateBlock(CanardPoolAllocator* allocator);
+CANARD_INTERNAL void resetPoolAllocator(CanardPoolAllocator* allocator);
 
 /**
- * Frees a memory block previously returned by canardAllocateBlock.
+ * Allocates a block from the given pool allocator on behalf of the consumer.
+ * Returns NULL if the pool is empty, if the consumer has reached its quota, or if the allocation would eat
+ * into blocks reserved for other consumers.
+ */
+CANARD_INTERNAL void* allocateBlock(CanardPoolAllocator* allocator,
+                                    CanardPoolConsumer consumer);
+
+/**
+ * Frees a memory block previously returned by allocateBlock for the same consumer.
  */
 CANARD_INTERNAL void freeBlock(CanardPoolAllocator* allocator,
+                               CanardPoolConsumer consumer,
                                void* p);
 
+/**
+ * Returns the number of blocks reserved for consumers other than the given one and not yet taken by them.
+ */
+CANARD_INTERNAL uint32_t reservedForOtherConsumers(const CanardPoolAllocator* allocator,
+                                                   CanardPoolConsumer consumer);
+
+#if CANARD_ALLOCATE_LOCKFREE
+/**
+ * Atomically raises the peak usage counter to the given value if it is lower.
+ */
+CANARD_INTERNAL void updatePeakUsage(uint16_t* peak_usage_blocks,
+                                     uint16_t usage_blocks);
+#endif
+
+/**
+ * Returns the number of blocks the consumer could allocate right now.
+ */
+CANARD_INTERNAL uint16_t availableBlocks(const CanardPoolAllocator* allocator,
+                                         CanardPoolConsumer consumer);
+
+/**
+ * Returns true if every frame passing 'inner' passes 'outer' as well.
+ */
+CANARD_INTERNAL bool filterCovers(const CanardAcceptanceFilter* outer,
+                                  const CanardAcceptanceFilter* inner);
+
+/**
+ * Returns the narrowest filter passing every frame that passes either of the two.
+ */
+CANARD_INTERNAL CanardAcceptanceFilter mergeFilters(const CanardAcceptanceFilter* a,
+                                                    const CanardAcceptanceFilter* b);
+
+/**
+ * Returns the number of bits set in the value.
+ */
+CANARD_INTERNAL uint8_t countBits(uint32_t value);
+
+/**
+ * Adds a filter to the set, combining it with the existing ones; widens the closest pair if the set is full.
+ */
+CANARD_INTERNAL void addAcceptanceFilter(CanardAcceptanceFilter* filters,
+                                         uint16_t* num_filters,
+                                         uint16_t max_filters,
+                                         CanardAcceptanceFilter filter);
+
 CANARD_INTERNAL uint16_t calculateCRC(const CanardTxTransfer* transfer_object);
 
 CANARD_INTERNAL CanardBufferBlock *canardBufferFromIdx(CanardPoolAllocator* allocator, canard_buffer_idx_t idx);
@@ -1,11 +1,23 @@
 /*
-  implement LinuxCAN, wrapper around socketcan and multicast UDP
+  implement LinuxCAN, wrapper around socketcan, multicast UDP and, with
+  LINUX_CAN_WITH_SHM, shared memory
  */
 
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
 #include "linux.h"
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 /*
  Initializes the instance.
@@ -19,6 +31,9 @@ int16_t LinuxCANInit(LinuxCANInstance* out_ins, const char* can_iface_name)
 {
     out_ins->socketcan = NULL;
     out_ins->mcast = NULL;
+#if LINUX_CAN_WITH_SHM
+    out_ins->shm = NULL;
+#endif
 
     if (strncmp(can_iface_name, "mcast", 5) == 0) {
         out_ins->mcast = (MCASTCANInstance *)calloc(1, sizeof(MCASTCANInstance));
@@ -26,18 +41,32 @@ int16_t LinuxCANInit(LinuxCANInstance* out_ins, const char* can_iface_name)
             return -ENOMEM;
         }
 #if CANARD_ENABLE_CANFD
-        return mcastInit(out_ins->mcast, can_iface_name, can_fd);
+        return mcastInit(out_ins->mcast, can_iface_name, canfd);
 #else
         return mcastInit(out_ins->mcast, can_iface_name);
 #endif
     }
 
+#if LINUX_CAN_WITH_SHM
+    if (strncmp(can_iface_name, "shm:", 4) == 0) {
+        out_ins->shm = (SHMCANInstance *)calloc(1, sizeof(SHMCANInstance));
+        if (out_ins->shm == NULL) {
+            return -ENOMEM;
+        }
+#if CANARD_ENABLE_CANFD
+        return shmcanInit(out_ins->shm, can_iface_name, canfd);
+#else
+        return shmcanInit(out_ins->shm, can_iface_name);
+#endif
+    }
+#endif
+
     out_ins->socketcan = (SocketCANInstance *)calloc(1, sizeof(SocketCANInstance));
     if (out_ins->socketcan == NULL) {
         return -ENOMEM;
     }
 #if CANARD_ENABLE_CANFD
-    return socketcanInit(out_ins->socketcan, can_iface_name, can_fd);
+    return socketcanInit(out_ins->socketcan, can_iface_name, canfd);
 #else
     return socketcanInit(out_ins->socketcan, can_iface_name);
 #endif
@@ -55,6 +84,11 @@ int16_t LinuxCANClose(LinuxCANInstance* ins)
     if (ins->mcast != NULL) {
         return mcastClose(ins->mcast);
     }
+#if LINUX_CAN_WITH_SHM
+    if (ins->shm != NULL) {
+        return shmcanClose(ins->shm);
+    }
+#endif
     return -EINVAL;
 }
 
@@ -71,6 +105,11 @@ int16_t LinuxCANTransmit(LinuxCANInstance* ins, const CanardCANFrame* frame, int
     if (ins->mcast != NULL) {
         return mcastTransmit(ins->mcast, frame, timeout_msec);
     }
+#if LINUX_CAN_WITH_SHM
+    if (ins->shm != NULL) {
+        return shmcanTransmit(ins->shm, frame, timeout_msec);
+    }
+#endif
     return -EINVAL;
 }
 
@@ -87,5 +126,470 @@ int16_t LinuxCANReceive(LinuxCANInstance* ins, CanardCANFrame* out_frame, int32_
     if (ins->mcast != NULL) {
         return mcastReceive(ins->mcast, out_frame, timeout_msec);
     }
+#if LINUX_CAN_WITH_SHM
+    if (ins->shm != NULL) {
+        return shmcanReceive(ins->shm, out_frame, timeout_msec);
+    }
+#endif
     return -EINVAL;
 }
+
+/*
+ Initializes the event loop.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopInit(LinuxCANEventLoop* loop)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        return (int16_t)-errno;
+    }
+    return 0;
+}
+
+/*
+ Closes the event loop; the buses stay open.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopClose(LinuxCANEventLoop* loop)
+{
+    const int ret = close(loop->epoll_fd);
+    loop->epoll_fd = -1;
+    loop->num_sources = 0;
+    return (int16_t)((ret == 0) ? 0 : -errno);
+}
+
+static int16_t addSource(LinuxCANEventLoop* loop, const LinuxCANEventSource* source)
+{
+    if (loop->num_sources >= LINUX_CAN_EVENT_LOOP_MAX_SOURCES) {
+        return -ENOSPC;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = loop->num_sources;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, source->fd, &ev) < 0) {
+        return (int16_t)-errno;
+    }
+    loop->sources[loop->num_sources++] = *source;
+    return 0;
+}
+
+/*
+ Adds an initialized bus to the event loop.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopAddBus(LinuxCANEventLoop* loop, LinuxCANInstance* ins, CanardInstance* canard, uint8_t iface_id)
+{
+    LinuxCANEventSource source;
+    memset(&source, 0, sizeof(source));
+    if (ins->socketcan != NULL) {
+        source.fd = socketcanGetSocketFileDescriptor(ins->socketcan);
+    } else if (ins->mcast != NULL) {
+        source.fd = ins->mcast->fd_in;
+#if LINUX_CAN_WITH_SHM
+    } else if (ins->shm != NULL) {
+        const int16_t res = shmcanEnableEventFd(ins->shm);
+        if (res < 0) {
+            return res;
+        }
+        source.fd = ins->shm->event_fd;
+#endif
+    } else {
+        return -EINVAL;
+    }
+    source.can = ins;
+    source.canard = canard;
+    source.iface_id = iface_id;
+    return addSource(loop, &source);
+}
+
+/*
+ Adds another file descriptor to the event loop.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopAddFd(LinuxCANEventLoop* loop, int fd, void (*on_ready)(void *arg), void *arg)
+{
+    if (on_ready == NULL) {
+        return -EINVAL;
+    }
+    LinuxCANEventSource source;
+    memset(&source, 0, sizeof(source));
+    source.fd = fd;
+    source.on_ready = on_ready;
+    source.arg = arg;
+    return addSource(loop, &source);
+}
+
+static uint64_t monotonicUsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/*
+ Receives up to max_frames frames of a bus with their timestamps.
+ Returns the number of frames received, 0 on timeout, negative on error.
+ */
+static int16_t receiveBatch(LinuxCANInstance* ins, CanardCANFrame* out_frames, uint64_t* out_timestamps_usec,
+                            uint16_t max_frames, int32_t timeout_msec)
+{
+    if (ins->socketcan != NULL) {
+        return socketcanReceiveBatch(ins->socketcan, out_frames, out_timestamps_usec, max_frames, timeout_msec);
+    }
+    int16_t num = -EINVAL;
+    if (ins->mcast != NULL) {
+        num = mcastReceiveBatch(ins->mcast, out_frames, max_frames, timeout_msec);
+        if (num == -EIO) {
+            num = 0;                // only corrupted packets
+        }
+    }
+#if LINUX_CAN_WITH_SHM
+    else if (ins->shm != NULL) {
+        num = shmcanReceiveBatch(ins->shm, out_frames, max_frames, timeout_msec);
+    }
+#endif
+    const uint64_t now = monotonicUsec();
+    for (int16_t i = 0; i < num; i++) {
+        out_timestamps_usec[i] = now;
+    }
+    return num;
+}
+
+/*
+ Reads what a ready bus has, up to one batch, into its canard instance.
+ Returns the number of frames handled, negative on error.
+ */
+static int16_t receiveFromBus(const LinuxCANEventSource* source)
+{
+    CanardCANFrame frames[LINUX_CAN_EVENT_LOOP_BATCH];
+    uint64_t timestamps[LINUX_CAN_EVENT_LOOP_BATCH];
+    int16_t total = 0;
+    int16_t num = 0;
+
+    do {
+        num = receiveBatch(source->can, frames, timestamps, LINUX_CAN_EVENT_LOOP_BATCH, 0);
+        if (num < 0) {
+            return (total > 0) ? total : num;
+        }
+
+        for (int16_t i = 0; i < num; i++) {
+            frames[i].iface_id = source->iface_id;
+            (void)canardHandleRxFrame(source->canard, &frames[i], timestamps[i]);
+        }
+        total = (int16_t)(total + num);
+        // frames of a multicast datagram that didn't fit are buffered in the instance, where epoll can't see them
+    } while (source->can->mcast != NULL && num == (int16_t)LINUX_CAN_EVENT_LOOP_BATCH &&
+             total <= INT16_MAX - (int16_t)LINUX_CAN_EVENT_LOOP_BATCH);
+    return total;
+}
+
+/*
+ Waits until any bus or file descriptor is ready and handles it.
+ Returns the number of frames handled, 0 on timeout, negative on error
+ if no frame could be handled.
+ */
+int16_t LinuxCANEventLoopRun(LinuxCANEventLoop* loop, int32_t timeout_msec)
+{
+    struct epoll_event events[LINUX_CAN_EVENT_LOOP_MAX_SOURCES];
+    const int num_events = epoll_wait(loop->epoll_fd, events, LINUX_CAN_EVENT_LOOP_MAX_SOURCES, timeout_msec);
+    if (num_events < 0) {
+        return (errno == EINTR) ? 0 : (int16_t)-errno;
+    }
+
+    int32_t num_frames = 0;
+    int16_t error = 0;
+    for (int i = 0; i < num_events; i++) {
+        const LinuxCANEventSource* source = &loop->sources[events[i].data.u32];
+        if (source->can == NULL) {
+            source->on_ready(source->arg);
+            continue;
+        }
+        const int16_t res = receiveFromBus(source);
+        if (res < 0) {
+            error = res;
+        } else {
+            num_frames += res;
+        }
+    }
+    if (num_frames == 0 && error < 0) {
+        return error;
+    }
+    return (int16_t)((num_frames > INT16_MAX) ? INT16_MAX : num_frames);
+}
+
+#if (LINUX_CAN_RX_RING_FRAMES & (LINUX_CAN_RX_RING_FRAMES - 1U)) != 0 || LINUX_CAN_RX_RING_FRAMES < LINUX_CAN_RX_THREAD_BATCH
+# error "LINUX_CAN_RX_RING_FRAMES must be a power of two not smaller than LINUX_CAN_RX_THREAD_BATCH"
+#endif
+
+// how often the receive thread looks whether it should stop
+#define LINUX_CAN_RX_THREAD_POLL_MSEC 50
+#define LINUX_CAN_CACHE_LINE 64U
+
+typedef struct
+{
+    CanardCANFrame frame;
+    uint64_t timestamp_usec;
+} LinuxCANRxItem;
+
+/*
+  single producer, single consumer ring: the receive thread only writes
+  head, the application thread only writes tail, each keeps a copy of
+  the other's index and reloads it only when the ring looks full or empty
+ */
+struct LinuxCANRxThread
+{
+    // receive thread
+    uint32_t head __attribute__((aligned(LINUX_CAN_CACHE_LINE)));
+    uint32_t tail_cache;
+    uint64_t frames;
+    uint64_t overruns;
+    uint64_t errors;
+
+    // application thread
+    uint32_t tail __attribute__((aligned(LINUX_CAN_CACHE_LINE)));
+    uint32_t head_cache;
+
+    // both
+    uint32_t signalled __attribute__((aligned(LINUX_CAN_CACHE_LINE)));
+    bool stop;
+    int event_fd;
+    LinuxCANInstance *can;
+    uint8_t iface_id;
+    pthread_t thread;
+
+    LinuxCANRxItem ring[LINUX_CAN_RX_RING_FRAMES] __attribute__((aligned(LINUX_CAN_CACHE_LINE)));
+};
+
+/*
+  makes the eventfd readable. The flag is set after the write has landed,
+  so whoever sees it set and reads the eventfd really empties it
+ */
+static void raiseSignal(LinuxCANRxThread* rx)
+{
+    const uint64_t one = 1U;
+    (void)write(rx->event_fd, &one, sizeof(one));
+    __atomic_store_n(&rx->signalled, 1U, __ATOMIC_RELEASE);
+}
+
+static void *rxThreadMain(void *arg)
+{
+    LinuxCANRxThread *rx = (LinuxCANRxThread *)arg;
+    CanardCANFrame frames[LINUX_CAN_RX_THREAD_BATCH];
+    uint64_t timestamps[LINUX_CAN_RX_THREAD_BATCH];
+
+    while (!__atomic_load_n(&rx->stop, __ATOMIC_RELAXED)) {
+        const int16_t num = receiveBatch(rx->can, frames, timestamps, LINUX_CAN_RX_THREAD_BATCH,
+                                         LINUX_CAN_RX_THREAD_POLL_MSEC);
+        if (num <= 0) {
+            if (num < 0) {
+                __atomic_store_n(&rx->errors, rx->errors + 1U, __ATOMIC_RELAXED);
+                // don't spin on a bus that keeps failing
+                struct timespec ts = { 0, 1000000L };
+                (void)nanosleep(&ts, NULL);
+            }
+            continue;
+        }
+
+        const uint32_t old_head = rx->head;
+        uint32_t head = old_head;
+        for (int16_t i = 0; i < num; i++) {
+            if (head - rx->tail_cache >= LINUX_CAN_RX_RING_FRAMES) {
+                rx->tail_cache = __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE);
+                if (head - rx->tail_cache >= LINUX_CAN_RX_RING_FRAMES) {
+                    // like a full controller FIFO, the newest frames are lost
+                    __atomic_store_n(&rx->overruns, rx->overruns + (uint64_t)(num - i), __ATOMIC_RELAXED);
+                    break;
+                }
+            }
+            LinuxCANRxItem *item = &rx->ring[head & (LINUX_CAN_RX_RING_FRAMES - 1U)];
+            item->frame = frames[i];
+            item->frame.iface_id = rx->iface_id;
+            item->timestamp_usec = timestamps[i];
+            head++;
+        }
+        if (head == old_head) {
+            continue;
+        }
+        __atomic_store_n(&rx->head, head, __ATOMIC_RELEASE);
+        __atomic_store_n(&rx->frames, rx->frames + (head - old_head), __ATOMIC_RELAXED);
+
+        /*
+          wake the application only if it had taken everything before, it
+          checks the ring again after publishing its tail, so one of the
+          two sees the other's update
+         */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&rx->tail, __ATOMIC_RELAXED) == old_head) {
+            raiseSignal(rx);
+        }
+    }
+    return NULL;
+}
+
+/*
+ Starts a thread that receives the frames of a bus into a ring.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANRxThreadStart(LinuxCANRxThread** out_thread, LinuxCANInstance* ins, uint8_t iface_id, int cpu)
+{
+    if (out_thread == NULL || ins == NULL) {
+        return -EINVAL;
+    }
+    bool has_bus = ins->socketcan != NULL || ins->mcast != NULL;
+#if LINUX_CAN_WITH_SHM
+    has_bus = has_bus || ins->shm != NULL;
+#endif
+    if (!has_bus) {
+        return -EINVAL;
+    }
+    LinuxCANRxThread *rx = NULL;
+    if (posix_memalign((void **)&rx, LINUX_CAN_CACHE_LINE, sizeof(LinuxCANRxThread)) != 0) {
+        return -ENOMEM;
+    }
+    memset(rx, 0, sizeof(*rx));
+    rx->can = ins;
+    rx->iface_id = iface_id;
+    rx->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (rx->event_fd < 0) {
+        const int err = errno;
+        free(rx);
+        return (int16_t)-err;
+    }
+
+    pthread_attr_t attr;
+    int err = pthread_attr_init(&attr);
+    if (err == 0 && cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET((size_t)cpu, &cpus);
+        err = (cpu < CPU_SETSIZE) ? pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus) : EINVAL;
+    }
+    if (err == 0) {
+        err = pthread_create(&rx->thread, &attr, rxThreadMain, rx);
+    }
+    (void)pthread_attr_destroy(&attr);
+    if (err != 0) {
+        (void)close(rx->event_fd);
+        free(rx);
+        return (int16_t)-err;
+    }
+    *out_thread = rx;
+    return 0;
+}
+
+/*
+ Stops the thread and frees the ring.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANRxThreadStop(LinuxCANRxThread* thread)
+{
+    __atomic_store_n(&thread->stop, true, __ATOMIC_RELAXED);
+    const int err = pthread_join(thread->thread, NULL);
+    (void)close(thread->event_fd);
+    free(thread);
+    return (int16_t)-err;
+}
+
+static void drainSignal(LinuxCANRxThread* thread)
+{
+    uint64_t count;
+    __atomic_store_n(&thread->signalled, 0U, __ATOMIC_RELAXED);
+    (void)read(thread->event_fd, &count, sizeof(count));
+}
+
+static void clearSignal(LinuxCANRxThread* thread)
+{
+    if (__atomic_load_n(&thread->signalled, __ATOMIC_ACQUIRE) != 0U) {
+        drainSignal(thread);
+    }
+}
+
+/*
+ Hands up to max_frames frames from the ring to canardHandleRxFrame().
+ Returns the number of frames handled.
+ */
+int16_t LinuxCANRxThreadProcess(LinuxCANRxThread* thread, CanardInstance* canard, uint16_t max_frames)
+{
+    clearSignal(thread);
+    if (max_frames > INT16_MAX) {
+        max_frames = INT16_MAX;
+    }
+
+    uint32_t tail = thread->tail;
+    uint16_t num = 0;
+    while (num < max_frames) {
+        if (tail == thread->head_cache) {
+            /*
+              let the receive thread reuse the slots before looking for
+              more. The fence keeps the load of head after the store of
+              tail and pairs with the fence of the receive thread, so
+              either it sees the ring emptied and signals, or we see its
+              frames
+             */
+            __atomic_store_n(&thread->tail, tail, __ATOMIC_RELEASE);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            thread->head_cache = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+            if (tail == thread->head_cache) {
+                break;
+            }
+        }
+        const LinuxCANRxItem *item = &thread->ring[tail & (LINUX_CAN_RX_RING_FRAMES - 1U)];
+        (void)canardHandleRxFrame(canard, &item->frame, item->timestamp_usec);
+        tail++;
+        num++;
+    }
+    __atomic_store_n(&thread->tail, tail, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    // the receive thread only signals an empty ring, so frames left behind are signalled here
+    if (num == max_frames && __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE) != tail) {
+        raiseSignal(thread);
+    }
+    return (int16_t)num;
+}
+
+/*
+ Waits until the ring has frames.
+ Returns 1 if there are frames, 0 on timeout, negative on error.
+ */
+int16_t LinuxCANRxThreadWait(LinuxCANRxThread* thread, int32_t timeout_msec)
+{
+    // pairs with the fence of the receive thread after it publishes head
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&thread->head, __ATOMIC_RELAXED) != thread->tail) {
+        return 1;
+    }
+    struct pollfd fds;
+    fds.fd = thread->event_fd;
+    fds.events = POLLIN;
+    fds.revents = 0;
+    const int res = poll(&fds, 1, timeout_msec);
+    if (res < 0) {
+        return (errno == EINTR) ? 0 : (int16_t)-errno;
+    }
+    if (res > 0) {
+        drainSignal(thread);
+    }
+    return (__atomic_load_n(&thread->head, __ATOMIC_ACQUIRE) != thread->tail) ? 1 : 0;
+}
+
+/*
+ Returns a file descriptor that becomes readable when frames arrive.
+ */
+int LinuxCANRxThreadGetFileDescriptor(const LinuxCANRxThread* thread)
+{
+    return thread->event_fd;
+}
+
+/*
+ Reads the counters of the thread.
+ */
+void LinuxCANRxThreadGetStatistics(const LinuxCANRxThread* thread, LinuxCANRxThreadStatistics* out_stats)
+{
+    out_stats->frames = __atomic_load_n(&thread->frames, __ATOMIC_RELAXED);
+    out_stats->overruns = __atomic_load_n(&thread->overruns, __ATOMIC_RELAXED);
+    out_stats->errors = __atomic_load_n(&thread->errors, __ATOMIC_RELAXED);
+}
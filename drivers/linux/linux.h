@@ -4,7 +4,8 @@
  * Distributed under the MIT License, available in the file LICENSE.
  */
 /*
-  this wraps the socketcan and multicast drivers, allowing either to be selected
+  this wraps the socketcan and multicast drivers, and optionally the
+  shared memory driver, allowing any of them to be selected
  */
 
 #pragma once
@@ -13,6 +14,18 @@
 #include "../mcast/mcast.h"
 #include "../socketcan/socketcan.h"
 
+/*
+ Set to 1 to support "shm:N" buses. Then drivers/shm/shm.c has to be
+ built as well, and librt linked on older C libraries.
+ */
+#ifndef LINUX_CAN_WITH_SHM
+#define LINUX_CAN_WITH_SHM 0
+#endif
+
+#if LINUX_CAN_WITH_SHM
+#include "../shm/shm.h"
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -22,6 +35,9 @@ typedef struct
 {
     MCASTCANInstance *mcast;
     SocketCANInstance *socketcan;
+#if LINUX_CAN_WITH_SHM
+    SHMCANInstance *shm;
+#endif
 } LinuxCANInstance;
 
 /*
@@ -54,6 +70,153 @@ int16_t LinuxCANTransmit(LinuxCANInstance* ins, const CanardCANFrame* frame, int
  */
 int16_t LinuxCANReceive(LinuxCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec);
 
+/*
+ maximum number of buses and other file descriptors one event loop waits on
+ */
+#ifndef LINUX_CAN_EVENT_LOOP_MAX_SOURCES
+#define LINUX_CAN_EVENT_LOOP_MAX_SOURCES 8U
+#endif
+
+/*
+ maximum number of frames taken from one bus per wakeup, so that a busy
+ bus can't starve the others
+ */
+#ifndef LINUX_CAN_EVENT_LOOP_BATCH
+#define LINUX_CAN_EVENT_LOOP_BATCH SOCKETCAN_MAX_BATCH
+#endif
+
+/*
+ something the event loop waits on: either a bus whose frames go to a
+ CanardInstance, or any other file descriptor with a callback
+ */
+typedef struct
+{
+    int fd;
+    LinuxCANInstance *can;
+    CanardInstance *canard;
+    uint8_t iface_id;
+    void (*on_ready)(void *arg);
+    void *arg;
+} LinuxCANEventSource;
+
+typedef struct
+{
+    int epoll_fd;
+    LinuxCANEventSource sources[LINUX_CAN_EVENT_LOOP_MAX_SOURCES];
+    uint8_t num_sources;
+} LinuxCANEventLoop;
+
+/*
+ Initializes the event loop.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopInit(LinuxCANEventLoop* loop);
+
+/*
+ Closes the event loop; the buses stay open.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopClose(LinuxCANEventLoop* loop);
+
+/*
+ Adds an initialized bus to the event loop. Its frames are given to
+ canardHandleRxFrame() of the canard instance with iface_id set, so
+ several buses can feed one instance built with CANARD_MULTI_IFACE, or
+ each bus can have its own instance. Shared memory buses are waited on
+ through the eventfd that shmcanEnableEventFd() gives them here.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopAddBus(LinuxCANEventLoop* loop, LinuxCANInstance* ins, CanardInstance* canard, uint8_t iface_id);
+
+/*
+ Adds another file descriptor, e.g. of an IPC socket, to the event loop.
+ on_ready is called whenever it is readable.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANEventLoopAddFd(LinuxCANEventLoop* loop, int fd, void (*on_ready)(void *arg), void *arg);
+
+/*
+ Waits until any bus or file descriptor is ready, then hands up to
+ LINUX_CAN_EVENT_LOOP_BATCH frames of each ready bus to its canard
+ instance and calls the callbacks of the ready file descriptors.
+ Frames are timestamped on CLOCK_MONOTONIC, which the application must
+ use for canardCleanupStaleTransfers() as well.
+ Use negative timeout to block infinitely.
+ Returns the number of frames handled, 0 on timeout, negative on error
+ if no frame could be handled.
+ */
+int16_t LinuxCANEventLoopRun(LinuxCANEventLoop* loop, int32_t timeout_msec);
+
+/*
+ number of frames the ring between a receive thread and the application
+ holds, a power of two
+ */
+#ifndef LINUX_CAN_RX_RING_FRAMES
+#define LINUX_CAN_RX_RING_FRAMES 1024U
+#endif
+
+/*
+ maximum number of frames the receive thread takes from the bus at once
+ */
+#ifndef LINUX_CAN_RX_THREAD_BATCH
+#define LINUX_CAN_RX_THREAD_BATCH SOCKETCAN_MAX_BATCH
+#endif
+
+/*
+ a thread that receives the frames of one bus into a ring, so that slow
+ processing on the application thread doesn't hold up reception
+ */
+typedef struct LinuxCANRxThread LinuxCANRxThread;
+
+typedef struct
+{
+    uint64_t frames;                // frames put into the ring
+    uint64_t overruns;              // frames dropped because the ring was full
+    uint64_t errors;                // failed receive calls
+} LinuxCANRxThreadStatistics;
+
+/*
+ Starts a thread that receives the frames of an initialized bus, with
+ timestamps on CLOCK_MONOTONIC and iface_id set, into a ring that only
+ the calling thread may take them from. The thread is pinned to the
+ given CPU, or not pinned if cpu is negative.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANRxThreadStart(LinuxCANRxThread** out_thread, LinuxCANInstance* ins, uint8_t iface_id, int cpu);
+
+/*
+ Stops the thread and frees the ring; the bus stays open.
+ Returns 0 on success, negative on error.
+ */
+int16_t LinuxCANRxThreadStop(LinuxCANRxThread* thread);
+
+/*
+ Hands up to max_frames frames from the ring to canardHandleRxFrame(),
+ oldest first. Doesn't wait.
+ Returns the number of frames handled.
+ */
+int16_t LinuxCANRxThreadProcess(LinuxCANRxThread* thread, CanardInstance* canard, uint16_t max_frames);
+
+/*
+ Waits until the ring has frames.
+ Use negative timeout to block infinitely.
+ Returns 1 if there are frames, 0 on timeout, negative on error.
+ */
+int16_t LinuxCANRxThreadWait(LinuxCANRxThread* thread, int32_t timeout_msec);
+
+/*
+ Returns a file descriptor that becomes readable when frames arrive in
+ the empty ring, and stays readable when LinuxCANRxThreadProcess() leaves
+ frames behind, e.g. for LinuxCANEventLoopAddFd() with a callback that
+ calls LinuxCANRxThreadProcess().
+ */
+int LinuxCANRxThreadGetFileDescriptor(const LinuxCANRxThread* thread);
+
+/*
+ Reads the counters of the thread.
+ */
+void LinuxCANRxThreadGetStatistics(const LinuxCANRxThread* thread, LinuxCANRxThreadStatistics* out_stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,7 @@
 #define MCAST_ADDRESS_BASE "239.65.82.0"
 #define MCAST_PORT 57732U
 #define MCAST_MAGIC 0x2934U
+#define MCAST_MAGIC_BATCH 0x2935U
 #define MCAST_FLAG_CANFD 0x0001
 #define MCAST_MAX_PKT_LEN 74 // 64 byte data + 10 byte header
 
@@ -38,6 +39,33 @@ struct __attribute__((packed)) mcast_pkt
     uint8_t data[MCAST_MAX_PKT_LEN-10];
 };
 
+/*
+  datagram carrying several frames, the header is followed by
+  num_frames records of struct mcast_batch_frame and its data. The crc
+  covers everything after the crc field
+ */
+struct __attribute__((packed)) mcast_batch_pkt
+{
+    uint16_t magic;
+    uint16_t crc;
+    uint16_t flags;
+    uint16_t num_frames;
+};
+
+struct __attribute__((packed)) mcast_batch_frame
+{
+    uint32_t message_id;
+    uint8_t flags;
+    uint8_t data_len;
+};
+
+#if MCAST_MAX_DATAGRAM_LEN < MCAST_MAX_PKT_LEN || MCAST_MAX_DATAGRAM_LEN > 65507U
+# error "MCAST_MAX_DATAGRAM_LEN must fit a single frame packet and a UDP datagram"
+#endif
+#if MCAST_MAX_BATCH < 1U || MCAST_MAX_BATCH > 255U
+# error "MCAST_MAX_BATCH must be between 1 and 255"
+#endif
+
 // Returns the current errno as negated int16_t
 static int16_t getErrorCode()
 {
@@ -61,6 +89,14 @@ int16_t mcastInit(MCASTCANInstance* out_ins, const char* can_iface_name)
 {
     out_ins->fd_in = -1;
     out_ins->fd_out = -1;
+    out_ins->batching = false;
+    out_ins->rx_num_datagrams = 0;
+    out_ins->rx_next_datagram = 0;
+    out_ins->rx_offset = 0;
+    out_ins->rx_frames_left = 0;
+#if CANARD_ENABLE_CANFD
+    out_ins->canfd = canfd;
+#endif
     if (strncmp(can_iface_name, "mcast:", 6) != 0) {
         // invalid
         return -EINVAL;
@@ -161,6 +197,44 @@ int16_t mcastClose(MCASTCANInstance* ins)
     return 0;
 }
 
+/*
+  CCITT 16 bit CRC table, polynomial 0x1021
+ */
+static const uint16_t crc16_CCITT_table[256] = {
+    0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
+    0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU,
+    0x1231U, 0x0210U, 0x3273U, 0x2252U, 0x52B5U, 0x4294U, 0x72F7U, 0x62D6U,
+    0x9339U, 0x8318U, 0xB37BU, 0xA35AU, 0xD3BDU, 0xC39CU, 0xF3FFU, 0xE3DEU,
+    0x2462U, 0x3443U, 0x0420U, 0x1401U, 0x64E6U, 0x74C7U, 0x44A4U, 0x5485U,
+    0xA56AU, 0xB54BU, 0x8528U, 0x9509U, 0xE5EEU, 0xF5CFU, 0xC5ACU, 0xD58DU,
+    0x3653U, 0x2672U, 0x1611U, 0x0630U, 0x76D7U, 0x66F6U, 0x5695U, 0x46B4U,
+    0xB75BU, 0xA77AU, 0x9719U, 0x8738U, 0xF7DFU, 0xE7FEU, 0xD79DU, 0xC7BCU,
+    0x48C4U, 0x58E5U, 0x6886U, 0x78A7U, 0x0840U, 0x1861U, 0x2802U, 0x3823U,
+    0xC9CCU, 0xD9EDU, 0xE98EU, 0xF9AFU, 0x8948U, 0x9969U, 0xA90AU, 0xB92BU,
+    0x5AF5U, 0x4AD4U, 0x7AB7U, 0x6A96U, 0x1A71U, 0x0A50U, 0x3A33U, 0x2A12U,
+    0xDBFDU, 0xCBDCU, 0xFBBFU, 0xEB9EU, 0x9B79U, 0x8B58U, 0xBB3BU, 0xAB1AU,
+    0x6CA6U, 0x7C87U, 0x4CE4U, 0x5CC5U, 0x2C22U, 0x3C03U, 0x0C60U, 0x1C41U,
+    0xEDAEU, 0xFD8FU, 0xCDECU, 0xDDCDU, 0xAD2AU, 0xBD0BU, 0x8D68U, 0x9D49U,
+    0x7E97U, 0x6EB6U, 0x5ED5U, 0x4EF4U, 0x3E13U, 0x2E32U, 0x1E51U, 0x0E70U,
+    0xFF9FU, 0xEFBEU, 0xDFDDU, 0xCFFCU, 0xBF1BU, 0xAF3AU, 0x9F59U, 0x8F78U,
+    0x9188U, 0x81A9U, 0xB1CAU, 0xA1EBU, 0xD10CU, 0xC12DU, 0xF14EU, 0xE16FU,
+    0x1080U, 0x00A1U, 0x30C2U, 0x20E3U, 0x5004U, 0x4025U, 0x7046U, 0x6067U,
+    0x83B9U, 0x9398U, 0xA3FBU, 0xB3DAU, 0xC33DU, 0xD31CU, 0xE37FU, 0xF35EU,
+    0x02B1U, 0x1290U, 0x22F3U, 0x32D2U, 0x4235U, 0x5214U, 0x6277U, 0x7256U,
+    0xB5EAU, 0xA5CBU, 0x95A8U, 0x8589U, 0xF56EU, 0xE54FU, 0xD52CU, 0xC50DU,
+    0x34E2U, 0x24C3U, 0x14A0U, 0x0481U, 0x7466U, 0x6447U, 0x5424U, 0x4405U,
+    0xA7DBU, 0xB7FAU, 0x8799U, 0x97B8U, 0xE75FU, 0xF77EU, 0xC71DU, 0xD73CU,
+    0x26D3U, 0x36F2U, 0x0691U, 0x16B0U, 0x6657U, 0x7676U, 0x4615U, 0x5634U,
+    0xD94CU, 0xC96DU, 0xF90EU, 0xE92FU, 0x99C8U, 0x89E9U, 0xB98AU, 0xA9ABU,
+    0x5844U, 0x4865U, 0x7806U, 0x6827U, 0x18C0U, 0x08E1U, 0x3882U, 0x28A3U,
+    0xCB7DU, 0xDB5CU, 0xEB3FU, 0xFB1EU, 0x8BF9U, 0x9BD8U, 0xABBBU, 0xBB9AU,
+    0x4A75U, 0x5A54U, 0x6A37U, 0x7A16U, 0x0AF1U, 0x1AD0U, 0x2AB3U, 0x3A92U,
+    0xFD2EU, 0xED0FU, 0xDD6CU, 0xCD4DU, 0xBDAAU, 0xAD8BU, 0x9DE8U, 0x8DC9U,
+    0x7C26U, 0x6C07U, 0x5C64U, 0x4C45U, 0x3CA2U, 0x2C83U, 0x1CE0U, 0x0CC1U,
+    0xEF1FU, 0xFF3EU, 0xCF5DU, 0xDF7CU, 0xAF9BU, 0xBFBAU, 0x8FD9U, 0x9FF8U,
+    0x6E17U, 0x7E36U, 0x4E55U, 0x5E74U, 0x2E93U, 0x3EB2U, 0x0ED1U, 0x1EF0U
+};
+
 /*
   CCITT 16 bit CRC with starting value 0xFFFF
  */
@@ -168,26 +242,26 @@ static uint16_t crc16_CCITT(const uint8_t *bytes, uint32_t len)
 {
     uint16_t crc_val = 0xFFFFU;
     while (len--) {
-        const uint16_t byte = *bytes++;
-        crc_val ^= (uint16_t) (byte << 8U);
-        for (uint8_t j = 0; j < 8; j++) {
-            if (crc_val & 0x8000U) {
-                crc_val = (uint16_t) ((uint16_t) (crc_val << 1U) ^ 0x1021U);
-            } else {
-                crc_val = (uint16_t) (crc_val << 1U);
-            }
-        }
+        crc_val = (uint16_t) ((uint16_t) (crc_val << 8U) ^ crc16_CCITT_table[(uint8_t) ((crc_val >> 8U) ^ *bytes++)]);
     }
     return crc_val;
 }
 
+void mcastEnableBatching(MCASTCANInstance* ins, bool enable)
+{
+    ins->batching = enable;
+}
 
-int16_t mcastTransmit(MCASTCANInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec)
+/*
+  waits until the socket is ready for the given event.
+  Returns 1 when ready, 0 on timeout, negative on error
+ */
+static int16_t waitForEvent(int fd, short event, int32_t timeout_msec)
 {
     struct pollfd fds;
     memset(&fds, 0, sizeof(fds));
-    fds.fd = ins->fd_out;
-    fds.events |= POLLOUT;
+    fds.fd = fd;
+    fds.events |= event;
 
     const int poll_result = poll(&fds, 1, timeout_msec);
     if (poll_result < 0) {
@@ -196,66 +270,311 @@ int16_t mcastTransmit(MCASTCANInstance* ins, const CanardCANFrame* frame, int32_
     if (poll_result == 0) {
         return 0;
     }
-    if (((uint32_t)fds.revents & (uint32_t)POLLOUT) == 0) {
+    if (((uint32_t)fds.revents & (uint32_t)event) == 0) {
         return -EIO;
     }
+    return 1;
+}
+
+static uint8_t frameDataLen(const CanardCANFrame* frame)
+{
+#if CANARD_ENABLE_CANFD
+    const uint8_t max_len = frame->canfd ? CANARD_CANFD_FRAME_MAX_DATA_LEN : CANARD_CAN_FRAME_MAX_DATA_LEN;
+#else
+    const uint8_t max_len = CANARD_CAN_FRAME_MAX_DATA_LEN;
+#endif
+    return (frame->data_len > max_len) ? max_len : frame->data_len;
+}
 
-    struct mcast_pkt pkt;
-    pkt.magic = MCAST_MAGIC;
-    pkt.flags = 0;
+/*
+  writes a frame as a single frame packet, returns the length of the datagram
+ */
+static uint16_t packSingle(const CanardCANFrame* frame, uint8_t* buffer)
+{
+    struct mcast_pkt* pkt = (struct mcast_pkt*)buffer;
+    const uint8_t data_len = frameDataLen(frame);
+    pkt->magic = MCAST_MAGIC;
+    pkt->flags = 0;
 #if CANARD_ENABLE_CANFD
     if (frame->canfd) {
-        pkt.flags |= MCAST_FLAG_CANFD;
+        pkt->flags |= MCAST_FLAG_CANFD;
     }
 #endif
-    pkt.message_id = frame->id;
-    memcpy(pkt.data, frame->data, frame->data_len);
-    pkt.crc = crc16_CCITT((uint8_t*)&pkt.flags, frame->data_len+6);
-    if (send(ins->fd_out, (void*)&pkt, frame->data_len+10, 0) <= 0) {
-        return getErrorCode();
+    pkt->message_id = frame->id;
+    memcpy(pkt->data, frame->data, data_len);
+    pkt->crc = crc16_CCITT((uint8_t*)&pkt->flags, data_len+6U);
+    return (uint16_t)(data_len + 10U);
+}
+
+/*
+  writes as many frames as fit into a datagram of up to max_len bytes, a
+  lone frame is written as a single frame packet so that older nodes can
+  read it. Returns the number of frames written
+ */
+static uint16_t packBatch(const CanardCANFrame* frames, uint16_t num_frames, uint8_t* buffer, uint16_t max_len,
+                          uint16_t* out_len)
+{
+    uint16_t len = sizeof(struct mcast_batch_pkt);
+    uint16_t num_packed = 0;
+    while (num_packed < num_frames) {
+        const uint8_t data_len = frameDataLen(&frames[num_packed]);
+        if (len + sizeof(struct mcast_batch_frame) + data_len > max_len) {
+            break;
+        }
+        len = (uint16_t)(len + sizeof(struct mcast_batch_frame) + data_len);
+        num_packed++;
+    }
+    if (num_packed <= 1U) {
+        *out_len = packSingle(&frames[0], buffer);
+        return 1;
     }
 
-    return 1;
+    struct mcast_batch_pkt* pkt = (struct mcast_batch_pkt*)buffer;
+    pkt->magic = MCAST_MAGIC_BATCH;
+    pkt->flags = 0;
+    pkt->num_frames = num_packed;
+    uint16_t offset = sizeof(struct mcast_batch_pkt);
+    for (uint16_t i = 0; i < num_packed; i++) {
+        struct mcast_batch_frame* rec = (struct mcast_batch_frame*)&buffer[offset];
+        rec->message_id = frames[i].id;
+        rec->flags = 0;
+#if CANARD_ENABLE_CANFD
+        if (frames[i].canfd) {
+            rec->flags |= MCAST_FLAG_CANFD;
+        }
+#endif
+        rec->data_len = frameDataLen(&frames[i]);
+        memcpy(&buffer[offset + sizeof(struct mcast_batch_frame)], frames[i].data, rec->data_len);
+        offset = (uint16_t)(offset + sizeof(struct mcast_batch_frame) + rec->data_len);
+    }
+    pkt->crc = crc16_CCITT((uint8_t*)&pkt->flags, len-4U);
+    *out_len = len;
+    return num_packed;
 }
 
-int16_t mcastReceive(MCASTCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec)
+int16_t mcastTransmit(MCASTCANInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec)
 {
-    struct pollfd fds;
-    memset(&fds, 0, sizeof(fds));
-    fds.fd = ins->fd_in;
-    fds.events |= POLLIN;
+    return mcastTransmitBatch(ins, frame, 1, timeout_msec);
+}
 
-    memset(out_frame, 0, sizeof(*out_frame));
+int16_t mcastTransmitBatch(MCASTCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                           int32_t timeout_msec)
+{
+    // enough for MCAST_MAX_BATCH single frame packets, or one full datagram and some more
+    uint8_t buffer[MCAST_MAX_BATCH * MCAST_MAX_PKT_LEN + MCAST_MAX_DATAGRAM_LEN];
+    struct mmsghdr msgs[MCAST_MAX_BATCH];
+    struct iovec iovs[MCAST_MAX_BATCH];
+    uint16_t frames_in_datagram[MCAST_MAX_BATCH];
+
+    unsigned num_datagrams = 0;
+    uint16_t num_packed = 0;
+    size_t offset = 0;
+    while (num_packed < num_frames && num_datagrams < MCAST_MAX_BATCH && sizeof(buffer) - offset >= MCAST_MAX_PKT_LEN) {
+        uint16_t len = 0;
+        uint16_t num = 1;
+        if (ins->batching) {
+            const size_t space = sizeof(buffer) - offset;
+            num = packBatch(&frames[num_packed], (uint16_t)(num_frames - num_packed), &buffer[offset],
+                            (uint16_t)((space < MCAST_MAX_DATAGRAM_LEN) ? space : MCAST_MAX_DATAGRAM_LEN), &len);
+        } else {
+            len = packSingle(&frames[num_packed], &buffer[offset]);
+        }
+        iovs[num_datagrams].iov_base = &buffer[offset];
+        iovs[num_datagrams].iov_len = len;
+        memset(&msgs[num_datagrams], 0, sizeof(msgs[num_datagrams]));
+        msgs[num_datagrams].msg_hdr.msg_iov = &iovs[num_datagrams];
+        msgs[num_datagrams].msg_hdr.msg_iovlen = 1;
+        frames_in_datagram[num_datagrams] = num;
+        num_packed = (uint16_t)(num_packed + num);
+        offset += len;
+        num_datagrams++;
+    }
+    if (num_datagrams == 0) {
+        return 0;
+    }
 
-    const int poll_result = poll(&fds, 1, timeout_msec);
-    if (poll_result < 0) {
-        return getErrorCode();
+    int res = sendmmsg(ins->fd_out, msgs, num_datagrams, MSG_DONTWAIT);
+    if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeout_msec != 0) {
+        const int16_t wait_res = waitForEvent(ins->fd_out, POLLOUT, timeout_msec);
+        if (wait_res <= 0) {
+            return wait_res;
+        }
+        res = sendmmsg(ins->fd_out, msgs, num_datagrams, MSG_DONTWAIT);
     }
-    if (poll_result == 0) {
+    if (res < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : getErrorCode();
+    }
+
+    int16_t num_sent = 0;
+    for (int i = 0; i < res; i++) {
+        num_sent = (int16_t)(num_sent + frames_in_datagram[i]);
+    }
+    return num_sent;
+}
+
+/*
+  checks a received datagram, returns the number of frames in it, 0 if
+  it is corrupted
+ */
+static uint16_t checkDatagram(const uint8_t* buffer, uint16_t len)
+{
+    if (len < 4U) {
         return 0;
     }
-    if (((uint32_t)fds.revents & (uint32_t)POLLIN) == 0) {
-        return -EIO;
+    const uint16_t magic = ((const struct mcast_pkt*)buffer)->magic;
+    const uint16_t crc = ((const struct mcast_pkt*)buffer)->crc;
+    if (magic == MCAST_MAGIC) {
+        if (len < 10U || len > MCAST_MAX_PKT_LEN) {
+            return 0;
+        }
+        return (crc == crc16_CCITT(&buffer[4], len-4U)) ? 1U : 0U;
     }
-    struct mcast_pkt pkt;
-    ssize_t ret = recv(ins->fd_in, (void*)&pkt, sizeof(pkt), 0);
-    if (ret < 10) {
-        return -EIO;
+    if (magic != MCAST_MAGIC_BATCH || len < sizeof(struct mcast_batch_pkt)) {
+        return 0;
     }
-    if (pkt.magic != MCAST_MAGIC) {
-        return -EIO;
+    if (crc != crc16_CCITT(&buffer[4], len-4U)) {
+        return 0;
     }
-    if (pkt.crc != crc16_CCITT((uint8_t*)&pkt.flags, ret-4)) {
-        return -EIO;
+    // walk the records so that reading them later can't run past the end
+    const uint16_t num_frames = ((const struct mcast_batch_pkt*)buffer)->num_frames;
+    uint32_t offset = sizeof(struct mcast_batch_pkt);
+    for (uint16_t i = 0; i < num_frames; i++) {
+        if (offset + sizeof(struct mcast_batch_frame) > len) {
+            return 0;
+        }
+        offset += sizeof(struct mcast_batch_frame) + ((const struct mcast_batch_frame*)&buffer[offset])->data_len;
     }
+    return (offset == len) ? num_frames : 0U;
+}
 
-    out_frame->id = pkt.message_id;
+/*
+  fills a frame from the data of a packet, returns false if it doesn't fit
+ */
+static bool unpackFrame(uint32_t message_id, uint16_t flags, const uint8_t* data, uint32_t data_len,
+                        CanardCANFrame* out_frame)
+{
+    memset(out_frame, 0, sizeof(*out_frame));
 #if CANARD_ENABLE_CANFD
-    out_frame->canfd = (pkt.flags & MCAST_FLAG_CANFD) != 0;
+    out_frame->canfd = (flags & MCAST_FLAG_CANFD) != 0;
+    const uint32_t max_len = out_frame->canfd ? CANARD_CANFD_FRAME_MAX_DATA_LEN : CANARD_CAN_FRAME_MAX_DATA_LEN;
+#else
+    (void)flags;
+    const uint32_t max_len = CANARD_CAN_FRAME_MAX_DATA_LEN;
 #endif
-    memcpy(out_frame->data, pkt.data, ret-10);
-    out_frame->data_len = ret - 10;
+    if (data_len > max_len) {
+        return false;
+    }
+    out_frame->id = message_id;
+    memcpy(out_frame->data, data, data_len);
+    out_frame->data_len = (uint8_t)data_len;
+    return true;
+}
 
-    return 1;
+/*
+  reads frames from the buffered datagrams. Returns the number of frames,
+  *out_dropped is set if a corrupted datagram was skipped
+ */
+static uint16_t readBuffered(MCASTCANInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames, bool* out_dropped)
+{
+    uint16_t num = 0;
+    while (num < max_frames && ins->rx_next_datagram < ins->rx_num_datagrams) {
+        const uint8_t* buffer = ins->rx_datagrams[ins->rx_next_datagram];
+        const uint16_t len = ins->rx_lengths[ins->rx_next_datagram];
+        if (ins->rx_offset == 0U) {
+            // first look at this datagram
+            ins->rx_frames_left = checkDatagram(buffer, len);
+            if (ins->rx_frames_left == 0U) {
+                *out_dropped = true;
+                ins->rx_next_datagram++;
+                continue;
+            }
+            if (((const struct mcast_pkt*)buffer)->magic == MCAST_MAGIC) {
+                const struct mcast_pkt* pkt = (const struct mcast_pkt*)buffer;
+                if (unpackFrame(pkt->message_id, pkt->flags, pkt->data, len-10U, &out_frames[num])) {
+                    num++;
+                } else {
+                    *out_dropped = true;
+                }
+                ins->rx_next_datagram++;
+                continue;
+            }
+            ins->rx_offset = sizeof(struct mcast_batch_pkt);
+        }
+        const struct mcast_batch_frame* rec = (const struct mcast_batch_frame*)&buffer[ins->rx_offset];
+        if (unpackFrame(rec->message_id, rec->flags, &buffer[ins->rx_offset + sizeof(struct mcast_batch_frame)],
+                        rec->data_len, &out_frames[num])) {
+            num++;
+        } else {
+            *out_dropped = true;
+        }
+        ins->rx_offset = (uint16_t)(ins->rx_offset + sizeof(struct mcast_batch_frame) + rec->data_len);
+        if (--ins->rx_frames_left == 0U) {
+            ins->rx_offset = 0;
+            ins->rx_next_datagram++;
+        }
+    }
+    return num;
+}
+
+int16_t mcastReceive(MCASTCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec)
+{
+    return mcastReceiveBatch(ins, out_frame, 1, timeout_msec);
 }
 
+int16_t mcastReceiveBatch(MCASTCANInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames,
+                          int32_t timeout_msec)
+{
+    struct mmsghdr msgs[MCAST_MAX_BATCH];
+    struct iovec iovs[MCAST_MAX_BATCH];
+    uint16_t num = 0;
+    bool dropped = false;
+    bool waited = false;
+
+    while (num < max_frames) {
+        num = (uint16_t)(num + readBuffered(ins, &out_frames[num], (uint16_t)(max_frames - num), &dropped));
+        if (num >= max_frames) {
+            break;
+        }
+
+        // everything buffered is read, get the next datagrams
+        memset(msgs, 0, sizeof(msgs));
+        for (unsigned i = 0; i < MCAST_MAX_BATCH; i++) {
+            iovs[i].iov_base = ins->rx_datagrams[i];
+            iovs[i].iov_len = MCAST_MAX_DATAGRAM_LEN;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        ins->rx_num_datagrams = 0;
+        ins->rx_next_datagram = 0;
+        ins->rx_offset = 0;
+        const int res = recvmmsg(ins->fd_in, msgs, MCAST_MAX_BATCH, MSG_DONTWAIT, NULL);
+        if (res > 0) {
+            for (int i = 0; i < res; i++) {
+                // a truncated datagram fails the check
+                ins->rx_lengths[i] = ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) ? 0U : (uint16_t)msgs[i].msg_len;
+            }
+            ins->rx_num_datagrams = (uint8_t)res;
+            continue;
+        }
+        if (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            if (num > 0) {
+                break;
+            }
+            return getErrorCode();
+        }
+        // a skipped datagram is reported right away rather than lost in a timeout
+        if (num > 0 || dropped || waited || timeout_msec == 0) {
+            break;
+        }
+        const int16_t wait_res = waitForEvent(ins->fd_in, POLLIN, timeout_msec);
+        if (wait_res <= 0) {
+            return wait_res;
+        }
+        waited = true;
+    }
+
+    if (num == 0 && dropped) {
+        return -EIO;
+    }
+    return (int16_t)num;
+}
@@ -14,6 +14,22 @@ extern "C"
 {
 #endif
 
+/*
+ Maximum number of datagrams moved by one system call of mcastReceiveBatch() or mcastTransmitBatch().
+ The instance buffers this many received datagrams of MCAST_MAX_DATAGRAM_LEN bytes.
+ */
+#ifndef MCAST_MAX_BATCH
+#define MCAST_MAX_BATCH 16U
+#endif
+
+/*
+ Maximum size of a datagram carrying several frames, it has to be the same on all nodes of a bus.
+ The default fits into one Ethernet frame.
+ */
+#ifndef MCAST_MAX_DATAGRAM_LEN
+#define MCAST_MAX_DATAGRAM_LEN 1200U
+#endif
+
 typedef struct
 {
     int fd_in;
@@ -21,6 +37,15 @@ typedef struct
 #ifdef CANARD_ENABLE_CANFD
     bool canfd;
 #endif
+    bool batching;
+
+    // received datagrams that haven't been read completely yet
+    uint8_t rx_datagrams[MCAST_MAX_BATCH][MCAST_MAX_DATAGRAM_LEN];
+    uint16_t rx_lengths[MCAST_MAX_BATCH];
+    uint8_t rx_num_datagrams;
+    uint8_t rx_next_datagram;
+    uint16_t rx_offset;
+    uint16_t rx_frames_left;
 } MCASTCANInstance;
 
 /*
@@ -53,6 +78,32 @@ int16_t mcastTransmit(MCASTCANInstance* ins, const CanardCANFrame* frame, int32_
  */
 int16_t mcastReceive(MCASTCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec);
 
+/*
+ Selects the packet format used for transmission. Disabled by default, every frame goes out as a
+ datagram of its own that all versions of this driver understand. When enabled, the frames passed to
+ one mcastTransmitBatch() call are packed into as few datagrams as possible, which only nodes with
+ this version of the driver can read. Both formats are always accepted on reception.
+ */
+void mcastEnableBatching(MCASTCANInstance* ins, bool enable);
+
+/*
+ Transmits up to num_frames frames, in order, with one system call.
+ The timeout applies only if the socket can't take a datagram right away; use negative timeout to block infinitely.
+ Returns the number of frames transmitted, 0 on timeout, negative on error.
+ */
+int16_t mcastTransmitBatch(MCASTCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                           int32_t timeout_msec);
+
+/*
+ Receives up to max_frames frames, reading up to MCAST_MAX_BATCH datagrams with one system call.
+ Frames of a datagram that don't fit into out_frames are returned by the next call.
+ The timeout applies only if no frame is available; use negative timeout to block infinitely.
+ Returns the number of frames received, 0 on timeout, negative on error.
+ Corrupted datagrams are skipped, -EIO is returned if nothing else was received.
+ */
+int16_t mcastReceiveBatch(MCASTCANInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames,
+                          int32_t timeout_msec);
+
 #ifdef __cplusplus
 }
 #endif
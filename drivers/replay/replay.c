@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+/*
+  capture reader: the file is mapped once and every record is decoded
+  straight from the mapping into a CanardCANFrame, without copying lines
+  or calling the stdio parsers
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include "replay.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PCAP_MAGIC              0xA1B2C3D4U
+#define PCAP_MAGIC_NSEC         0xA1B23C4DU
+#define PCAP_MAGIC_SWAPPED      0xD4C3B2A1U
+#define PCAP_MAGIC_NSEC_SWAPPED 0x4D3CB2A1U
+#define PCAPNG_MAGIC            0x0A0D0D0AU
+#define PCAP_HEADER_LEN         24U
+#define PCAP_RECORD_HEADER_LEN  16U
+#define PCAP_LINKTYPE_OFFSET    20U
+#define LINKTYPE_CAN_SOCKETCAN  227U
+
+// struct can_frame and struct canfd_frame as the capture holds them, the identifier in network byte order
+#define SOCKETCAN_HEADER_LEN    8U
+#define SOCKETCAN_FD_FLAGS_FDF  0x04U
+#define SOCKETCAN_CANFD_MTU     72U
+
+#define CAN_STD_ID_DIGITS       3U
+#define CANFD_MAX_DATA_LEN      64U
+
+static uint32_t readU32(const uint8_t* p, bool swapped)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return swapped ? __builtin_bswap32(value) : value;
+}
+
+int16_t replayOpenBuffer(ReplayCapture* out_cap, const void* data, size_t size)
+{
+    if (out_cap == NULL || (data == NULL && size > 0U)) {
+        return -EINVAL;
+    }
+    memset(out_cap, 0, sizeof(*out_cap));
+    out_cap->data = (const uint8_t*)data;
+    out_cap->size = size;
+    out_cap->format = ReplayFormatCandump;
+    if (size < sizeof(uint32_t)) {
+        return 0;
+    }
+
+    const uint32_t magic = readU32(out_cap->data, false);
+    if (magic == PCAPNG_MAGIC) {
+        return -EPROTONOSUPPORT;
+    }
+    if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NSEC && magic != PCAP_MAGIC_SWAPPED &&
+        magic != PCAP_MAGIC_NSEC_SWAPPED) {
+        return 0;
+    }
+    if (size < PCAP_HEADER_LEN) {
+        return -EINVAL;
+    }
+    out_cap->format = ReplayFormatPcap;
+    out_cap->swapped = (magic == PCAP_MAGIC_SWAPPED || magic == PCAP_MAGIC_NSEC_SWAPPED);
+    out_cap->nsec = (magic == PCAP_MAGIC_NSEC || magic == PCAP_MAGIC_NSEC_SWAPPED);
+    if (readU32(&out_cap->data[PCAP_LINKTYPE_OFFSET], out_cap->swapped) != LINKTYPE_CAN_SOCKETCAN) {
+        return -EPROTONOSUPPORT;
+    }
+    out_cap->offset = PCAP_HEADER_LEN;
+    return 0;
+}
+
+int16_t replayOpen(ReplayCapture* out_cap, const char* path)
+{
+    if (out_cap == NULL || path == NULL) {
+        return -EINVAL;
+    }
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return (int16_t)-errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        const int err = errno;
+        (void)close(fd);
+        return (int16_t)-err;
+    }
+
+    void* data = NULL;
+    const size_t size = (size_t)st.st_size;
+    if (size > 0U) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int err = errno;
+            (void)close(fd);
+            return (int16_t)-err;
+        }
+        // read once front to back
+        (void)madvise(data, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+    }
+    (void)close(fd);
+
+    const int16_t res = replayOpenBuffer(out_cap, data, size);
+    if (res < 0) {
+        if (data != NULL) {
+            (void)munmap(data, size);
+        }
+        return res;
+    }
+    out_cap->mapped = (data != NULL);
+    return 0;
+}
+
+void replayClose(ReplayCapture* cap)
+{
+    if (cap->mapped) {
+        (void)munmap((void*)cap->data, cap->size);
+    }
+    cap->mapped = false;
+    cap->data = NULL;
+    cap->size = 0;
+    cap->offset = 0;
+}
+
+void replayRewind(ReplayCapture* cap)
+{
+    cap->offset = (cap->format == ReplayFormatPcap) ? PCAP_HEADER_LEN : 0U;
+}
+
+static int8_t hexValue(uint8_t c)
+{
+    if (c >= '0' && c <= '9') {
+        return (int8_t)(c - '0');
+    }
+    c = (uint8_t)(c | 0x20U);   // lower case
+    if (c >= 'a' && c <= 'f') {
+        return (int8_t)(c - 'a' + 10);
+    }
+    return -1;
+}
+
+static bool isBlank(uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static uint8_t ifaceIndex(ReplayCapture* cap, const uint8_t* name, size_t len)
+{
+    if (len >= REPLAY_IFACE_NAME_LEN) {
+        len = REPLAY_IFACE_NAME_LEN - 1U;
+    }
+    for (uint8_t i = 0; i < cap->num_ifaces; i++) {
+        if (memcmp(cap->ifaces[i], name, len) == 0 && cap->ifaces[i][len] == '\0') {
+            return i;
+        }
+    }
+    if (cap->num_ifaces >= REPLAY_MAX_IFACES) {
+        cap->merged++;
+        return REPLAY_MAX_IFACES - 1U;
+    }
+    memcpy(cap->ifaces[cap->num_ifaces], name, len);
+    cap->ifaces[cap->num_ifaces][len] = '\0';
+    return cap->num_ifaces++;
+}
+
+/*
+  parses one line of a candump log between p and end:
+  "(1436509052.249713) can0 1F400A0A#0102" for classic frames,
+  "(...) can0 1F400A0A##10102" for CAN FD frames, the digit after ## being
+  the FD flags, and "(...) can0 123#R" for remote frames. Anything after
+  the data, like the direction candump -x adds, is ignored.
+  Returns 1 for a frame, 0 for a line to skip, -1 if it is malformed
+ */
+static int8_t parseCandumpLine(ReplayCapture* cap, const uint8_t* p, const uint8_t* end,
+                               CanardCANFrame* out_frame, uint64_t* out_timestamp_usec)
+{
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    if (p == end) {
+        return 0;
+    }
+    if (*p != '(') {
+        return -1;
+    }
+    p++;
+
+    uint64_t sec = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        sec = sec * 10U + (uint64_t)(*p - '0');
+        p++;
+    }
+    if (p == end || *p != '.') {
+        return -1;
+    }
+    p++;
+    uint64_t usec = 0;
+    uint8_t digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 6U) {
+            usec = usec * 10U + (uint64_t)(*p - '0');
+            digits++;
+        }
+        p++;
+    }
+    for (; digits < 6U; digits++) {
+        usec *= 10U;
+    }
+    if (p == end || *p != ')') {
+        return -1;
+    }
+    p++;
+    *out_timestamp_usec = sec * 1000000U + usec;
+
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    const uint8_t* iface = p;
+    while (p < end && !isBlank(*p)) {
+        p++;
+    }
+    const size_t iface_len = (size_t)(p - iface);
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    if (iface_len == 0U || p == end) {
+        return -1;
+    }
+
+    uint32_t id = 0;
+    uint8_t id_digits = 0;
+    int8_t nibble;
+    while (p < end && (nibble = hexValue(*p)) >= 0) {
+        id = (id << 4U) | (uint8_t)nibble;
+        id_digits++;
+        p++;
+    }
+    if (p == end || *p != '#' || id_digits == 0U || id_digits > 8U) {
+        return -1;
+    }
+    p++;
+
+    memset(out_frame, 0, sizeof(*out_frame));
+    if (id_digits > CAN_STD_ID_DIGITS) {
+        // error frames are written with the error flag in the identifier
+        id = ((id & CANARD_CAN_FRAME_ERR) != 0U) ? id : ((id & CANARD_CAN_EXT_ID_MASK) | CANARD_CAN_FRAME_EFF);
+    } else if (id > CANARD_CAN_STD_ID_MASK) {
+        return -1;
+    }
+
+    bool canfd = false;
+    uint8_t max_len = CANARD_CAN_FRAME_MAX_DATA_LEN;
+    if (p < end && *p == '#') {
+        p++;
+        if (p == end || hexValue(*p) < 0) {
+            return -1;
+        }
+        p++;                                // FD flags, BRS and ESI make no difference here
+        canfd = true;
+        max_len = CANFD_MAX_DATA_LEN;
+    } else if (p < end && (*p == 'R' || *p == 'r')) {
+        id |= CANARD_CAN_FRAME_RTR;
+        p++;
+        if (p < end && hexValue(*p) >= 0) {
+            p++;                            // requested length, there is no data to keep it in
+        }
+    }
+
+    uint8_t data[CANFD_MAX_DATA_LEN];
+    uint8_t len = 0;
+    while (p < end && !isBlank(*p)) {
+        if (*p == '.') {
+            p++;
+            continue;
+        }
+        int8_t hi;
+        int8_t lo;
+        if (len >= max_len || end - p < 2 || (hi = hexValue(p[0])) < 0 || (lo = hexValue(p[1])) < 0) {
+            return -1;
+        }
+        data[len++] = (uint8_t)((hi << 4) | lo);
+        p += 2;
+    }
+
+#if CANARD_ENABLE_CANFD
+    out_frame->canfd = canfd;
+#else
+    if (canfd) {
+        cap->unsupported++;
+        return 0;
+    }
+#endif
+    out_frame->id = id;
+    memcpy(out_frame->data, data, len);
+    out_frame->data_len = len;
+    out_frame->iface_id = ifaceIndex(cap, iface, iface_len);
+    return 1;
+}
+
+static int16_t nextCandump(ReplayCapture* cap, CanardCANFrame* out_frame, uint64_t* out_timestamp_usec)
+{
+    while (cap->offset < cap->size) {
+        const uint8_t* line = &cap->data[cap->offset];
+        const uint8_t* newline = memchr(line, '\n', cap->size - cap->offset);
+        const uint8_t* end = (newline != NULL) ? newline : &cap->data[cap->size];
+        cap->offset = (newline != NULL) ? (size_t)(newline - cap->data) + 1U : cap->size;
+
+        const int8_t res = parseCandumpLine(cap, line, end, out_frame, out_timestamp_usec);
+        if (res > 0) {
+            return 1;
+        }
+        if (res < 0) {
+            cap->malformed++;
+        }
+    }
+    return 0;
+}
+
+static int16_t nextPcap(ReplayCapture* cap, CanardCANFrame* out_frame, uint64_t* out_timestamp_usec)
+{
+    while (cap->size - cap->offset >= PCAP_RECORD_HEADER_LEN) {
+        const uint8_t* record = &cap->data[cap->offset];
+        const uint32_t sec = readU32(&record[0], cap->swapped);
+        const uint32_t frac = readU32(&record[4], cap->swapped);
+        const uint32_t incl_len = readU32(&record[8], cap->swapped);
+        if (incl_len > cap->size - cap->offset - PCAP_RECORD_HEADER_LEN) {
+            // cut off at the end
+            cap->malformed++;
+            cap->offset = cap->size;
+            return 0;
+        }
+        cap->offset += PCAP_RECORD_HEADER_LEN + incl_len;
+
+        const uint8_t* packet = &record[PCAP_RECORD_HEADER_LEN];
+        if (incl_len < SOCKETCAN_HEADER_LEN) {
+            cap->malformed++;
+            continue;
+        }
+        const uint32_t can_id = ((uint32_t)packet[0] << 24U) | ((uint32_t)packet[1] << 16U) |
+                                ((uint32_t)packet[2] << 8U) | (uint32_t)packet[3];
+        const uint8_t len = packet[4];
+        const bool canfd = ((packet[5] & SOCKETCAN_FD_FLAGS_FDF) != 0U) || incl_len == SOCKETCAN_CANFD_MTU ||
+                           len > CANARD_CAN_FRAME_MAX_DATA_LEN;
+        if (len > CANFD_MAX_DATA_LEN || (size_t)len > incl_len - SOCKETCAN_HEADER_LEN) {
+            cap->malformed++;
+            continue;
+        }
+#if !CANARD_ENABLE_CANFD
+        if (canfd) {
+            cap->unsupported++;
+            continue;
+        }
+#endif
+        // the flags of struct can_frame and CanardCANFrame are the same
+        memset(out_frame, 0, sizeof(*out_frame));
+#if CANARD_ENABLE_CANFD
+        out_frame->canfd = canfd;
+#endif
+        out_frame->id = can_id;
+        memcpy(out_frame->data, &packet[SOCKETCAN_HEADER_LEN], len);
+        out_frame->data_len = len;
+        out_frame->iface_id = 0;
+        *out_timestamp_usec = (uint64_t)sec * 1000000U + (cap->nsec ? frac / 1000U : frac);
+        return 1;
+    }
+    if (cap->offset < cap->size) {
+        cap->malformed++;
+        cap->offset = cap->size;
+    }
+    return 0;
+}
+
+int16_t replayNext(ReplayCapture* cap, CanardCANFrame* out_frame, uint64_t* out_timestamp_usec)
+{
+    if (cap->format == ReplayFormatPcap) {
+        return nextPcap(cap, out_frame, out_timestamp_usec);
+    }
+    return nextCandump(cap, out_frame, out_timestamp_usec);
+}
+
+static uint64_t monotonicNsec(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleepUntilNsec(uint64_t deadline_nsec)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_nsec / 1000000000ULL);
+    ts.tv_nsec = (long)(deadline_nsec % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+int16_t replayRun(ReplayCapture* cap, CanardInstance* ins, float speed, ReplayStatistics* stats)
+{
+    if (cap == NULL || ins == NULL || stats == NULL || !(speed >= 0.0F)) {
+        return -EINVAL;
+    }
+    CanardCANFrame frame;
+    uint64_t timestamp_usec = 0;
+    uint64_t start_usec = 0;
+    uint64_t start_nsec = 0;
+    uint64_t next_cleanup_usec = 0;
+    bool started = false;
+    while (replayNext(cap, &frame, &timestamp_usec) > 0) {
+        if (!started) {
+            started = true;
+            start_usec = timestamp_usec;
+            start_nsec = monotonicNsec();
+            next_cleanup_usec = timestamp_usec + CANARD_RECOMMENDED_STALE_TRANSFER_CLEANUP_INTERVAL_USEC;
+            if (stats->frames == 0U) {
+                stats->first_timestamp_usec = timestamp_usec;
+            }
+        }
+        if (speed > 0.0F && timestamp_usec > start_usec) {
+            const double offset_nsec = (double)(timestamp_usec - start_usec) * 1000.0 / (double)speed;
+            sleepUntilNsec(start_nsec + (uint64_t)offset_nsec);
+        }
+        if (timestamp_usec >= next_cleanup_usec) {
+            canardCleanupStaleTransfers(ins, timestamp_usec);
+            next_cleanup_usec = timestamp_usec + CANARD_RECOMMENDED_STALE_TRANSFER_CLEANUP_INTERVAL_USEC;
+        }
+
+        const int16_t res = canardHandleRxFrame(ins, &frame, timestamp_usec);
+        stats->frames++;
+        if (res >= 0) {
+            stats->accepted++;
+        } else {
+            const uint16_t code = (uint16_t)-res;
+            stats->errors[(code < REPLAY_NUM_ERROR_CODES) ? code : 0U]++;
+        }
+        stats->last_timestamp_usec = timestamp_usec;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+/*
+  reads captured CAN traffic and feeds it to canardHandleRxFrame(), to
+  look at logs from the field with the library and to measure reception
+  on real traffic. Captures are mapped into memory and parsed in place
+ */
+
+#pragma once
+
+#include <canard.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ Maximum number of interfaces told apart in a candump log. Frames of
+ further interfaces get the last iface_id and are counted in
+ ReplayCapture.merged.
+ */
+#ifndef REPLAY_MAX_IFACES
+#define REPLAY_MAX_IFACES 8U
+#endif
+
+#define REPLAY_IFACE_NAME_LEN 16U
+
+/*
+ Error codes counted separately in ReplayStatistics, from 0 to
+ CANARD_ERROR_RX_BAD_CRC. Others are counted with code 0.
+ */
+#define REPLAY_NUM_ERROR_CODES (CANARD_ERROR_RX_BAD_CRC + 1U)
+
+typedef enum
+{
+    ReplayFormatCandump,            // log of candump -l or -L
+    ReplayFormatPcap                // pcap with link type LINKTYPE_CAN_SOCKETCAN
+} ReplayFormat;
+
+typedef struct
+{
+    const uint8_t* data;
+    size_t size;
+    size_t offset;                  // next record
+    bool mapped;                    // data is a mapping of a file, unmapped by replayClose()
+
+    ReplayFormat format;
+    bool swapped;                   // the pcap headers are in the other byte order
+    bool nsec;                      // the pcap timestamps are in nanoseconds
+
+    // interfaces of a candump log in the order they first appear, their index is the iface_id
+    char ifaces[REPLAY_MAX_IFACES][REPLAY_IFACE_NAME_LEN];
+    uint8_t num_ifaces;
+
+    uint64_t malformed;             // records that could not be parsed
+    uint64_t unsupported;           // CAN FD frames in a build without CANARD_ENABLE_CANFD
+    uint64_t merged;                // frames of interfaces past REPLAY_MAX_IFACES, given the last iface_id
+} ReplayCapture;
+
+typedef struct
+{
+    uint64_t frames;                // frames given to canardHandleRxFrame()
+    uint64_t accepted;              // frames it returned CANARD_OK for
+    uint64_t errors[REPLAY_NUM_ERROR_CODES];  // frames it rejected, by negated error code
+    uint64_t first_timestamp_usec;
+    uint64_t last_timestamp_usec;
+} ReplayStatistics;
+
+/*
+ Maps a capture file into memory. The format is detected from the
+ contents: pcap by its magic number, a candump log otherwise.
+ Returns 0 on success, negative on error.
+ */
+int16_t replayOpen(ReplayCapture* out_cap, const char* path);
+
+/*
+ Reads a capture that is already in memory. The buffer must stay valid
+ until replayClose().
+ Returns 0 on success, negative on error.
+ */
+int16_t replayOpenBuffer(ReplayCapture* out_cap, const void* data, size_t size);
+
+/*
+ Unmaps the capture file.
+ */
+void replayClose(ReplayCapture* cap);
+
+/*
+ Goes back to the first frame of the capture.
+ */
+void replayRewind(ReplayCapture* cap);
+
+/*
+ Reads the next frame of the capture with the time it was captured.
+ Records that are malformed or hold frames this build can't represent
+ are counted and skipped.
+ Returns 1 if a frame was read, 0 at the end of the capture.
+ */
+int16_t replayNext(ReplayCapture* cap, CanardCANFrame* out_frame, uint64_t* out_timestamp_usec);
+
+/*
+ Feeds the frames from the current position to the end of the capture
+ to the instance, with the capture timestamps, and cleans up stale
+ transfers as time goes on in the capture.
+ With speed 0 frames are fed as fast as possible. Otherwise they are
+ fed at the recorded timing, sped up by this factor.
+ Statistics are added to stats, which the caller zeroes first.
+ Returns 0 on success, negative on error.
+ */
+int16_t replayRun(ReplayCapture* cap, CanardInstance* ins, float speed, ReplayStatistics* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+/*
+  CAN bus for nodes on one host: all frames go through a ring in a
+  shared memory segment. Every transmission claims the next sequence
+  numbers of the ring, so all nodes see the frames in the same order,
+  and waiting receivers are woken with a futex on the segment. A futex
+  can't be given to epoll, so for that a thread of the node turns the
+  wakeups into an eventfd
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include "shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define SHMCAN_NAME_BASE "/canard_shm_0"
+#define SHMCAN_MAGIC 0x5343414EU // "SCAN"
+#define SHMCAN_VERSION 1U
+#define SHMCAN_SLOT_BUSY UINT64_MAX
+#define SHMCAN_MAX_DATA_LEN 64U
+#define SHMCAN_ATTACH_TIMEOUT_MSEC 1000
+
+#if (SHMCAN_RING_FRAMES & (SHMCAN_RING_FRAMES - 1U)) != 0 || SHMCAN_RING_FRAMES < SHMCAN_MAX_BATCH
+# error "SHMCAN_RING_FRAMES must be a power of two not smaller than SHMCAN_MAX_BATCH"
+#endif
+
+typedef struct
+{
+    uint64_t sequence;  // sequence number + 1 once the frame is complete, SHMCAN_SLOT_BUSY while it is written
+    uint32_t node_tag;
+    uint32_t id;
+    uint8_t data_len;
+    uint8_t canfd;
+    uint8_t data[SHMCAN_MAX_DATA_LEN];
+} SHMCANSlot;
+
+struct SHMCANBus
+{
+    uint32_t magic;             // written last by the node that creates the segment
+    uint32_t version;
+    uint32_t ring_frames;
+    uint32_t next_node_tag;
+
+    // written by every transmission, kept apart from the rest
+    uint64_t head __attribute__((aligned(64)));         // next sequence number to claim
+    uint32_t wake_count __attribute__((aligned(64)));   // futex word, bumped after every transmission
+    uint32_t waiters;
+
+    SHMCANSlot slots[SHMCAN_RING_FRAMES] __attribute__((aligned(64)));
+};
+
+static int16_t parseBusName(const char* can_iface_name, char* out_path)
+{
+    if (strncmp(can_iface_name, "shm:", 4) != 0) {
+        return -EINVAL;
+    }
+    int bus_num = 0;
+    if (strlen(can_iface_name) > 4) {
+        bus_num = atoi(can_iface_name+4);
+        if (bus_num < 0 || bus_num > 9) {
+            return -EINVAL;
+        }
+    }
+    strcpy(out_path, SHMCAN_NAME_BASE);
+    out_path[strlen(out_path)-1] = (char)('0' + bus_num);
+    return 0;
+}
+
+static uint64_t monotonicMsec(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static void sleepMsec(long msec)
+{
+    struct timespec ts = { 0, msec * 1000000L };
+    (void)nanosleep(&ts, NULL);
+}
+
+/*
+  opens the segment of the bus, creating it if it doesn't exist yet.
+  Returns the mapped bus or NULL with errno set
+ */
+static SHMCANBus* attachBus(const char* path)
+{
+    bool creator = true;
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, SHMCAN_MODE);
+    if (fd < 0) {
+        if (errno != EEXIST) {
+            return NULL;
+        }
+        creator = false;
+        fd = shm_open(path, O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0) {
+            return NULL;
+        }
+    }
+
+    int attempts = 0;
+    if (creator) {
+        if (ftruncate(fd, sizeof(SHMCANBus)) < 0) {
+            const int error = errno;
+            (void)close(fd);
+            (void)shm_unlink(path);
+            errno = error;
+            return NULL;
+        }
+    } else {
+        // the creator may not have sized it yet
+        struct stat st;
+        while (fstat(fd, &st) == 0 && st.st_size == 0 && attempts++ < SHMCAN_ATTACH_TIMEOUT_MSEC) {
+            sleepMsec(1);
+        }
+        if (st.st_size != (off_t)sizeof(SHMCANBus)) {
+            (void)close(fd);
+            errno = (st.st_size == 0) ? ETIMEDOUT : EPROTO;
+            return NULL;
+        }
+    }
+
+    void* mem = mmap(NULL, sizeof(SHMCANBus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    (void)close(fd);
+    if (mem == MAP_FAILED) {
+        errno = error;
+        return NULL;
+    }
+    SHMCANBus* bus = (SHMCANBus*)mem;
+
+    if (creator) {
+        // ftruncate() zeroed the segment
+        bus->version = SHMCAN_VERSION;
+        bus->ring_frames = SHMCAN_RING_FRAMES;
+        __atomic_store_n(&bus->magic, SHMCAN_MAGIC, __ATOMIC_RELEASE);
+        return bus;
+    }
+
+    attempts = 0;
+    while (__atomic_load_n(&bus->magic, __ATOMIC_ACQUIRE) != SHMCAN_MAGIC && attempts++ < SHMCAN_ATTACH_TIMEOUT_MSEC) {
+        sleepMsec(1);
+    }
+    if (__atomic_load_n(&bus->magic, __ATOMIC_ACQUIRE) != SHMCAN_MAGIC ||
+        bus->version != SHMCAN_VERSION || bus->ring_frames != SHMCAN_RING_FRAMES) {
+        (void)munmap(mem, sizeof(SHMCANBus));
+        errno = (bus->magic != SHMCAN_MAGIC) ? ETIMEDOUT : EPROTO;
+        return NULL;
+    }
+    return bus;
+}
+
+#if CANARD_ENABLE_CANFD
+int16_t shmcanInit(SHMCANInstance* out_ins, const char* can_iface_name, bool canfd)
+#else
+int16_t shmcanInit(SHMCANInstance* out_ins, const char* can_iface_name)
+#endif
+{
+    memset(out_ins, 0, sizeof(*out_ins));
+    out_ins->event_fd = -1;
+#if CANARD_ENABLE_CANFD
+    out_ins->canfd = canfd;
+#endif
+    char path[] = SHMCAN_NAME_BASE;
+    const int16_t res = parseBusName(can_iface_name, path);
+    if (res < 0) {
+        return res;
+    }
+
+    out_ins->bus = attachBus(path);
+    if (out_ins->bus == NULL) {
+        return (int16_t)-errno;
+    }
+    out_ins->node_tag = __atomic_add_fetch(&out_ins->bus->next_node_tag, 1U, __ATOMIC_RELAXED);
+    // frames sent before this node joined are not received
+    out_ins->read_sequence = __atomic_load_n(&out_ins->bus->head, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+/*
+  waits on the futex of the bus and signals the eventfd of the node
+  whenever another transmission happened
+ */
+static void* eventThreadMain(void* arg)
+{
+    SHMCANInstance* ins = (SHMCANInstance*)arg;
+    SHMCANBus* const bus = ins->bus;
+    const uint64_t one = 1U;
+
+    // registered for good, so that every transmission wakes this thread
+    __atomic_fetch_add(&bus->waiters, 1U, __ATOMIC_SEQ_CST);
+    uint32_t seen = __atomic_load_n(&bus->wake_count, __ATOMIC_SEQ_CST);
+    // frames may have come before the thread started
+    (void)write(ins->event_fd, &one, sizeof(one));
+    while (__atomic_load_n(&ins->event_stop, __ATOMIC_ACQUIRE) == 0U) {
+        (void)syscall(SYS_futex, &bus->wake_count, FUTEX_WAIT, seen, NULL, NULL, 0);
+        const uint32_t wake_count = __atomic_load_n(&bus->wake_count, __ATOMIC_SEQ_CST);
+        if (wake_count != seen) {
+            seen = wake_count;
+            (void)write(ins->event_fd, &one, sizeof(one));
+        }
+    }
+    __atomic_fetch_sub(&bus->waiters, 1U, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+int16_t shmcanEnableEventFd(SHMCANInstance* ins)
+{
+    if (ins->bus == NULL) {
+        return -EINVAL;
+    }
+    if (ins->event_fd >= 0) {
+        return 0;
+    }
+    ins->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ins->event_fd < 0) {
+        return (int16_t)-errno;
+    }
+    ins->event_stop = 0;
+    const int err = pthread_create(&ins->event_thread, NULL, eventThreadMain, ins);
+    if (err != 0) {
+        (void)close(ins->event_fd);
+        ins->event_fd = -1;
+        return (int16_t)-err;
+    }
+    return 0;
+}
+
+int16_t shmcanClose(SHMCANInstance* ins)
+{
+    if (ins->bus == NULL) {
+        return -EINVAL;
+    }
+    if (ins->event_fd >= 0) {
+        // the other nodes take the extra wakeup as a spurious one
+        __atomic_store_n(&ins->event_stop, 1U, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&ins->bus->wake_count, 1U, __ATOMIC_SEQ_CST);
+        (void)syscall(SYS_futex, &ins->bus->wake_count, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+        (void)pthread_join(ins->event_thread, NULL);
+        (void)close(ins->event_fd);
+        ins->event_fd = -1;
+    }
+    const int ret = munmap(ins->bus, sizeof(SHMCANBus));
+    ins->bus = NULL;
+    return (int16_t)((ret == 0) ? 0 : -errno);
+}
+
+int16_t shmcanUnlink(const char* can_iface_name)
+{
+    char path[] = SHMCAN_NAME_BASE;
+    const int16_t res = parseBusName(can_iface_name, path);
+    if (res < 0) {
+        return res;
+    }
+    return (int16_t)((shm_unlink(path) == 0) ? 0 : -errno);
+}
+
+/*
+  the fields of a frame in the order CAN arbitration compares them: base
+  identifier, SRR/RTR, IDE, extended identifier. Lower wins
+ */
+static uint32_t arbitrationKey(uint32_t id)
+{
+    const uint32_t rtr = ((id & CANARD_CAN_FRAME_RTR) != 0U) ? 1U : 0U;
+    if ((id & CANARD_CAN_FRAME_EFF) != 0U) {
+        const uint32_t ext_id = id & CANARD_CAN_EXT_ID_MASK;
+        return ((ext_id >> 18U) << 21U) | (1U << 20U) | (1U << 19U) | ((ext_id & 0x3FFFFU) << 1U) | rtr;
+    }
+    return ((id & CANARD_CAN_STD_ID_MASK) << 21U) | (rtr << 20U);
+}
+
+int16_t shmcanTransmit(SHMCANInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec)
+{
+    return shmcanTransmitBatch(ins, frame, 1, timeout_msec);
+}
+
+int16_t shmcanTransmitBatch(SHMCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                            int32_t timeout_msec)
+{
+    (void)timeout_msec;
+    SHMCANBus* const bus = ins->bus;
+    if (bus == NULL) {
+        return -EINVAL;
+    }
+    if (num_frames > SHMCAN_MAX_BATCH) {
+        num_frames = SHMCAN_MAX_BATCH;
+    }
+    if (num_frames == 0U) {
+        return 0;
+    }
+
+    // arbitrate: stable insertion sort, frames of one transfer share the identifier and keep their order
+    const CanardCANFrame* order[SHMCAN_MAX_BATCH];
+    for (uint16_t i = 0; i < num_frames; i++) {
+        const CanardCANFrame* frame = &frames[i];
+        const uint32_t key = arbitrationKey(frame->id);
+        uint16_t j = i;
+        while (j > 0U && arbitrationKey(order[j-1U]->id) > key) {
+            order[j] = order[j-1U];
+            j--;
+        }
+        order[j] = frame;
+    }
+
+    // the frames take consecutive places on the bus, no other node gets in between
+    const uint64_t first = __atomic_fetch_add(&bus->head, num_frames, __ATOMIC_ACQ_REL);
+    for (uint16_t i = 0; i < num_frames; i++) {
+        const uint64_t sequence = first + i;
+        SHMCANSlot* slot = &bus->slots[sequence & (SHMCAN_RING_FRAMES - 1U)];
+        __atomic_store_n(&slot->sequence, SHMCAN_SLOT_BUSY, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        slot->node_tag = ins->node_tag;
+        slot->id = order[i]->id;
+        slot->canfd = 0;
+#if CANARD_ENABLE_CANFD
+        slot->canfd = order[i]->canfd ? 1U : 0U;
+#endif
+        slot->data_len = (order[i]->data_len > sizeof(order[i]->data)) ? (uint8_t)sizeof(order[i]->data) : order[i]->data_len;
+        memcpy(slot->data, order[i]->data, slot->data_len);
+        __atomic_store_n(&slot->sequence, sequence + 1U, __ATOMIC_RELEASE);
+    }
+
+    // pairs with the receiver registering as waiter before it looks at the ring a last time
+    __atomic_fetch_add(&bus->wake_count, 1U, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&bus->waiters, __ATOMIC_SEQ_CST) > 0U) {
+        (void)syscall(SYS_futex, &bus->wake_count, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+    return (int16_t)num_frames;
+}
+
+/*
+  reads the frames that are complete, skipping this node's own and those
+  it can't take. Returns the number of frames read
+ */
+static uint16_t readAvailable(SHMCANInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames)
+{
+    SHMCANBus* const bus = ins->bus;
+    uint16_t num = 0;
+    while (num < max_frames) {
+        const uint64_t sequence = ins->read_sequence;
+        const SHMCANSlot* slot = &bus->slots[sequence & (SHMCAN_RING_FRAMES - 1U)];
+        const uint64_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        bool overrun = false;
+        if (before == sequence + 1U) {
+            const uint32_t node_tag = slot->node_tag;
+            CanardCANFrame* frame = &out_frames[num];
+            memset(frame, 0, sizeof(*frame));
+            frame->id = slot->id;
+            frame->data_len = slot->data_len;
+            const bool canfd = slot->canfd != 0U;
+            memcpy(frame->data, slot->data,
+                   (frame->data_len > sizeof(frame->data)) ? sizeof(frame->data) : frame->data_len);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == before) {
+                ins->read_sequence++;
+#if CANARD_ENABLE_CANFD
+                frame->canfd = canfd;
+                const bool acceptable = ins->canfd || !canfd;
+#else
+                const bool acceptable = !canfd && frame->data_len <= CANARD_CAN_FRAME_MAX_DATA_LEN;
+#endif
+                if (node_tag != ins->node_tag && acceptable) {
+                    num++;
+                }
+                continue;
+            }
+            overrun = true;         // overwritten while it was copied
+        } else if (before != SHMCAN_SLOT_BUSY && before > sequence + 1U) {
+            overrun = true;
+        } else {
+            // not written yet, or being written; if that is a later frame this node fell behind
+            const uint64_t head = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE);
+            overrun = (head - sequence) > SHMCAN_RING_FRAMES;
+            if (!overrun && head > sequence) {
+                // claimed by a writer that hasn't finished it; one that died never will
+                const uint64_t now = monotonicMsec();
+                if (ins->stalled_sequence != sequence + 1U) {
+                    ins->stalled_sequence = sequence + 1U;
+                    ins->stalled_since_msec = now;
+                } else if (now - ins->stalled_since_msec >= SHMCAN_WRITER_TIMEOUT_MSEC) {
+                    ins->stalled_sequence = 0;
+                    ins->abandoned++;
+                    ins->read_sequence++;
+                    continue;
+                }
+            }
+        }
+        if (!overrun) {
+            break;
+        }
+        // continue half a ring behind the newest frame, well clear of the transmitters
+        const uint64_t resume = __atomic_load_n(&bus->head, __ATOMIC_ACQUIRE) - SHMCAN_RING_FRAMES / 2U;
+        if (resume > sequence) {
+            ins->overruns += (uint32_t)(resume - sequence);
+            ins->read_sequence = resume;
+        }
+    }
+    return num;
+}
+
+int16_t shmcanReceive(SHMCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec)
+{
+    return shmcanReceiveBatch(ins, out_frame, 1, timeout_msec);
+}
+
+int16_t shmcanReceiveBatch(SHMCANInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames,
+                           int32_t timeout_msec)
+{
+    SHMCANBus* const bus = ins->bus;
+    if (bus == NULL) {
+        return -EINVAL;
+    }
+    if (max_frames > INT16_MAX) {
+        max_frames = INT16_MAX;
+    }
+    const uint64_t deadline = monotonicMsec() + (uint64_t)((timeout_msec > 0) ? timeout_msec : 0);
+    if (ins->event_fd >= 0) {
+        // cleared before the ring is read, a transmission after that sets it again
+        uint64_t count;
+        (void)read(ins->event_fd, &count, sizeof(count));
+    }
+
+    for (;;) {
+        uint16_t num = readAvailable(ins, out_frames, max_frames);
+        if (num > 0U || timeout_msec == 0) {
+            if (num == max_frames && ins->event_fd >= 0) {
+                // there may be more, keep the eventfd readable
+                const uint64_t one = 1U;
+                (void)write(ins->event_fd, &one, sizeof(one));
+            }
+            return (int16_t)num;
+        }
+
+        __atomic_fetch_add(&bus->waiters, 1U, __ATOMIC_SEQ_CST);
+        const uint32_t wake_count = __atomic_load_n(&bus->wake_count, __ATOMIC_SEQ_CST);
+        num = readAvailable(ins, out_frames, max_frames);
+        bool waited_out = false;
+        if (num == 0U) {
+            struct timespec ts;
+            struct timespec* timeout = NULL;
+            const bool stalled = ins->stalled_sequence == ins->read_sequence + 1U;
+            if (timeout_msec > 0 || stalled) {
+                const uint64_t now = monotonicMsec();
+                uint64_t remaining = (deadline > now) ? deadline - now : 0U;
+                if (stalled) {
+                    // come back to skip the half written frame, nobody wakes us for that
+                    const uint64_t skip_at = ins->stalled_since_msec + SHMCAN_WRITER_TIMEOUT_MSEC;
+                    const uint64_t until_skip = (skip_at > now) ? skip_at - now : 0U;
+                    if (timeout_msec < 0 || until_skip < remaining) {
+                        remaining = until_skip;
+                    }
+                }
+                ts.tv_sec = (time_t)(remaining / 1000U);
+                ts.tv_nsec = (long)(remaining % 1000U) * 1000000L;
+                timeout = &ts;
+                waited_out = remaining == 0U;
+            }
+            if (!waited_out &&
+                syscall(SYS_futex, &bus->wake_count, FUTEX_WAIT, wake_count, timeout, NULL, 0) < 0 &&
+                errno == ETIMEDOUT) {
+                waited_out = true;
+            }
+        }
+        __atomic_fetch_sub(&bus->waiters, 1U, __ATOMIC_SEQ_CST);
+        if (num > 0U) {
+            return (int16_t)num;
+        }
+        if (waited_out && timeout_msec > 0 && monotonicMsec() >= deadline) {
+            return (int16_t)readAvailable(ins, out_frames, max_frames);
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+#pragma once
+
+#include <canard.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ Number of frames the shared ring of a bus holds, a power of two. A
+ node that falls further behind than this loses the oldest frames, like
+ a CAN controller whose receive FIFO overflows. It has to be the same
+ for all nodes of a bus.
+ */
+#ifndef SHMCAN_RING_FRAMES
+#define SHMCAN_RING_FRAMES 4096U
+#endif
+
+/*
+ Maximum number of frames shmcanTransmitBatch() arbitrates and puts on
+ the bus at once.
+ */
+#ifndef SHMCAN_MAX_BATCH
+#define SHMCAN_MAX_BATCH 32U
+#endif
+
+/*
+ Permissions of the shared memory segment, given to the first node that
+ creates it. Nodes of other users can only join if they allow it.
+ */
+#ifndef SHMCAN_MODE
+#define SHMCAN_MODE 0600
+#endif
+
+/*
+ Time a frame may stay half written before receivers skip it. A node
+ that dies while it writes a frame would otherwise hold up all
+ receivers until the ring wraps around; a node that is merely stopped
+ for longer than this loses the frame.
+ */
+#ifndef SHMCAN_WRITER_TIMEOUT_MSEC
+#define SHMCAN_WRITER_TIMEOUT_MSEC 100U
+#endif
+
+typedef struct SHMCANBus SHMCANBus;
+
+typedef struct
+{
+    SHMCANBus *bus;
+    uint64_t read_sequence;     // next frame on the bus this node reads
+    uint32_t node_tag;          // tells this node's own frames apart
+    uint32_t overruns;          // frames lost because this node fell behind
+    uint32_t abandoned;         // frames skipped because their writer didn't finish them
+    uint64_t stalled_sequence;  // read_sequence + 1 while waiting for a half written frame, else 0
+    uint64_t stalled_since_msec;
+    int event_fd;               // see shmcanEnableEventFd(), -1 until then
+    uint32_t event_stop;
+    pthread_t event_thread;
+#ifdef CANARD_ENABLE_CANFD
+    bool canfd;
+#endif
+} SHMCANInstance;
+
+/*
+ Initializes the instance on the bus "shm:N", N from 0 to 9. The first
+ node creates the shared memory segment, later ones attach to it.
+ Returns 0 on success, negative on error.
+*/
+#if CANARD_ENABLE_CANFD
+int16_t shmcanInit(SHMCANInstance* out_ins, const char* can_iface_name, bool canfd);
+#else
+int16_t shmcanInit(SHMCANInstance* out_ins, const char* can_iface_name);
+#endif
+
+/*
+ Gives the instance an eventfd, event_fd, for epoll and the like. It
+ becomes readable when another node transmits, and stays readable while
+ shmcanReceiveBatch() leaves frames behind. A thread of the instance
+ waits on the bus for it, so the instance must not be moved any more.
+ A half written frame of a node that died is only skipped once another
+ frame is transmitted.
+ Returns 0 on success, negative on error.
+ */
+int16_t shmcanEnableEventFd(SHMCANInstance* ins);
+
+/*
+ Deinitializes the instance. The segment stays until it is removed
+ with shmcanUnlink(), so that nodes can come and go.
+ Returns 0 on success, negative on error.
+ */
+int16_t shmcanClose(SHMCANInstance* ins);
+
+/*
+ Removes the shared memory segment of the bus "shm:N", nodes that are
+ attached keep using it.
+ Returns 0 on success, negative on error.
+ */
+int16_t shmcanUnlink(const char* can_iface_name);
+
+/*
+ Transmits a CanardCANFrame to the bus. The bus never pushes back, so
+ this doesn't wait; the timeout is there for the shape of the other drivers.
+ Returns 1 on successful transmission, negative on error.
+ */
+int16_t shmcanTransmit(SHMCANInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec);
+
+/*
+ Receives a CanardCANFrame sent by another node of the bus.
+ Use negative timeout to block infinitely.
+ Returns 1 on successful reception, 0 on timeout, negative on error.
+ */
+int16_t shmcanReceive(SHMCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec);
+
+/*
+ Transmits up to SHMCAN_MAX_BATCH frames. They go on the bus back to back,
+ in the order CAN arbitration would send them: lowest identifier first,
+ frames with the same identifier in the order given.
+ Returns the number of frames transmitted, negative on error.
+ */
+int16_t shmcanTransmitBatch(SHMCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                            int32_t timeout_msec);
+
+/*
+ Receives up to max_frames frames sent by other nodes of the bus.
+ The timeout applies only if no frame is available; use negative timeout to block infinitely.
+ Returns the number of frames received, 0 on timeout, negative on error.
+ */
+int16_t shmcanReceiveBatch(SHMCANInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames,
+                           int32_t timeout_msec);
+
+#ifdef __cplusplus
+}
+#endif
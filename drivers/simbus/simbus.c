@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+#include "simbus.h"
+#include <errno.h>
+#include <string.h>
+
+// bits after the CRC: CRC delimiter, ACK slot, ACK delimiter, end of frame and interframe space
+#define SIMBUS_TRAILER_BITS (1U + 1U + 1U + 7U + 3U)
+
+static const uint8_t simbus_fd_lengths[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+/*
+  counts the bits of a frame as they go on the wire, with a stuff bit
+  after five equal bits, and computes the CRC-15 of classic frames
+ */
+typedef struct
+{
+    uint32_t bits;
+    uint8_t last;
+    uint8_t run;
+    uint16_t crc;
+} BitCounter;
+
+static void putBit(BitCounter* counter, uint8_t bit, bool update_crc)
+{
+    if (update_crc) {
+        const uint16_t crc_next = (uint16_t)(bit ^ ((counter->crc >> 14U) & 1U));
+        counter->crc = (uint16_t)((counter->crc << 1U) & 0x7FFFU);
+        if (crc_next != 0U) {
+            counter->crc ^= 0x4599U;
+        }
+    }
+    counter->bits++;
+    if (bit == counter->last) {
+        counter->run++;
+    } else {
+        counter->last = bit;
+        counter->run = 1;
+    }
+    if (counter->run == 5U) {
+        counter->bits++;
+        counter->last = (uint8_t)(bit ^ 1U);
+        counter->run = 1;
+    }
+}
+
+static void putBits(BitCounter* counter, uint32_t value, uint8_t num_bits, bool update_crc)
+{
+    while (num_bits > 0U) {
+        num_bits--;
+        putBit(counter, (uint8_t)((value >> num_bits) & 1U), update_crc);
+    }
+}
+
+uint32_t simbusFrameBits(const CanardCANFrame* frame, bool bit_rate_switch, uint32_t* out_data_phase_bits)
+{
+    BitCounter counter;
+    memset(&counter, 0, sizeof(counter));
+    counter.last = 2U;          // no bit before SOF
+
+    bool canfd = false;
+#if CANARD_ENABLE_CANFD
+    canfd = frame->canfd;
+#endif
+    uint8_t dlc = 0;
+    uint8_t data_len = 0;
+    if (canfd) {
+        while (dlc < 15U && simbus_fd_lengths[dlc] < frame->data_len) {
+            dlc++;
+        }
+        data_len = simbus_fd_lengths[dlc];
+    } else {
+        data_len = (frame->data_len > CANARD_CAN_FRAME_MAX_DATA_LEN) ? CANARD_CAN_FRAME_MAX_DATA_LEN : frame->data_len;
+        dlc = data_len;
+    }
+    const uint8_t rtr = ((frame->id & CANARD_CAN_FRAME_RTR) != 0U && !canfd) ? 1U : 0U;
+
+    putBit(&counter, 0U, true);                                             // SOF
+    if ((frame->id & CANARD_CAN_FRAME_EFF) != 0U) {
+        const uint32_t id = frame->id & CANARD_CAN_EXT_ID_MASK;
+        putBits(&counter, id >> 18U, 11U, true);
+        putBits(&counter, 3U, 2U, true);                                    // SRR, IDE
+        putBits(&counter, id & 0x3FFFFU, 18U, true);
+        putBit(&counter, rtr, true);                                        // RTR or RRS
+        if (!canfd) {
+            putBit(&counter, 0U, true);                                     // r1
+        }
+    } else {
+        putBits(&counter, frame->id & CANARD_CAN_STD_ID_MASK, 11U, true);
+        putBit(&counter, rtr, true);                                        // RTR or RRS
+        putBit(&counter, 0U, true);                                         // IDE
+    }
+
+    uint32_t data_phase_start = 0;
+    if (canfd) {
+        putBit(&counter, 1U, true);                                         // FDF
+        putBit(&counter, 0U, true);                                         // res
+        putBit(&counter, bit_rate_switch ? 1U : 0U, true);                  // BRS
+        data_phase_start = counter.bits;
+        putBit(&counter, 0U, true);                                         // ESI
+    } else {
+        putBit(&counter, 0U, true);                                         // r0
+    }
+    putBits(&counter, dlc, 4U, true);
+    for (uint8_t i = 0; i < data_len; i++) {
+        putBits(&counter, (i < frame->data_len) ? frame->data[i] : 0U, 8U, true);
+    }
+
+    uint32_t data_phase_bits = 0;
+    if (canfd) {
+        // stuff count and CRC have a fixed stuff bit before them and after every fourth bit
+        const uint32_t crc_field_bits = 4U + ((data_len > 16U) ? 21U : 17U);
+        const uint32_t crc_field = crc_field_bits + crc_field_bits / 4U + 1U;
+        counter.bits += crc_field;
+        data_phase_bits = counter.bits - data_phase_start;
+    } else {
+        putBits(&counter, counter.crc, 15U, false);
+    }
+
+    if (out_data_phase_bits != NULL) {
+        *out_data_phase_bits = bit_rate_switch ? data_phase_bits : 0U;
+    }
+    return counter.bits + SIMBUS_TRAILER_BITS;
+}
+
+void simbusInit(SimBusInstance* bus, uint32_t bitrate, uint32_t data_bitrate)
+{
+    memset(bus, 0, sizeof(*bus));
+    bus->bitrate = bitrate;
+    bus->data_bitrate = (data_bitrate != 0U) ? data_bitrate : bitrate;
+}
+
+int16_t simbusAddNode(SimBusInstance* bus, CanardInstance* canard, uint8_t iface_id)
+{
+    if (canard == NULL) {
+        return -EINVAL;
+    }
+    if (bus->num_nodes >= SIMBUS_MAX_NODES) {
+        return -ENOSPC;
+    }
+    SimBusNode* node = &bus->nodes[bus->num_nodes];
+    memset(node, 0, sizeof(*node));
+    node->canard = canard;
+    node->iface_id = iface_id;
+    return bus->num_nodes++;
+}
+
+void simbusSetTrace(SimBusInstance* bus, SimBusTraceCallback trace, void* arg)
+{
+    bus->trace = trace;
+    bus->trace_arg = arg;
+}
+
+static uint64_t bitsToNsec(uint64_t bits, uint32_t bitrate)
+{
+    return (bits * 1000000000ULL + bitrate / 2U) / bitrate;
+}
+
+uint64_t simbusFrameDurationNsec(const SimBusInstance* bus, const CanardCANFrame* frame)
+{
+    uint32_t data_phase_bits = 0;
+    const uint32_t bits = simbusFrameBits(frame, bus->data_bitrate != bus->bitrate, &data_phase_bits);
+    return bitsToNsec(bits - data_phase_bits, bus->bitrate) + bitsToNsec(data_phase_bits, bus->data_bitrate);
+}
+
+/*
+  the fields of a frame in the order arbitration compares them: base
+  identifier, SRR/RTR, IDE, extended identifier, RTR. Lower wins
+ */
+static uint32_t arbitrationKey(uint32_t id)
+{
+    const uint32_t rtr = ((id & CANARD_CAN_FRAME_RTR) != 0U) ? 1U : 0U;
+    if ((id & CANARD_CAN_FRAME_EFF) != 0U) {
+        const uint32_t ext_id = id & CANARD_CAN_EXT_ID_MASK;
+        return ((ext_id >> 18U) << 21U) | (1U << 20U) | (1U << 19U) | ((ext_id & 0x3FFFFU) << 1U) | rtr;
+    }
+    return ((id & CANARD_CAN_STD_ID_MASK) << 21U) | (rtr << 20U);
+}
+
+/*
+  lets the nodes with a pending frame compete for the idle bus and puts
+  the winner's frame on it. Returns false if no node has a frame
+ */
+static bool arbitrate(SimBusInstance* bus)
+{
+    const uint64_t now_usec = bus->now_nsec / 1000U;
+    int16_t winner = -1;
+    uint32_t winner_key = 0;
+    for (uint8_t i = 0; i < bus->num_nodes; i++) {
+        SimBusNode* node = &bus->nodes[i];
+        const CanardCANFrame* frame = canardPeekTxQueue(node->canard);
+#if CANARD_ENABLE_DEADLINE
+        while (frame != NULL && frame->deadline_usec < now_usec) {
+            canardPopTxQueue(node->canard);
+            node->stats.expired++;
+            frame = canardPeekTxQueue(node->canard);
+        }
+#else
+        (void)now_usec;
+#endif
+        if (frame == NULL) {
+            continue;
+        }
+        const uint32_t key = arbitrationKey(frame->id);
+        if (winner < 0 || key < winner_key) {
+            winner = (int16_t)i;
+            winner_key = key;
+        }
+    }
+    if (winner < 0) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < bus->num_nodes; i++) {
+        if (i != (uint8_t)winner && canardPeekTxQueue(bus->nodes[i].canard) != NULL) {
+            bus->nodes[i].stats.arbitration_losses++;
+        }
+    }
+
+    // the frame moves into the controller, so the node can queue more while it is sent
+    SimBusNode* sender = &bus->nodes[winner];
+    bus->frame = *canardPeekTxQueue(sender->canard);
+    canardPopTxQueue(sender->canard);
+    bus->sender = (uint8_t)winner;
+    bus->in_flight = true;
+
+    const uint64_t duration_nsec = simbusFrameDurationNsec(bus, &bus->frame);
+    bus->frame_end_nsec = bus->now_nsec + duration_nsec;
+    bus->busy_nsec += duration_nsec;
+    sender->stats.frames++;
+    sender->stats.bits += simbusFrameBits(&bus->frame, bus->data_bitrate != bus->bitrate, NULL);
+    if (bus->trace != NULL) {
+        bus->trace(bus->trace_arg, bus->sender, &bus->frame, bus->now_nsec, bus->frame_end_nsec);
+    }
+    return true;
+}
+
+uint32_t simbusRunUntil(SimBusInstance* bus, uint64_t until_usec)
+{
+    const uint64_t until_nsec = until_usec * 1000U;
+    uint32_t num_delivered = 0;
+    for (;;) {
+        if (bus->in_flight) {
+            if (bus->frame_end_nsec > until_nsec) {
+                break;
+            }
+            bus->now_nsec = bus->frame_end_nsec;
+            bus->in_flight = false;
+            const uint64_t now_usec = bus->now_nsec / 1000U;
+            for (uint8_t i = 0; i < bus->num_nodes; i++) {
+                if (i == bus->sender) {
+                    continue;
+                }
+                CanardCANFrame frame = bus->frame;
+                frame.iface_id = bus->nodes[i].iface_id;
+                // frames for other nodes or types are turned down, which is fine
+                (void)canardHandleRxFrame(bus->nodes[i].canard, &frame, now_usec);
+            }
+            num_delivered++;
+            continue;
+        }
+        if (!arbitrate(bus)) {
+            break;
+        }
+    }
+    if (bus->now_nsec < until_nsec) {
+        bus->now_nsec = until_nsec;
+    }
+    return num_delivered;
+}
+
+uint64_t simbusGetTimeUsec(const SimBusInstance* bus)
+{
+    return bus->now_nsec / 1000U;
+}
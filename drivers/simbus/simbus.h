@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+/*
+  simulated CAN bus for nodes in one process: frames take the time they
+  would take on the wire at the configured bitrate, pending frames of all
+  nodes are arbitrated by identifier, and time only advances when
+  simbusRunUntil() is called, so results don't depend on the host
+ */
+
+#pragma once
+
+#include <canard.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ maximum number of nodes on one bus
+ */
+#ifndef SIMBUS_MAX_NODES
+#define SIMBUS_MAX_NODES 16U
+#endif
+
+typedef struct
+{
+    uint64_t frames;                // frames sent
+    uint64_t bits;                  // bits sent, including stuff bits and interframe space
+    uint64_t arbitration_losses;    // times a pending frame lost arbitration to another node
+    uint64_t expired;               // frames dropped because their deadline passed before they got the bus
+} SimBusNodeStatistics;
+
+typedef struct
+{
+    CanardInstance* canard;
+    uint8_t iface_id;               // set in the frames this node receives
+    SimBusNodeStatistics stats;
+} SimBusNode;
+
+/*
+ called for every frame when it starts on the bus
+ */
+typedef void (*SimBusTraceCallback)(void* arg, uint8_t node_index, const CanardCANFrame* frame,
+                                    uint64_t start_nsec, uint64_t end_nsec);
+
+typedef struct
+{
+    uint32_t bitrate;               // nominal bitrate, used for arbitration and classic frames
+    uint32_t data_bitrate;          // CAN FD data phase bitrate
+    uint64_t now_nsec;              // virtual time
+    uint64_t busy_nsec;             // time the bus carried frames
+
+    // the frame on the bus, taken from the sender's queue when it won arbitration
+    bool in_flight;
+    uint8_t sender;
+    CanardCANFrame frame;
+    uint64_t frame_end_nsec;
+
+    SimBusNode nodes[SIMBUS_MAX_NODES];
+    uint8_t num_nodes;
+
+    SimBusTraceCallback trace;
+    void* trace_arg;
+} SimBusInstance;
+
+/*
+ Initializes the bus at virtual time 0. data_bitrate is the bitrate of
+ the data phase of CAN FD frames with bit rate switching, 0 to use the
+ nominal bitrate for the whole frame.
+ */
+void simbusInit(SimBusInstance* bus, uint32_t bitrate, uint32_t data_bitrate);
+
+/*
+ Attaches a node. Its TX queue is served by the bus and the frames of
+ the other nodes are given to its canardHandleRxFrame() with iface_id set.
+ Returns the index of the node, negative on error.
+ */
+int16_t simbusAddNode(SimBusInstance* bus, CanardInstance* canard, uint8_t iface_id);
+
+/*
+ Sets a callback that is called for every frame sent, NULL to remove it.
+ */
+void simbusSetTrace(SimBusInstance* bus, SimBusTraceCallback trace, void* arg);
+
+/*
+ Returns the length of a frame on the wire in bits, including stuff bits,
+ which are counted exactly, and the interframe space. With bit_rate_switch
+ the bits of the data phase of a CAN FD frame are returned in
+ out_data_phase_bits too, which may be NULL.
+ */
+uint32_t simbusFrameBits(const CanardCANFrame* frame, bool bit_rate_switch, uint32_t* out_data_phase_bits);
+
+/*
+ Returns the time a frame occupies the bus.
+ */
+uint64_t simbusFrameDurationNsec(const SimBusInstance* bus, const CanardCANFrame* frame);
+
+/*
+ Advances virtual time to until_usec, sending the frames the nodes have
+ queued and those they queue in response. A frame that doesn't end by
+ then stays on the bus until the next call.
+ Returns the number of frames delivered.
+ */
+uint32_t simbusRunUntil(SimBusInstance* bus, uint64_t until_usec);
+
+/*
+ Returns the virtual time, to be used as the timestamp of everything
+ done with the nodes of the bus.
+ */
+uint64_t simbusGetTimeUsec(const SimBusInstance* bus);
+
+#ifdef __cplusplus
+}
+#endif
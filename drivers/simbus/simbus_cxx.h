@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 DroneCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+#pragma once
+
+#include "simbus.h"
+
+namespace Canard {
+
+/// @brief simulated CAN bus with virtual time, see simbus.h
+class SimBus {
+public:
+    /// @param bitrate nominal bitrate
+    /// @param data_bitrate CAN FD data phase bitrate, 0 to use the nominal bitrate
+    SimBus(uint32_t bitrate, uint32_t data_bitrate = 0) {
+        simbusInit(&bus, bitrate, data_bitrate);
+    }
+
+    // delete copy constructor and assignment operator
+    SimBus(const SimBus&) = delete;
+    SimBus& operator=(const SimBus&) = delete;
+
+    /// @brief attach a node, its TX queue is served by the bus
+    /// @param canard instance of the node
+    /// @param iface_id set in the frames the node receives
+    /// @return index of the node, negative if the bus is full
+    int16_t add_node(CanardInstance &canard, uint8_t iface_id = 0) {
+        return simbusAddNode(&bus, &canard, iface_id);
+    }
+
+    /// @brief advance virtual time, sending the queued frames
+    /// @param usec virtual time to run to
+    /// @return number of frames delivered
+    uint32_t run_until(uint64_t usec) {
+        return simbusRunUntil(&bus, usec);
+    }
+
+    /// @brief advance virtual time by a duration
+    /// @param usec duration
+    /// @return number of frames delivered
+    uint32_t run_for(uint64_t usec) {
+        return simbusRunUntil(&bus, simbusGetTimeUsec(&bus) + usec);
+    }
+
+    /// @brief call a function for every frame when it starts on the bus
+    void set_trace(SimBusTraceCallback trace, void* arg) {
+        simbusSetTrace(&bus, trace, arg);
+    }
+
+    /// @brief virtual time, to use as the timestamp of everything done with the nodes
+    uint64_t get_time_usec() const {
+        return simbusGetTimeUsec(&bus);
+    }
+
+    /// @brief fraction of the time so far the bus carried frames
+    float get_load() const {
+        return (bus.now_nsec == 0) ? 0.0F : (float)bus.busy_nsec / (float)bus.now_nsec;
+    }
+
+    /// @brief time a frame occupies the bus
+    uint64_t get_frame_duration_nsec(const CanardCANFrame &frame) const {
+        return simbusFrameDurationNsec(&bus, &frame);
+    }
+
+    /// @brief statistics of a node
+    /// @param index index returned by add_node()
+    const SimBusNodeStatistics& get_node_statistics(uint8_t index) const {
+        return bus.nodes[index].stats;
+    }
+
+private:
+    SimBusInstance bus;
+};
+
+} // namespace Canard
@@ -12,20 +12,32 @@
 
 #include <net/if.h>
 #include "socketcan.h"
+#include "socketcan_internal.h"
 #include <poll.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
 #ifdef __NuttX__
 #include <nuttx/can.h>
 #include <netpacket/can.h>
 #else
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include <linux/ethtool.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
 #endif
 #include <errno.h>
 #include <stdlib.h>
 
+/// The batch calls copy CAN IDs as they are, which needs the flags of both sides in the same bits
+#if CANARD_CAN_FRAME_EFF != CAN_EFF_FLAG || CANARD_CAN_FRAME_RTR != CAN_RTR_FLAG || CANARD_CAN_FRAME_ERR != CAN_ERR_FLAG
+# error "CANARD_CAN_FRAME_EFF/RTR/ERR differ from CAN_EFF_FLAG/CAN_RTR_FLAG/CAN_ERR_FLAG"
+#endif
+
 /// Returns the current errno as negated int16_t
 static int16_t getErrorCode()
 {
@@ -100,6 +112,7 @@ int16_t socketcanInit(SocketCANInstance* out_ins, const char* can_iface_name)
     }
 
     out_ins->fd = fd;
+    out_ins->timestamping = SOCKETCAN_TIMESTAMP_NONE;
     return 0;
 
 fail1:
@@ -115,12 +128,13 @@ int16_t socketcanClose(SocketCANInstance* ins)
     return (int16_t)((close_result == 0) ? 0 : getErrorCode());
 }
 
-int16_t socketcanTransmit(SocketCANInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec)
+/// Waits for the requested event; returns 1 when it's there, 0 on timeout, negative on error
+static int16_t waitForEvent(const SocketCANInstance* ins, short event, int32_t timeout_msec)
 {
     struct pollfd fds;
     memset(&fds, 0, sizeof(fds));
     fds.fd = ins->fd;
-    fds.events |= POLLOUT;
+    fds.events = event;
 
     const int poll_result = poll(&fds, 1, timeout_msec);
     if (poll_result < 0)
@@ -131,10 +145,20 @@ int16_t socketcanTransmit(SocketCANInstance* ins, const CanardCANFrame* frame, i
     {
         return 0;
     }
-    if (((uint32_t)fds.revents & (uint32_t)POLLOUT) == 0)
+    if (((uint32_t)fds.revents & (uint32_t)event) == 0)
     {
         return -EIO;
     }
+    return 1;
+}
+
+int16_t socketcanTransmit(SocketCANInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec)
+{
+    const int16_t wait_result = waitForEvent(ins, POLLOUT, timeout_msec);
+    if (wait_result <= 0)
+    {
+        return wait_result;
+    }
 
 #if CANARD_ENABLE_CANFD
     if(frame->canfd)
@@ -180,23 +204,10 @@ int16_t socketcanTransmit(SocketCANInstance* ins, const CanardCANFrame* frame, i
 
 int16_t socketcanReceive(SocketCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec)
 {
-    struct pollfd fds;
-    memset(&fds, 0, sizeof(fds));
-    fds.fd = ins->fd;
-    fds.events |= POLLIN;
-
-    const int poll_result = poll(&fds, 1, timeout_msec);
-    if (poll_result < 0)
-    {
-        return getErrorCode();
-    }
-    if (poll_result == 0)
-    {
-        return 0;
-    }
-    if (((uint32_t)fds.revents & (uint32_t)POLLIN) == 0)
+    const int16_t wait_result = waitForEvent(ins, POLLIN, timeout_msec);
+    if (wait_result <= 0)
     {
-        return -EIO;
+        return wait_result;
     }
 
 #if CANARD_ENABLE_CANFD
@@ -252,6 +263,385 @@ int16_t socketcanReceive(SocketCANInstance* ins, CanardCANFrame* out_frame, int3
     return 1;
 }
 
+int16_t socketcanSetFilters(SocketCANInstance* ins, const CanardAcceptanceFilter* filters, uint16_t num_filters)
+{
+    if (num_filters > SOCKETCAN_MAX_FILTERS)
+    {
+        return -EINVAL;
+    }
+    // The flags of CanardAcceptanceFilter have the same values as CAN_EFF_FLAG, CAN_RTR_FLAG and CAN_ERR_FLAG
+    struct can_filter can_filters[SOCKETCAN_MAX_FILTERS];
+    for (uint16_t i = 0; i < num_filters; i++)
+    {
+        can_filters[i].can_id = filters[i].id;
+        can_filters[i].can_mask = filters[i].mask;
+    }
+    if (setsockopt(ins->fd, SOL_CAN_RAW, CAN_RAW_FILTER, (num_filters > 0) ? can_filters : NULL,
+                   (socklen_t)(sizeof(can_filters[0]) * num_filters)) < 0)
+    {
+        return getErrorCode();
+    }
+    return 0;
+}
+
+/// Control message space for the receive timestamps, fits both SO_TIMESTAMPNS and SO_TIMESTAMPING
+#define TIMESTAMP_CONTROL_SIZE CMSG_SPACE(3U * sizeof(struct timespec))
+
+static uint64_t timespecToUsec(const struct timespec* ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000ULL + (uint64_t)ts->tv_nsec / 1000ULL;
+}
+
+/// Returns CLOCK_MONOTONIC minus CLOCK_REALTIME, the kernel timestamps frames with the latter
+static int64_t getRealtimeToMonotonicUsec(void)
+{
+    struct timespec mono;
+    struct timespec real;
+    (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+    (void)clock_gettime(CLOCK_REALTIME, &real);
+    return (int64_t)timespecToUsec(&mono) - (int64_t)timespecToUsec(&real);
+}
+
+/// Returns the timestamp of a received message, or the current time if it has none. With hardware timestamping
+/// a frame the controller didn't stamp gets 0, a software timestamp would be on another timescale
+static uint64_t getReceiveTimestamp(const SocketCANInstance* ins, struct msghdr* msg, int64_t realtime_to_monotonic)
+{
+    const struct timespec* software = NULL;
+    const struct timespec* hardware = NULL;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+        {
+            continue;
+        }
+#ifdef SO_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            software = (const struct timespec*)CMSG_DATA(cmsg);
+        }
+#endif
+#ifdef SO_TIMESTAMPING
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING)
+        {
+            // Software, deprecated and raw hardware timestamps, unused ones are zero
+            const struct timespec* ts = (const struct timespec*)CMSG_DATA(cmsg);
+            if (ts[0].tv_sec != 0 || ts[0].tv_nsec != 0)
+            {
+                software = &ts[0];
+            }
+            if (ts[2].tv_sec != 0 || ts[2].tv_nsec != 0)
+            {
+                hardware = &ts[2];
+            }
+        }
+#endif
+    }
+    if (ins->timestamping == SOCKETCAN_TIMESTAMP_HARDWARE)
+    {
+        return (hardware != NULL) ? timespecToUsec(hardware) : 0U;
+    }
+    if (software != NULL)
+    {
+        return (uint64_t)((int64_t)timespecToUsec(software) + realtime_to_monotonic);
+    }
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespecToUsec(&now);
+}
+
+/*
+ * Both frame formats are received into struct canfd_frame, whose header has the same layout as struct can_frame.
+ * The length of the message tells classic (CAN_MTU) and FD (CANFD_MTU) frames apart.
+ * Returns false if the frame is malformed.
+ */
+bool socketcanConvertReceivedFrame(const SocketCANInstance* ins, const struct canfd_frame* receive_frame,
+                                   size_t length, CanardCANFrame* out_frame)
+{
+    if (length == CAN_MTU && receive_frame->len <= CAN_MAX_DLEN)
+    {
+#if CANARD_ENABLE_CANFD
+        out_frame->canfd = false;
+#endif
+    }
+#if CANARD_ENABLE_CANFD
+    else if (ins->canfd && length == CANFD_MTU && receive_frame->len <= CANFD_MAX_DLEN)
+    {
+        out_frame->canfd = true;
+    }
+#endif
+    else
+    {
+        (void)ins;
+        return false;
+    }
+    out_frame->id = receive_frame->can_id;                  // EFF/RTR/ERR are the same bits, see above
+    out_frame->data_len = receive_frame->len;
+    memcpy(out_frame->data, receive_frame->data, receive_frame->len);
+    // assume a single interface
+    out_frame->iface_id = 0;
+    return true;
+}
+
+#if defined(SO_TIMESTAMPING) && defined(SIOCETHTOOL) && defined(SIOCGHWTSTAMP)
+/// Returns true if the interface the socket is bound to stamps received frames in hardware and has it turned on;
+/// the socket option alone is accepted by any interface, which then delivers no hardware timestamps at all
+static bool hardwareTimestampsAvailable(const SocketCANInstance* ins)
+{
+    struct sockaddr_can addr;
+    socklen_t addr_len = sizeof(addr);
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    if (getsockname(ins->fd, (struct sockaddr*)&addr, &addr_len) < 0 ||
+        if_indextoname((unsigned)addr.can_ifindex, ifr.ifr_name) == NULL)
+    {
+        return false;
+    }
+
+    struct ethtool_ts_info info;
+    memset(&info, 0, sizeof(info));
+    info.cmd = ETHTOOL_GET_TS_INFO;
+    ifr.ifr_data = (char*)&info;
+    if (ioctl(ins->fd, SIOCETHTOOL, &ifr) < 0 || (info.so_timestamping & SOF_TIMESTAMPING_RX_HARDWARE) == 0U)
+    {
+        return false;
+    }
+
+    struct hwtstamp_config config;
+    memset(&config, 0, sizeof(config));
+    ifr.ifr_data = (char*)&config;
+    return ioctl(ins->fd, SIOCGHWTSTAMP, &ifr) == 0 && config.rx_filter != HWTSTAMP_FILTER_NONE;
+}
+#endif
+
+int16_t socketcanEnableTimestamps(SocketCANInstance* ins, bool hardware)
+{
+#if defined(SO_TIMESTAMPING) && defined(SIOCETHTOOL) && defined(SIOCGHWTSTAMP)
+    if (hardware && hardwareTimestampsAvailable(ins))
+    {
+        const int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        if (setsockopt(ins->fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+        {
+            ins->timestamping = SOCKETCAN_TIMESTAMP_HARDWARE;
+            return SOCKETCAN_TIMESTAMP_HARDWARE;
+        }
+    }
+#else
+    (void)hardware;
+#endif
+#ifdef SO_TIMESTAMPNS
+    const int on = 1;
+    if (setsockopt(ins->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0)
+    {
+        return getErrorCode();
+    }
+    ins->timestamping = SOCKETCAN_TIMESTAMP_SOFTWARE;
+    return SOCKETCAN_TIMESTAMP_SOFTWARE;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+int16_t socketcanReceiveTimestamped(SocketCANInstance* ins, CanardCANFrame* out_frame, uint64_t* out_timestamp_usec,
+                                    int32_t timeout_msec)
+{
+    const int16_t wait_result = waitForEvent(ins, POLLIN, timeout_msec);
+    if (wait_result <= 0)
+    {
+        return wait_result;
+    }
+
+    struct canfd_frame receive_frame;
+    struct iovec iov;
+    iov.iov_base = &receive_frame;
+    iov.iov_len = sizeof(receive_frame);
+    union
+    {
+        size_t align;                                       // struct cmsghdr alignment
+        uint8_t buf[TIMESTAMP_CONTROL_SIZE];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    const ssize_t nbytes = recvmsg(ins->fd, &msg, 0);
+    if (nbytes < 0)
+    {
+        return getErrorCode();
+    }
+    if (!socketcanConvertReceivedFrame(ins, &receive_frame, (size_t)nbytes, out_frame))
+    {
+        return -EIO;
+    }
+    if (out_timestamp_usec != NULL)
+    {
+        *out_timestamp_usec = getReceiveTimestamp(ins, &msg, getRealtimeToMonotonicUsec());
+    }
+    return 1;
+}
+
+#ifdef __NuttX__
+
+/*
+ * recvmmsg() and sendmmsg() are Linux specific, so on NuttX the batch calls are loops over the single frame calls
+ */
+
+int16_t socketcanTransmitBatch(SocketCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                               int32_t timeout_msec)
+{
+    int16_t num_sent = 0;
+    while (num_sent < (int16_t)num_frames && num_sent < (int16_t)SOCKETCAN_MAX_BATCH)
+    {
+        const int16_t res = socketcanTransmit(ins, &frames[num_sent], (num_sent == 0) ? timeout_msec : 0);
+        if (res <= 0)
+        {
+            return (num_sent > 0) ? num_sent : res;
+        }
+        num_sent++;
+    }
+    return num_sent;
+}
+
+int16_t socketcanReceiveBatch(SocketCANInstance* ins, CanardCANFrame* out_frames, uint64_t* out_timestamps_usec,
+                              uint16_t max_frames, int32_t timeout_msec)
+{
+    int16_t num_received = 0;
+    while (num_received < (int16_t)max_frames && num_received < (int16_t)SOCKETCAN_MAX_BATCH)
+    {
+        const int16_t res = socketcanReceiveTimestamped(ins, &out_frames[num_received],
+                                                        (out_timestamps_usec != NULL) ?
+                                                        &out_timestamps_usec[num_received] : NULL,
+                                                        (num_received == 0) ? timeout_msec : 0);
+        if (res <= 0)
+        {
+            return (num_received > 0) ? num_received : res;
+        }
+        num_received++;
+    }
+    return num_received;
+}
+
+#else
+
+int16_t socketcanTransmitBatch(SocketCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                               int32_t timeout_msec)
+{
+    struct canfd_frame transmit_frames[SOCKETCAN_MAX_BATCH];
+    struct iovec iovs[SOCKETCAN_MAX_BATCH];
+    struct mmsghdr msgs[SOCKETCAN_MAX_BATCH];
+
+    const unsigned num = (num_frames < SOCKETCAN_MAX_BATCH) ? num_frames : SOCKETCAN_MAX_BATCH;
+    if (num == 0)
+    {
+        return 0;
+    }
+    memset(transmit_frames, 0, sizeof(transmit_frames[0]) * num);
+    memset(msgs, 0, sizeof(msgs[0]) * num);
+    for (unsigned i = 0; i < num; i++)
+    {
+        transmit_frames[i].can_id = frames[i].id;           // EFF/RTR/ERR are the same bits, see above
+        transmit_frames[i].len = frames[i].data_len;
+        memcpy(transmit_frames[i].data, frames[i].data, frames[i].data_len);
+        iovs[i].iov_base = &transmit_frames[i];
+        iovs[i].iov_len = CAN_MTU;
+#if CANARD_ENABLE_CANFD
+        if (frames[i].canfd)
+        {
+            iovs[i].iov_len = CANFD_MTU;
+        }
+#endif
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int num_sent = sendmmsg(ins->fd, msgs, num, MSG_DONTWAIT);
+    if (num_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeout_msec != 0)
+    {
+        const int16_t wait_result = waitForEvent(ins, POLLOUT, timeout_msec);
+        if (wait_result <= 0)
+        {
+            return wait_result;
+        }
+        num_sent = sendmmsg(ins->fd, msgs, num, MSG_DONTWAIT);
+    }
+    if (num_sent < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        {
+            return 0;                                       // The interface queue is full, try again later
+        }
+        return getErrorCode();
+    }
+    return (int16_t)num_sent;
+}
+
+int16_t socketcanReceiveBatch(SocketCANInstance* ins, CanardCANFrame* out_frames, uint64_t* out_timestamps_usec,
+                              uint16_t max_frames, int32_t timeout_msec)
+{
+    struct canfd_frame receive_frames[SOCKETCAN_MAX_BATCH];
+    struct iovec iovs[SOCKETCAN_MAX_BATCH];
+    struct mmsghdr msgs[SOCKETCAN_MAX_BATCH];
+    union
+    {
+        size_t align;                                       // struct cmsghdr alignment
+        uint8_t buf[TIMESTAMP_CONTROL_SIZE];
+    } controls[SOCKETCAN_MAX_BATCH];
+
+    const unsigned num = (max_frames < SOCKETCAN_MAX_BATCH) ? max_frames : SOCKETCAN_MAX_BATCH;
+    if (num == 0)
+    {
+        return 0;
+    }
+    memset(msgs, 0, sizeof(msgs[0]) * num);
+    for (unsigned i = 0; i < num; i++)
+    {
+        iovs[i].iov_base = &receive_frames[i];
+        iovs[i].iov_len = sizeof(receive_frames[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (out_timestamps_usec != NULL)
+        {
+            msgs[i].msg_hdr.msg_control = controls[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+        }
+    }
+
+    int num_received = recvmmsg(ins->fd, msgs, num, MSG_DONTWAIT, NULL);
+    if (num_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeout_msec != 0)
+    {
+        const int16_t wait_result = waitForEvent(ins, POLLIN, timeout_msec);
+        if (wait_result <= 0)
+        {
+            return wait_result;
+        }
+        num_received = recvmmsg(ins->fd, msgs, num, MSG_DONTWAIT, NULL);
+    }
+    if (num_received < 0)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : getErrorCode();
+    }
+
+    const int64_t realtime_to_monotonic = (out_timestamps_usec != NULL) ? getRealtimeToMonotonicUsec() : 0;
+    int16_t num_out = 0;
+    for (int i = 0; i < num_received; i++)
+    {
+        if (!socketcanConvertReceivedFrame(ins, &receive_frames[i], msgs[i].msg_len, &out_frames[num_out]))
+        {
+            continue;                                       // Malformed, drop it but keep the rest of the batch
+        }
+        if (out_timestamps_usec != NULL)
+        {
+            out_timestamps_usec[num_out] = getReceiveTimestamp(ins, &msgs[i].msg_hdr, realtime_to_monotonic);
+        }
+        num_out++;
+    }
+    return num_out;
+}
+
+#endif
+
 int socketcanGetSocketFileDescriptor(const SocketCANInstance* ins)
 {
     return ins->fd;
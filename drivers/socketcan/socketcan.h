@@ -15,12 +15,35 @@ extern "C"
 {
 #endif
 
+/**
+ * Maximum number of frames moved by one call of socketcanReceiveBatch() or socketcanTransmitBatch().
+ * The frames are staged on the stack, about 150 bytes per frame.
+ */
+#ifndef SOCKETCAN_MAX_BATCH
+#define SOCKETCAN_MAX_BATCH 32U
+#endif
+
+/**
+ * Maximum number of filters socketcanSetFilters() takes.
+ */
+#ifndef SOCKETCAN_MAX_FILTERS
+#define SOCKETCAN_MAX_FILTERS 32U
+#endif
+
+/**
+ * Sources of the receive timestamps, see socketcanEnableTimestamps().
+ */
+#define SOCKETCAN_TIMESTAMP_NONE        0U      ///< Taken in userspace when the frame is read
+#define SOCKETCAN_TIMESTAMP_SOFTWARE    1U      ///< Taken by the kernel when the frame arrived
+#define SOCKETCAN_TIMESTAMP_HARDWARE    2U      ///< Taken by the CAN controller, 0 for a frame it didn't stamp
+
 typedef struct
 {
     int fd;
 #ifdef CANARD_ENABLE_CANFD
     bool canfd;
 #endif
+    uint8_t timestamping;
 } SocketCANInstance;
 
 /**
@@ -53,6 +76,54 @@ int16_t socketcanTransmit(SocketCANInstance* ins, const CanardCANFrame* frame, i
  */
 int16_t socketcanReceive(SocketCANInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec);
 
+/**
+ * Replaces the kernel acceptance filters of the socket, e.g. with the output of canardMakeAcceptanceFilters().
+ * Call it again whenever the set of accepted transfers changes. With no filters no frame is received at all;
+ * a single filter with zero mask receives everything again.
+ * Returns 0 on success, negative on error.
+ */
+int16_t socketcanSetFilters(SocketCANInstance* ins, const CanardAcceptanceFilter* filters, uint16_t num_filters);
+
+/**
+ * Makes the kernel timestamp the received frames, for socketcanReceiveTimestamped() and socketcanReceiveBatch().
+ * With hardware set, the timestamps of the CAN controller are used instead if ethtool reports hardware receive
+ * timestamping for the interface and it is turned on (SIOCSHWTSTAMP); otherwise software timestamps are used for
+ * all frames, as on vcan. In hardware mode the rare frame the controller didn't stamp gets the timestamp 0 rather
+ * than a software timestamp, so the two timescales never mix.
+ * Returns the timestamp source now in use (SOCKETCAN_TIMESTAMP_*), negative on error.
+ */
+int16_t socketcanEnableTimestamps(SocketCANInstance* ins, bool hardware);
+
+/**
+ * Receives a CanardCANFrame from the CAN socket, along with the time it was received in microseconds.
+ * Software timestamps are on the CLOCK_MONOTONIC timescale, so they can be passed to canardHandleRxFrame();
+ * hardware timestamps are on the timescale of the CAN controller.
+ * Without socketcanEnableTimestamps() the timestamp is taken when the frame is read.
+ * Use negative timeout to block infinitely.
+ * Returns 1 on successful reception, 0 on timeout, negative on error.
+ */
+int16_t socketcanReceiveTimestamped(SocketCANInstance* ins, CanardCANFrame* out_frame, uint64_t* out_timestamp_usec,
+                                    int32_t timeout_msec);
+
+/**
+ * Transmits up to SOCKETCAN_MAX_BATCH frames from the array with a single system call.
+ * The timeout applies only if the socket can't take any frame right away; use negative timeout to block infinitely.
+ * Returns the number of frames transmitted, which can be less than num_frames if the socket buffer or the
+ * interface queue fills up; 0 on timeout or when the interface queue is full; negative on error.
+ */
+int16_t socketcanTransmitBatch(SocketCANInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                               int32_t timeout_msec);
+
+/**
+ * Receives up to max_frames (at most SOCKETCAN_MAX_BATCH) frames into the array with a single system call.
+ * If out_timestamps_usec is not NULL, it receives the timestamp of each frame as described for
+ * socketcanReceiveTimestamped().
+ * The timeout applies only if no frame is pending; use negative timeout to block infinitely.
+ * Returns the number of frames received, 0 on timeout, negative on error.
+ */
+int16_t socketcanReceiveBatch(SocketCANInstance* ins, CanardCANFrame* out_frames, uint64_t* out_timestamps_usec,
+                              uint16_t max_frames, int32_t timeout_msec);
+
 /**
  * Returns the file descriptor of the CAN socket.
  * Can be used for external IO multiplexing.
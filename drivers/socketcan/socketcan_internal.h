@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2016-2018 UAVCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+/*
+ * What socketcan.c shares with socketcan_uring.c; not part of the driver API.
+ */
+
+#ifndef SOCKETCAN_INTERNAL_H
+#define SOCKETCAN_INTERNAL_H
+
+#include "socketcan.h"
+#include <stddef.h>
+#ifdef __NuttX__
+#include <nuttx/can.h>
+#include <netpacket/can.h>
+#else
+#include <linux/can.h>
+#endif
+
+/**
+ * Converts a frame received into struct canfd_frame, classic or FD as told by the length of the message.
+ * Returns false if the frame is malformed or an FD frame on an instance without CAN FD.
+ */
+bool socketcanConvertReceivedFrame(const SocketCANInstance* ins, const struct canfd_frame* receive_frame,
+                                   size_t length, CanardCANFrame* out_frame);
+
+#endif
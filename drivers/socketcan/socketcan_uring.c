@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2016-2018 UAVCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+// This is needed to enable necessary declarations in sys/
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include "socketcan_uring.h"
+#include "socketcan_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/can.h>
+#include <linux/io_uring.h>
+
+/*
+ * Multishot receive and provided buffer rings are both needed, they arrived in Linux 6.0 and 5.19.
+ * With older headers only the poll based path is built.
+ */
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+# define SOCKETCAN_URING_SUPPORTED 1
+#else
+# define SOCKETCAN_URING_SUPPORTED 0
+#endif
+
+#if SOCKETCAN_URING_SUPPORTED
+
+#define RING_ENTRIES        64U
+#define BUFFER_GROUP        0U
+#define USER_DATA_RECV      0xFFFFFFFFFFFFFFFFULL   ///< TX operations carry their slot index instead
+
+#if (SOCKETCAN_URING_RX_BUFFERS & (SOCKETCAN_URING_RX_BUFFERS - 1U)) != 0
+# error "SOCKETCAN_URING_RX_BUFFERS must be a power of two"
+#endif
+#if SOCKETCAN_URING_TX_SLOTS > 32U
+# error "SOCKETCAN_URING_TX_SLOTS must not exceed 32"
+#endif
+
+/// A filled receive buffer that the application hasn't read yet
+typedef struct
+{
+    uint16_t bid;
+    uint16_t length;
+} PendingBuffer;
+
+struct SocketCANUring
+{
+    int ring_fd;
+    void* ring_ptr;
+    size_t ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;                      ///< Local tail, published on submission
+    unsigned to_submit;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+
+    struct io_uring_buf_ring* buf_ring;
+    size_t buf_ring_size;
+    uint16_t buf_tail;
+
+    PendingBuffer pending[SOCKETCAN_URING_RX_BUFFERS];
+    uint16_t pending_head;
+    uint16_t pending_count;
+
+    bool recv_armed;
+    bool received_any;                      ///< Tells an unsupported multishot receive from a later error
+    bool unsupported;
+
+    uint32_t tx_busy;                       ///< Bit per TX slot holding a frame that hasn't left yet
+    uint32_t tx_in_flight;                  ///< Bit per TX slot submitted and not completed yet
+    uint32_t tx_next_seq;
+    uint32_t tx_seq[SOCKETCAN_URING_TX_SLOTS];      ///< Order in which the slots were filled
+    uint8_t tx_length[SOCKETCAN_URING_TX_SLOTS];
+    int16_t tx_error;                       ///< First error since the last transmit call
+
+    struct canfd_frame rx_buffers[SOCKETCAN_URING_RX_BUFFERS];
+    struct canfd_frame tx_frames[SOCKETCAN_URING_TX_SLOTS];
+};
+
+static int uringSetup(unsigned entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(const SocketCANUring* uring, unsigned to_submit, unsigned min_complete, int32_t timeout_msec)
+{
+    unsigned flags = (min_complete > 0U) ? IORING_ENTER_GETEVENTS : 0U;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (min_complete > 0U && timeout_msec >= 0)
+    {
+        ts.tv_sec = timeout_msec / 1000;
+        ts.tv_nsec = (long long)(timeout_msec % 1000) * 1000000LL;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    const int ret = (int)syscall(__NR_io_uring_enter, uring->ring_fd, to_submit, min_complete, flags,
+                                 (flags & IORING_ENTER_EXT_ARG) ? (void*)&arg : NULL, sizeof(arg));
+    return (ret < 0) ? -errno : ret;
+}
+
+static int uringRegister(const SocketCANUring* uring, unsigned opcode, const void* arg, unsigned nr_args)
+{
+    const int ret = (int)syscall(__NR_io_uring_register, uring->ring_fd, opcode, arg, nr_args);
+    return (ret < 0) ? -errno : ret;
+}
+
+/// Returns a cleared submission entry, or NULL if the submission queue is full
+static struct io_uring_sqe* getSqe(SocketCANUring* uring)
+{
+    const unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+    if (uring->sqe_tail - head >= uring->sq_entries)
+    {
+        return NULL;
+    }
+    const unsigned index = uring->sqe_tail & uring->sq_mask;
+    uring->sq_array[index] = index;
+    uring->sqe_tail++;
+    uring->to_submit++;
+    struct io_uring_sqe* sqe = &uring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/// Publishes the prepared entries and optionally waits for a completion
+static int submitAndWait(SocketCANUring* uring, unsigned min_complete, int32_t timeout_msec)
+{
+    __atomic_store_n(uring->sq_tail, uring->sqe_tail, __ATOMIC_RELEASE);
+    if (uring->to_submit == 0U && min_complete == 0U)
+    {
+        return 0;
+    }
+    const int ret = uringEnter(uring, uring->to_submit, min_complete, timeout_msec);
+    if (ret >= 0)
+    {
+        uring->to_submit -= ((unsigned)ret < uring->to_submit) ? (unsigned)ret : uring->to_submit;
+    }
+    else if (ret == -ETIME || ret == -EINTR)
+    {
+        // The entries were submitted before the wait ended
+        uring->to_submit = 0;
+    }
+    return ret;
+}
+
+static void armReceive(SocketCANUring* uring, int fd)
+{
+    struct io_uring_sqe* sqe = getSqe(uring);
+    if (sqe == NULL)
+    {
+        return;                             // Armed on the next call
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = USER_DATA_RECV;
+    uring->recv_armed = true;
+}
+
+/// Hands a receive buffer back to the kernel
+static void recycleBuffer(SocketCANUring* uring, uint16_t bid)
+{
+    struct io_uring_buf* buf = &uring->buf_ring->bufs[uring->buf_tail & (SOCKETCAN_URING_RX_BUFFERS - 1U)];
+    buf->addr = (uint64_t)(uintptr_t)&uring->rx_buffers[bid];
+    buf->len = sizeof(uring->rx_buffers[bid]);
+    buf->bid = bid;
+    uring->buf_tail++;
+    __atomic_store_n(&uring->buf_ring->tail, uring->buf_tail, __ATOMIC_RELEASE);
+}
+
+/// Processes all completions: received buffers are queued for the application, TX slots are released
+static void reapCompletions(SocketCANUring* uring)
+{
+    unsigned head = *uring->cq_head;
+    const unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        const struct io_uring_cqe* cqe = &uring->cqes[head & uring->cq_mask];
+        if (cqe->user_data == USER_DATA_RECV)
+        {
+            if ((cqe->flags & IORING_CQE_F_MORE) == 0U)
+            {
+                uring->recv_armed = false;
+            }
+            if ((cqe->flags & IORING_CQE_F_BUFFER) != 0U)
+            {
+                const uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                if (cqe->res > 0)
+                {
+                    PendingBuffer* pending = &uring->pending[(uring->pending_head + uring->pending_count) &
+                                                             (SOCKETCAN_URING_RX_BUFFERS - 1U)];
+                    pending->bid = bid;
+                    pending->length = (uint16_t)cqe->res;
+                    uring->pending_count++;
+                    uring->received_any = true;
+                }
+                else
+                {
+                    recycleBuffer(uring, bid);
+                }
+            }
+            else if (cqe->res == -EINVAL && !uring->received_any)
+            {
+                uring->unsupported = true;  // The kernel doesn't know multishot receive
+            }
+        }
+        else
+        {
+            const uint32_t bit = 1UL << (uint32_t)cqe->user_data;
+            uring->tx_in_flight &= ~bit;
+            // A full interface queue is no error, the frame stays in its slot and is sent again. So are the
+            // frames linked after a failed send, which the kernel cancels.
+            if (cqe->res == -ENOBUFS || cqe->res == -EAGAIN || cqe->res == -ECANCELED)
+            {
+                continue;
+            }
+            uring->tx_busy &= ~bit;
+            if (cqe->res < 0 && uring->tx_error == 0)
+            {
+                uring->tx_error = (int16_t)((cqe->res >= INT16_MIN) ? cqe->res : INT16_MIN);
+            }
+        }
+    }
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/// Adds a send of the slot to the chain, returns false if the submission queue is full
+static bool queueSend(SocketCANUring* uring, int fd, uint32_t slot, struct io_uring_sqe** previous)
+{
+    struct io_uring_sqe* sqe = getSqe(uring);
+    if (sqe == NULL)
+    {
+        return false;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&uring->tx_frames[slot];
+    sqe->len = uring->tx_length[slot];
+    sqe->user_data = slot;
+    // Linked so that the frames leave in order even if one of them has to wait
+    if (*previous != NULL)
+    {
+        (*previous)->flags |= IOSQE_IO_LINK;
+    }
+    *previous = sqe;
+    uring->tx_in_flight |= 1UL << slot;
+    return true;
+}
+
+/// Sends the frames the interface refused again, oldest first; returns false if not all of them could be queued
+static bool requeueRefused(SocketCANUring* uring, int fd, struct io_uring_sqe** previous)
+{
+    uint32_t refused = uring->tx_busy & ~uring->tx_in_flight;
+    while (refused != 0U)
+    {
+        uint32_t oldest = 0;
+        while ((refused & (1UL << oldest)) == 0U)
+        {
+            oldest++;
+        }
+        for (uint32_t slot = oldest + 1U; slot < SOCKETCAN_URING_TX_SLOTS; slot++)
+        {
+            if ((refused & (1UL << slot)) != 0U && (int32_t)(uring->tx_seq[slot] - uring->tx_seq[oldest]) < 0)
+            {
+                oldest = slot;
+            }
+        }
+        if (!queueSend(uring, fd, oldest, previous))
+        {
+            return false;
+        }
+        refused &= ~(1UL << oldest);
+    }
+    return true;
+}
+
+static void destroyUring(SocketCANUring* uring)
+{
+    if (uring->buf_ring != NULL)
+    {
+        (void)munmap(uring->buf_ring, uring->buf_ring_size);
+    }
+    if (uring->sqes != NULL)
+    {
+        (void)munmap(uring->sqes, uring->sqes_size);
+    }
+    if (uring->ring_ptr != NULL)
+    {
+        (void)munmap(uring->ring_ptr, uring->ring_size);
+    }
+    if (uring->ring_fd >= 0)
+    {
+        (void)close(uring->ring_fd);
+    }
+    free(uring);
+}
+
+/// Sets up the rings and arms the receive; returns NULL if io_uring or a needed feature is unavailable
+static SocketCANUring* createUring(int fd)
+{
+    SocketCANUring* uring = (SocketCANUring*)calloc(1, sizeof(SocketCANUring));
+    if (uring == NULL)
+    {
+        return NULL;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    uring->ring_fd = uringSetup(RING_ENTRIES, &params);
+    if (uring->ring_fd < 0 ||
+        (params.features & IORING_FEAT_SINGLE_MMAP) == 0U || (params.features & IORING_FEAT_EXT_ARG) == 0U)
+    {
+        goto fail;
+    }
+
+    const size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    const size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    uring->ring_size = (sq_size > cq_size) ? sq_size : cq_size;
+    void* ring_ptr = mmap(NULL, uring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          uring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring_ptr == MAP_FAILED)
+    {
+        goto fail;
+    }
+    uring->ring_ptr = ring_ptr;
+    uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      uring->ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        goto fail;
+    }
+    uring->sqes = (struct io_uring_sqe*)sqes;
+
+    uint8_t* const base = (uint8_t*)ring_ptr;
+    uring->sq_head = (unsigned*)(void*)(base + params.sq_off.head);
+    uring->sq_tail = (unsigned*)(void*)(base + params.sq_off.tail);
+    uring->sq_array = (unsigned*)(void*)(base + params.sq_off.array);
+    uring->sq_mask = *(unsigned*)(void*)(base + params.sq_off.ring_mask);
+    uring->sq_entries = params.sq_entries;
+    uring->sqe_tail = *uring->sq_tail;
+    uring->cq_head = (unsigned*)(void*)(base + params.cq_off.head);
+    uring->cq_tail = (unsigned*)(void*)(base + params.cq_off.tail);
+    uring->cq_mask = *(unsigned*)(void*)(base + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe*)(void*)(base + params.cq_off.cqes);
+
+    // The provided buffer ring has to be page aligned, which mmap guarantees
+    uring->buf_ring_size = SOCKETCAN_URING_RX_BUFFERS * sizeof(struct io_uring_buf);
+    void* buf_ring = mmap(NULL, uring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf_ring == MAP_FAILED)
+    {
+        goto fail;
+    }
+    uring->buf_ring = (struct io_uring_buf_ring*)buf_ring;
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+    reg.ring_entries = SOCKETCAN_URING_RX_BUFFERS;
+    reg.bgid = BUFFER_GROUP;
+    if (uringRegister(uring, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        goto fail;
+    }
+    for (uint16_t bid = 0; bid < SOCKETCAN_URING_RX_BUFFERS; bid++)
+    {
+        recycleBuffer(uring, bid);
+    }
+
+    armReceive(uring, fd);
+    if (submitAndWait(uring, 0, 0) < 0)
+    {
+        goto fail;
+    }
+    return uring;
+
+fail:
+    destroyUring(uring);
+    return NULL;
+}
+
+/// Switches to the poll based path for good, after the kernel turned out not to support what we need
+static void fallBackToPoll(SocketCANUringInstance* ins)
+{
+    destroyUring(ins->uring);
+    ins->uring = NULL;
+}
+
+static uint64_t monotonicMsec(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+#endif // SOCKETCAN_URING_SUPPORTED
+
+#if CANARD_ENABLE_CANFD
+int16_t socketcanUringInit(SocketCANUringInstance* out_ins, const char* can_iface_name, bool canfd)
+#else
+int16_t socketcanUringInit(SocketCANUringInstance* out_ins, const char* can_iface_name)
+#endif
+{
+    out_ins->uring = NULL;
+#if CANARD_ENABLE_CANFD
+    const int16_t res = socketcanInit(&out_ins->socketcan, can_iface_name, canfd);
+#else
+    const int16_t res = socketcanInit(&out_ins->socketcan, can_iface_name);
+#endif
+    if (res < 0)
+    {
+        return res;
+    }
+#if SOCKETCAN_URING_SUPPORTED
+    out_ins->uring = createUring(out_ins->socketcan.fd);
+#endif
+    return 0;
+}
+
+int16_t socketcanUringClose(SocketCANUringInstance* ins)
+{
+#if SOCKETCAN_URING_SUPPORTED
+    if (ins->uring != NULL)
+    {
+        destroyUring(ins->uring);
+        ins->uring = NULL;
+    }
+#endif
+    return socketcanClose(&ins->socketcan);
+}
+
+bool socketcanUringIsActive(const SocketCANUringInstance* ins)
+{
+    return ins->uring != NULL;
+}
+
+int16_t socketcanUringTransmitBatch(SocketCANUringInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                                    int32_t timeout_msec)
+{
+#if SOCKETCAN_URING_SUPPORTED
+    SocketCANUring* const uring = ins->uring;
+    if (uring != NULL)
+    {
+        reapCompletions(uring);
+        if (uring->tx_error != 0)
+        {
+            const int16_t error = uring->tx_error;
+            uring->tx_error = 0;
+            return error;
+        }
+        // New frames wait until the earlier ones completed, a frame the interface refuses is sent again and must
+        // not be overtaken by a later one
+        if (uring->tx_in_flight != 0U && timeout_msec != 0)
+        {
+            const int ret = submitAndWait(uring, (unsigned)__builtin_popcount(uring->tx_in_flight), timeout_msec);
+            if (ret < 0 && ret != -ETIME && ret != -EINTR)
+            {
+                return (int16_t)ret;
+            }
+            reapCompletions(uring);
+        }
+
+        int16_t num_queued = 0;
+        struct io_uring_sqe* previous = NULL;
+        if (uring->tx_in_flight == 0U && requeueRefused(uring, ins->socketcan.fd, &previous))
+        {
+            const uint32_t all_slots = (SOCKETCAN_URING_TX_SLOTS >= 32U) ?
+                                       0xFFFFFFFFUL : ((1UL << SOCKETCAN_URING_TX_SLOTS) - 1UL);
+            while (num_queued < (int16_t)num_frames && uring->tx_busy != all_slots)
+            {
+                uint32_t slot = 0;
+                while ((uring->tx_busy & (1UL << slot)) != 0U)
+                {
+                    slot++;
+                }
+                const CanardCANFrame* frame = &frames[num_queued];
+                struct canfd_frame* tx_frame = &uring->tx_frames[slot];
+                memset(tx_frame, 0, sizeof(*tx_frame));
+                tx_frame->can_id = frame->id;   // EFF/RTR/ERR are the same bits, checked in socketcan.c
+                tx_frame->len = frame->data_len;
+                memcpy(tx_frame->data, frame->data, frame->data_len);
+                uring->tx_length[slot] = CAN_MTU;
+#if CANARD_ENABLE_CANFD
+                if (frame->canfd)
+                {
+                    uring->tx_length[slot] = CANFD_MTU;
+                }
+#endif
+                if (!queueSend(uring, ins->socketcan.fd, slot, &previous))
+                {
+                    break;
+                }
+                uring->tx_seq[slot] = uring->tx_next_seq++;
+                uring->tx_busy |= 1UL << slot;
+                num_queued++;
+            }
+        }
+        if (!uring->recv_armed)
+        {
+            armReceive(uring, ins->socketcan.fd);
+        }
+        const int ret = submitAndWait(uring, 0, 0);
+        if (ret < 0 && num_queued == 0)
+        {
+            return (int16_t)ret;
+        }
+        return num_queued;
+    }
+#endif
+    return socketcanTransmitBatch(&ins->socketcan, frames, num_frames, timeout_msec);
+}
+
+int16_t socketcanUringReceiveBatch(SocketCANUringInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames,
+                                   int32_t timeout_msec)
+{
+#if SOCKETCAN_URING_SUPPORTED
+    SocketCANUring* uring = ins->uring;
+    const uint64_t deadline = (timeout_msec > 0) ? monotonicMsec() + (uint64_t)timeout_msec : 0U;
+    while (uring != NULL)
+    {
+        reapCompletions(uring);
+        if (uring->unsupported)
+        {
+            fallBackToPoll(ins);
+            break;
+        }
+
+        int16_t num_received = 0;
+        while (num_received < (int16_t)max_frames && uring->pending_count > 0U)
+        {
+            const PendingBuffer pending = uring->pending[uring->pending_head];
+            uring->pending_head = (uint16_t)((uring->pending_head + 1U) & (SOCKETCAN_URING_RX_BUFFERS - 1U));
+            uring->pending_count--;
+            if (socketcanConvertReceivedFrame(&ins->socketcan, &uring->rx_buffers[pending.bid], pending.length,
+                                              &out_frames[num_received]))
+            {
+                num_received++;
+            }
+            recycleBuffer(uring, pending.bid);
+        }
+        if (!uring->recv_armed)
+        {
+            // The receive stops when all buffers were taken, now that some are back it can go on
+            armReceive(uring, ins->socketcan.fd);
+        }
+        if (num_received > 0 || timeout_msec == 0)
+        {
+            (void)submitAndWait(uring, 0, 0);
+            return num_received;
+        }
+
+        int32_t remaining = timeout_msec;
+        if (timeout_msec > 0)
+        {
+            const uint64_t now = monotonicMsec();
+            if (now >= deadline)
+            {
+                (void)submitAndWait(uring, 0, 0);
+                return 0;
+            }
+            remaining = (int32_t)(deadline - now);
+        }
+        const int ret = submitAndWait(uring, 1, remaining);
+        if (ret == -ETIME)
+        {
+            return 0;
+        }
+        if (ret < 0 && ret != -EINTR)
+        {
+            return (int16_t)ret;
+        }
+    }
+#endif
+    return socketcanReceiveBatch(&ins->socketcan, out_frames, NULL, max_frames, timeout_msec);
+}
+
+int16_t socketcanUringTransmit(SocketCANUringInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec)
+{
+    return socketcanUringTransmitBatch(ins, frame, 1, timeout_msec);
+}
+
+int16_t socketcanUringReceive(SocketCANUringInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec)
+{
+    return socketcanUringReceiveBatch(ins, out_frame, 1, timeout_msec);
+}
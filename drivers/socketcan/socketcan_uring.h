@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016-2018 UAVCAN Team
+ *
+ * Distributed under the MIT License, available in the file LICENSE.
+ *
+ */
+
+/*
+ * SocketCAN driver on io_uring: frames are received by a multishot receive into a ring of provided buffers and
+ * sent by linked send operations, so a busy bus costs a fraction of a system call per frame.
+ * If io_uring or the needed features are not available, the poll based socketcan.c path is used instead.
+ */
+
+#ifndef SOCKETCAN_URING_H
+#define SOCKETCAN_URING_H
+
+#include "socketcan.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Number of receive buffers the kernel can fill before the application reads them; a power of two.
+ */
+#ifndef SOCKETCAN_URING_RX_BUFFERS
+#define SOCKETCAN_URING_RX_BUFFERS 128U
+#endif
+
+/**
+ * Number of frames that can be in flight towards the socket at once; at most 32.
+ */
+#ifndef SOCKETCAN_URING_TX_SLOTS
+#define SOCKETCAN_URING_TX_SLOTS 32U
+#endif
+
+typedef struct SocketCANUring SocketCANUring;
+
+typedef struct
+{
+    SocketCANInstance socketcan;        ///< The socket, used directly when io_uring is unavailable
+    SocketCANUring* uring;              ///< NULL when the poll based path is used
+} SocketCANUringInstance;
+
+/**
+ * Initializes the instance, on io_uring if possible.
+ * Returns 0 on success, negative on error.
+ */
+#if CANARD_ENABLE_CANFD
+int16_t socketcanUringInit(SocketCANUringInstance* out_ins, const char* can_iface_name, bool canfd);
+#else
+int16_t socketcanUringInit(SocketCANUringInstance* out_ins, const char* can_iface_name);
+#endif
+
+/**
+ * Deinitializes the instance.
+ * Returns 0 on success, negative on error.
+ */
+int16_t socketcanUringClose(SocketCANUringInstance* ins);
+
+/**
+ * Returns true if the instance runs on io_uring, false if it fell back to the poll based path.
+ */
+bool socketcanUringIsActive(const SocketCANUringInstance* ins);
+
+/**
+ * Queues a CanardCANFrame for transmission, see socketcanUringTransmitBatch().
+ * Use negative timeout to block infinitely.
+ * Returns 1 on success, 0 on timeout or when the frame can't be queued yet, negative on error.
+ */
+int16_t socketcanUringTransmit(SocketCANUringInstance* ins, const CanardCANFrame* frame, int32_t timeout_msec);
+
+/**
+ * Receives a CanardCANFrame.
+ * Use negative timeout to block infinitely.
+ * Returns 1 on successful reception, 0 on timeout, negative on error.
+ */
+int16_t socketcanUringReceive(SocketCANUringInstance* ins, CanardCANFrame* out_frame, int32_t timeout_msec);
+
+/**
+ * Queues up to num_frames frames for transmission, in order, with at most one system call.
+ * A queued frame stays in the driver until the interface takes it: if the interface queue is full, it is sent again
+ * by the next call, before any new frame. New frames are queued only once the earlier sends completed, so the call
+ * returns 0 while they are pending, as socketcanTransmitBatch() does when the interface queue is full.
+ * The timeout applies to waiting for earlier sends to complete; use negative timeout to block infinitely.
+ * Returns the number of frames queued, 0 on timeout or when no frame can be queued yet, negative on error.
+ * An error of an earlier frame, which is then dropped, is returned by the next call.
+ */
+int16_t socketcanUringTransmitBatch(SocketCANUringInstance* ins, const CanardCANFrame* frames, uint16_t num_frames,
+                                    int32_t timeout_msec);
+
+/**
+ * Receives up to max_frames frames.
+ * The timeout applies only if no frame is pending; use negative timeout to block infinitely.
+ * Returns the number of frames received, 0 on timeout, negative on error.
+ */
+int16_t socketcanUringReceiveBatch(SocketCANUringInstance* ins, CanardCANFrame* out_frames, uint16_t max_frames,
+                                   int32_t timeout_msec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
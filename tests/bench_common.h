@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+/*
+ * Throughput measurement shared by the driver benchmarks. A benchmark describes its pair of instances with a bus
+ * type that has static transmit(), receive(), transmitBatch() and receiveBatch() functions taking the arguments of
+ * the driver functions without the instance, and passes moveFramesOneByOne<Bus> or moveFramesInBatches<Bus> to
+ * report().
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include <canard.h>
+
+static const unsigned BENCH_BURST = 32U;
+
+static CanardCANFrame tx_frames[BENCH_BURST];
+static CanardCANFrame rx_frames[BENCH_BURST];
+static unsigned mismatches;
+
+// Numbers the frames of a burst so that frames received out of order or corrupted are counted as mismatches
+static void initFrames()
+{
+    for (unsigned i = 0; i < BENCH_BURST; i++)
+    {
+        tx_frames[i].id = CANARD_CAN_FRAME_EFF | (341U << 8U) | 10U;
+        tx_frames[i].data_len = 8;
+        tx_frames[i].data[0] = (uint8_t)i;
+        tx_frames[i].data[7] = (uint8_t)(0xC0U | (i & 31U));
+    }
+}
+
+static void checkFrame(const CanardCANFrame& frame, unsigned index)
+{
+    if (frame.id != tx_frames[index].id || frame.data_len != tx_frames[index].data_len ||
+        memcmp(frame.data, tx_frames[index].data, frame.data_len) != 0)
+    {
+        mismatches++;
+    }
+}
+
+// Frames are sent in bursts and read back before the next burst, so the receiver never overflows;
+// returns the number of frames that made it through
+template <typename Bus>
+static unsigned moveFramesOneByOne(unsigned num_frames)
+{
+    unsigned received = 0;
+    for (unsigned sent = 0; sent < num_frames; sent += BENCH_BURST)
+    {
+        unsigned burst = 0;
+        for (; burst < BENCH_BURST; burst++)
+        {
+            if (Bus::transmit(&tx_frames[burst], 100) <= 0)
+            {
+                break;
+            }
+        }
+        for (unsigned i = 0; i < burst; i++)
+        {
+            if (Bus::receive(&rx_frames[i], 100) <= 0)
+            {
+                break;
+            }
+            checkFrame(rx_frames[i], i);
+            received++;
+        }
+    }
+    return received;
+}
+
+template <typename Bus>
+static unsigned moveFramesInBatches(unsigned num_frames)
+{
+    unsigned received = 0;
+    for (unsigned sent = 0; sent < num_frames; sent += BENCH_BURST)
+    {
+        int16_t burst = 0;
+        while (burst < (int16_t)BENCH_BURST)
+        {
+            const int16_t res = Bus::transmitBatch(&tx_frames[burst], (uint16_t)(BENCH_BURST - (unsigned)burst), 100);
+            if (res <= 0)
+            {
+                break;
+            }
+            burst = (int16_t)(burst + res);
+        }
+        int16_t done = 0;
+        while (done < burst)
+        {
+            const int16_t res = Bus::receiveBatch(&rx_frames[done], (uint16_t)(burst - done), 100);
+            if (res <= 0)
+            {
+                break;
+            }
+            for (int16_t i = done; i < done + res; i++)
+            {
+                checkFrame(rx_frames[i], (unsigned)i);
+            }
+            done = (int16_t)(done + res);
+            received += (unsigned)res;
+        }
+    }
+    return received;
+}
+
+// User plus system time of the process
+static double cpuSeconds()
+{
+    struct rusage usage;
+    (void)getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+static void report(const char* name, unsigned (*move)(unsigned), unsigned num_frames)
+{
+    mismatches = 0;
+    const double cpu_started = cpuSeconds();
+    const auto started = std::chrono::steady_clock::now();
+    const unsigned received = move(num_frames);
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    const double sec = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * 1e-9;
+    const double cpu_sec = cpuSeconds() - cpu_started;
+
+    printf("%-8s frames=%u received=%u mismatches=%u time=%.3f s throughput=%.0f frames/s cpu=%.2f us/frame\n",
+           name, num_frames, received, mismatches, sec, (double)received / sec,
+           (received > 0) ? cpu_sec * 1e6 / (double)received : 0.0);
+}
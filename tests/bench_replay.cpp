@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+/*
+ * Replays a candump log or a SocketCAN pcap capture through canardHandleRxFrame(), as fast as possible or at the
+ * recorded timing, and reports the transfers received per data type, the frames rejected per error code and the
+ * throughput. Data types are accepted with the signatures given with -s; multi-frame transfers of the others fail
+ * the transfer CRC and are counted as such.
+ * usage: Canard_bench_replay [-n node_id] [-s data_type_id:signature]... [-r speed] [-l loops] capture
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "replay.h"
+
+static const size_t ARENA_SIZE = 1024U * 1024U;
+
+static uint8_t arena[ARENA_SIZE];
+static std::map<uint16_t, uint64_t> signatures;
+static std::map<uint16_t, uint64_t> transfers[3];
+static uint64_t num_transfers;
+
+static const char* const error_names[REPLAY_NUM_ERROR_CODES] = {
+    "other",
+    nullptr,
+    "invalid argument",
+    "out of memory",
+    "node id not set",
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    "internal",
+    "incompatible packet",
+    "wrong address",
+    "not wanted",
+    "missed start",
+    "wrong toggle",
+    "unexpected transfer id",
+    "short frame",
+    "bad crc",
+};
+
+static const char* const transfer_type_names[3] = {"response", "request", "broadcast"};
+
+static bool shouldAccept(const CanardInstance* ins, uint64_t* out_data_type_signature, uint16_t data_type_id,
+                         CanardTransferType transfer_type, uint8_t source_node_id)
+{
+    (void)ins;
+    (void)transfer_type;
+    (void)source_node_id;
+    const auto it = signatures.find(data_type_id);
+    *out_data_type_signature = (it != signatures.end()) ? it->second : 0U;
+    return true;
+}
+
+static void onTransferReceived(CanardInstance* ins, CanardRxTransfer* transfer)
+{
+    (void)ins;
+    transfers[transfer->transfer_type][transfer->data_type_id]++;
+    num_transfers++;
+}
+
+static double cpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: Canard_bench_replay [-n node_id] [-s data_type_id:signature]... [-r speed] [-l loops] "
+                    "capture\n"
+                    "  -n  local node id, to receive service transfers addressed to it\n"
+                    "  -s  signature of a data type, in hex\n"
+                    "  -r  replay at the recorded timing sped up by this factor, default as fast as possible\n"
+                    "  -l  replay the capture this many times\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned node_id = 0;
+    float speed = 0.0F;
+    unsigned loops = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:r:l:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            node_id = (unsigned)strtoul(optarg, nullptr, 10);
+            break;
+        case 's':
+        {
+            char* end = nullptr;
+            const unsigned long data_type_id = strtoul(optarg, &end, 10);
+            if (*end != ':')
+            {
+                usage();
+                return 1;
+            }
+            signatures[(uint16_t)data_type_id] = strtoull(end + 1, nullptr, 16);
+            break;
+        }
+        case 'r':
+            speed = strtof(optarg, nullptr);
+            break;
+        case 'l':
+            loops = (unsigned)strtoul(optarg, nullptr, 10);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || node_id > CANARD_MAX_NODE_ID || speed < 0.0F)
+    {
+        usage();
+        return 1;
+    }
+
+    ReplayCapture cap;
+    const int16_t res = replayOpen(&cap, argv[optind]);
+    if (res < 0)
+    {
+        fprintf(stderr, "can't open %s: %s\n", argv[optind], strerror(-res));
+        return 1;
+    }
+
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceived, shouldAccept, nullptr);
+    if (node_id != 0U)
+    {
+        canardSetLocalNodeID(&ins, (uint8_t)node_id);
+    }
+
+    ReplayStatistics stats;
+    memset(&stats, 0, sizeof(stats));
+    const double cpu_start = cpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < loops; i++)
+    {
+        // timestamps start over, so do the sessions
+        replayRewind(&cap);
+        canardReset(&ins, CANARD_RESET_RX_STATES);
+        replayRun(&cap, &ins, speed, &stats);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cpu = cpuSeconds() - cpu_start;
+
+    const uint64_t recorded_usec = (stats.last_timestamp_usec > stats.first_timestamp_usec) ?
+                                   stats.last_timestamp_usec - stats.first_timestamp_usec : 0U;
+    printf("%s: %s, %.3f s recorded\n", argv[optind], (cap.format == ReplayFormatPcap) ? "pcap" : "candump",
+           (double)recorded_usec / 1e6);
+    for (uint8_t i = 0; i < cap.num_ifaces; i++)
+    {
+        printf("  iface %u: %s\n", i, cap.ifaces[i]);
+    }
+    if (cap.merged != 0U)
+    {
+        printf("  %" PRIu64 " frames of further interfaces counted as iface %u\n", cap.merged, REPLAY_MAX_IFACES - 1U);
+    }
+    printf("frames=%" PRIu64 " accepted=%" PRIu64 " malformed=%" PRIu64 " unsupported=%" PRIu64 "\n", stats.frames,
+           stats.accepted, cap.malformed, cap.unsupported);
+    printf("transfers=%" PRIu64 "\n", num_transfers);
+    for (unsigned type = 0; type < 3U; type++)
+    {
+        for (const auto& entry : transfers[type])
+        {
+            printf("  %-9s %5u: %" PRIu64 "\n", transfer_type_names[type], entry.first, entry.second);
+        }
+    }
+    printf("errors:\n");
+    for (unsigned code = 0; code < REPLAY_NUM_ERROR_CODES; code++)
+    {
+        if (stats.errors[code] != 0U)
+        {
+            printf("  %-22s %" PRIu64 "\n", (error_names[code] != nullptr) ? error_names[code] : "?", stats.errors[code]);
+        }
+    }
+    printf("time=%.3f s throughput=%.0f frames/s cpu=%.3f us/frame\n", seconds, (double)stats.frames / seconds,
+           (stats.frames != 0U) ? cpu * 1e6 / (double)stats.frames : 0.0);
+
+    replayClose(&cap);
+    return 0;
+}
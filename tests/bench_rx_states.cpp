@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+/*
+ * Scans a large number of RX sessions, each of which holds several payload blocks. Built once with the default
+ * arena layout and once with CANARD_RX_STATE_ARRAY_SIZE; run both under bench_rx_states.sh to compare cache misses.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "canard.h"
+
+#define NUM_DATA_TYPES      8U
+#define NUM_SOURCES         127U
+#define FRAMES_PER_SESSION  12U
+#define NUM_BLOCKS          16384U
+
+static CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+
+static bool shouldAcceptAll(const CanardInstance*, uint64_t* out_data_type_signature, uint16_t,
+                            CanardTransferType, uint8_t)
+{
+    *out_data_type_signature = 0;
+    return true;
+}
+
+static void onTransferReceptionNop(CanardInstance*, CanardRxTransfer*)
+{
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned iterations = (argc > 1) ? (unsigned)strtoul(argv[1], NULL, 10) : 20000U;
+
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 127);
+
+    // Every session is started and fed with a few frames before the next one, so that its payload blocks follow
+    // the RX state in the arena, like they do on a busy bus
+    CanardCANFrame frame {};
+    frame.data_len = 8;
+    unsigned sessions = 0;
+    for (unsigned dtid = 0; dtid < NUM_DATA_TYPES; dtid++)
+    {
+        for (unsigned source = 1; source <= NUM_SOURCES; source++)
+        {
+            frame.id = CANARD_CAN_FRAME_EFF | ((1000U + dtid) << 8U) | source;
+            frame.data[7] = 0x80;
+            if (canardHandleRxFrame(&ins, &frame, 1000) != CANARD_OK)
+            {
+                continue;
+            }
+            sessions++;
+            for (unsigned i = 1; i < FRAMES_PER_SESSION; i++)
+            {
+                frame.data[7] = (uint8_t)((i & 1U) << 5U);
+                (void)canardHandleRxFrame(&ins, &frame, 1000);
+            }
+        }
+    }
+
+    // Nothing is stale at this time, so every call walks all sessions without modifying them
+    const auto started = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; i++)
+    {
+        canardCleanupStaleTransfers(&ins, 1000 + i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+    printf("rx_state_array=%u sessions=%u pool_blocks_used=%u scan=%.2f ns/session\n",
+           (unsigned)CANARD_RX_STATE_ARRAY_SIZE, sessions,
+           (unsigned)canardGetPoolAllocatorStatistics(&ins).current_usage_blocks,
+           ns / ((double)iterations * (double)sessions));
+    return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+#
+# Compares cache behaviour of RX session scans with the default arena layout and with the dense RX state array.
+# usage: bench_rx_states.sh <build directory> [iterations]
+#
+
+BUILD_DIR=${1:-build}
+ITERATIONS=${2:-20000}
+
+for bench in Canard_bench_rx_states Canard_bench_rx_states_dense; do
+    binary=$(find "$BUILD_DIR" -type f -name "$bench" | head -n 1)
+    if [ -z "$binary" ]; then
+        echo "$bench not found in $BUILD_DIR" >&2
+        exit 1
+    fi
+    if command -v perf >/dev/null 2>&1; then
+        perf stat -e cache-references,cache-misses,L1-dcache-load-misses "$binary" "$ITERATIONS"
+    else
+        echo "perf is not available, reporting timing only" >&2
+        "$binary" "$ITERATIONS"
+    fi
+done
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+/*
+ * Sends single frame transfers at a steady rate while the application thread stalls now and then, as it would in
+ * a slow callback, and counts the transfers it receives: first receiving on the application thread, then with a
+ * receive thread filling the ring of the Linux driver.
+ * usage: Canard_bench_rx_thread [bus] [frames] [frames/s] [stall ms] [rx cpu]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "linux.h"
+
+static const uint16_t DATA_TYPE_ID = 341U;
+static const unsigned STALL_PERIOD_MSEC = 50U;
+
+static uint8_t arena[16384];
+static unsigned num_transfers;
+
+static bool shouldAccept(const CanardInstance* ins, uint64_t* out_data_type_signature, uint16_t data_type_id,
+                         CanardTransferType transfer_type, uint8_t source_node_id)
+{
+    (void)ins;
+    (void)transfer_type;
+    (void)source_node_id;
+    *out_data_type_signature = 0U;
+    return data_type_id == DATA_TYPE_ID;
+}
+
+static void onTransferReceived(CanardInstance* ins, CanardRxTransfer* transfer)
+{
+    (void)ins;
+    (void)transfer;
+    num_transfers++;
+}
+
+// Sends num_frames transfers from node 10 at the given rate, in bursts of ten frames
+static void sendFrames(LinuxCANInstance* tx, unsigned num_frames, unsigned rate, std::atomic<bool>* done)
+{
+    const auto started = std::chrono::steady_clock::now();
+    CanardCANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.id = CANARD_CAN_FRAME_EFF | (16U << 24U) | ((uint32_t)DATA_TYPE_ID << 8U) | 10U;
+    frame.data_len = 8;
+    for (unsigned i = 0; i < num_frames; i++)
+    {
+        if (i % 10U == 0U)
+        {
+            const auto due = started + std::chrono::nanoseconds((uint64_t)i * 1000000000ULL / rate);
+            while (std::chrono::steady_clock::now() < due)
+            {
+            }
+        }
+        frame.data[0] = (uint8_t)i;
+        frame.data[7] = (uint8_t)(0xC0U | (i & 31U));
+        (void)LinuxCANTransmit(tx, &frame, 10);
+    }
+    // let the last frames arrive
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    done->store(true);
+}
+
+// Stalls the application thread for stall_msec every STALL_PERIOD_MSEC
+static void maybeStall(std::chrono::steady_clock::time_point* next_stall, unsigned stall_msec)
+{
+    if (stall_msec > 0U && std::chrono::steady_clock::now() >= *next_stall)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(stall_msec));
+        *next_stall += std::chrono::milliseconds(STALL_PERIOD_MSEC);
+    }
+}
+
+static void report(const char* name, unsigned num_frames, double sec, uint64_t overruns)
+{
+    printf("%-8s frames=%u received=%u lost=%u ring_overruns=%llu time=%.3f s\n", name, num_frames, num_transfers,
+           num_frames - num_transfers, (unsigned long long)overruns, sec);
+}
+
+int main(int argc, char** argv)
+{
+    const char* bus = (argc > 1) ? argv[1] : "mcast:0";
+    const unsigned num_frames = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 10) : 100000U;
+    const unsigned rate = (argc > 3) ? (unsigned)strtoul(argv[3], NULL, 10) : 20000U;
+    const unsigned stall_msec = (argc > 4) ? (unsigned)strtoul(argv[4], NULL, 10) : 20U;
+    const int rx_cpu = (argc > 5) ? atoi(argv[5]) : -1;
+
+    LinuxCANInstance tx;
+    LinuxCANInstance rx;
+#if CANARD_ENABLE_CANFD
+    const int16_t tx_res = LinuxCANInit(&tx, bus, false);
+    const int16_t rx_res = LinuxCANInit(&rx, bus, false);
+#else
+    const int16_t tx_res = LinuxCANInit(&tx, bus);
+    const int16_t rx_res = LinuxCANInit(&rx, bus);
+#endif
+    if (tx_res < 0 || rx_res < 0 || rate == 0U)
+    {
+        fprintf(stderr, "can't open %s: %d\n", bus, (int)((tx_res < 0) ? tx_res : rx_res));
+        return 1;
+    }
+
+    CanardInstance canard;
+    canardInit(&canard, arena, sizeof(arena), onTransferReceived, shouldAccept, NULL);
+
+    // receiving on the application thread
+    {
+        num_transfers = 0;
+        std::atomic<bool> done(false);
+        const auto started = std::chrono::steady_clock::now();
+        auto next_stall = started + std::chrono::milliseconds(STALL_PERIOD_MSEC);
+        std::thread sender(sendFrames, &tx, num_frames, rate, &done);
+        CanardCANFrame frame;
+        while (!done.load())
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (LinuxCANReceive(&rx, &frame, 10) > 0)
+            {
+                (void)canardHandleRxFrame(&canard, &frame,
+                    (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count());
+            }
+            maybeStall(&next_stall, stall_msec);
+        }
+        sender.join();
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        report("direct", num_frames, sec, 0);
+    }
+
+    canardReset(&canard, CANARD_RESET_RX_STATES);
+
+    // receiving on a thread, handling the ring on the application thread
+    {
+        num_transfers = 0;
+        LinuxCANRxThread* rx_thread = NULL;
+        const int16_t res = LinuxCANRxThreadStart(&rx_thread, &rx, 0, rx_cpu);
+        if (res < 0)
+        {
+            fprintf(stderr, "can't start the receive thread: %d\n", (int)res);
+            return 1;
+        }
+        std::atomic<bool> done(false);
+        const auto started = std::chrono::steady_clock::now();
+        auto next_stall = started + std::chrono::milliseconds(STALL_PERIOD_MSEC);
+        std::thread sender(sendFrames, &tx, num_frames, rate, &done);
+        while (!done.load())
+        {
+            if (LinuxCANRxThreadWait(rx_thread, 10) > 0)
+            {
+                (void)LinuxCANRxThreadProcess(rx_thread, &canard, 64);
+            }
+            maybeStall(&next_stall, stall_msec);
+        }
+        sender.join();
+        (void)LinuxCANRxThreadProcess(rx_thread, &canard, UINT16_MAX);
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        LinuxCANRxThreadStatistics stats;
+        LinuxCANRxThreadGetStatistics(rx_thread, &stats);
+        (void)LinuxCANRxThreadStop(rx_thread);
+        report("thread", num_frames, sec, stats.overruns);
+    }
+
+    (void)LinuxCANClose(&tx);
+    (void)LinuxCANClose(&rx);
+    return 0;
+}
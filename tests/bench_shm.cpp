@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+/*
+ * Moves frames between two instances of the shared memory driver, with the single frame calls and with the batch
+ * calls, and reports the throughput and CPU time per frame of each. Then measures the one way latency of a frame
+ * between two threads, each waiting in shmcanReceive().
+ * usage: Canard_bench_shm [bus] [frames]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "bench_common.h"
+#include "shm.h"
+
+static SHMCANInstance tx_ins;
+static SHMCANInstance rx_ins;
+
+struct ShmBus
+{
+    static int16_t transmit(const CanardCANFrame* frame, int32_t timeout_msec)
+    {
+        return shmcanTransmit(&tx_ins, frame, timeout_msec);
+    }
+    static int16_t receive(CanardCANFrame* out_frame, int32_t timeout_msec)
+    {
+        return shmcanReceive(&rx_ins, out_frame, timeout_msec);
+    }
+    static int16_t transmitBatch(const CanardCANFrame* frames, uint16_t num_frames, int32_t timeout_msec)
+    {
+        return shmcanTransmitBatch(&tx_ins, frames, num_frames, timeout_msec);
+    }
+    static int16_t receiveBatch(CanardCANFrame* out_frames, uint16_t max_frames, int32_t timeout_msec)
+    {
+        return shmcanReceiveBatch(&rx_ins, out_frames, max_frames, timeout_msec);
+    }
+};
+
+// A second thread echoes every frame back, half the round trip is the one way latency including the wakeup
+static void measureLatency(unsigned num_round_trips)
+{
+    std::atomic<bool> stop(false);
+    std::thread echo([&stop]() {
+        CanardCANFrame frame;
+        while (!stop.load())
+        {
+            if (shmcanReceive(&rx_ins, &frame, 10) > 0)
+            {
+                (void)shmcanTransmit(&rx_ins, &frame, 0);
+            }
+        }
+    });
+
+    std::vector<double> usec;
+    usec.reserve(num_round_trips);
+    CanardCANFrame frame;
+    for (unsigned i = 0; i < num_round_trips; i++)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        (void)shmcanTransmit(&tx_ins, &tx_frames[0], 0);
+        if (shmcanReceive(&tx_ins, &frame, 1000) <= 0)
+        {
+            break;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        usec.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * 1e-3 / 2.0);
+    }
+    stop.store(true);
+    echo.join();
+
+    if (usec.empty())
+    {
+        printf("latency  no echo\n");
+        return;
+    }
+    std::sort(usec.begin(), usec.end());
+    printf("latency  round_trips=%u one_way median=%.1f us p99=%.1f us\n",
+           (unsigned)usec.size(), usec[usec.size() / 2U], usec[usec.size() * 99U / 100U]);
+}
+
+int main(int argc, char** argv)
+{
+    const char* bus = (argc > 1) ? argv[1] : "shm:0";
+    const unsigned num_frames = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 10) : 1000000U;
+
+#if CANARD_ENABLE_CANFD
+    const int16_t tx_res = shmcanInit(&tx_ins, bus, false);
+    const int16_t rx_res = shmcanInit(&rx_ins, bus, false);
+#else
+    const int16_t tx_res = shmcanInit(&tx_ins, bus);
+    const int16_t rx_res = shmcanInit(&rx_ins, bus);
+#endif
+    if (tx_res < 0 || rx_res < 0)
+    {
+        fprintf(stderr, "can't open %s: %d\n", bus, (int)((tx_res < 0) ? tx_res : rx_res));
+        return 1;
+    }
+
+    initFrames();
+    report("single", moveFramesOneByOne<ShmBus>, num_frames);
+    report("batch", moveFramesInBatches<ShmBus>, num_frames);
+    measureLatency(10000U);
+
+    (void)shmcanClose(&tx_ins);
+    (void)shmcanClose(&rx_ins);
+    (void)shmcanUnlink(bus);
+    return 0;
+}
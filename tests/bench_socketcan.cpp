@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+/*
+ * Moves frames between two sockets on a virtual CAN interface, with the single frame calls, with the batch calls and
+ * with the io_uring backend, and reports the throughput and CPU time per frame of each.
+ * Needs a vcan interface, see examples/setup_socketcan.sh.
+ * usage: Canard_bench_socketcan [interface] [frames]
+ */
+
+#include <cstdlib>
+#include "bench_common.h"
+#include "socketcan.h"
+#include "socketcan_uring.h"
+
+static SocketCANInstance tx_ins;
+static SocketCANInstance rx_ins;
+static SocketCANUringInstance uring_tx_ins;
+static SocketCANUringInstance uring_rx_ins;
+
+struct SocketCANBus
+{
+    static int16_t transmit(const CanardCANFrame* frame, int32_t timeout_msec)
+    {
+        return socketcanTransmit(&tx_ins, frame, timeout_msec);
+    }
+    static int16_t receive(CanardCANFrame* out_frame, int32_t timeout_msec)
+    {
+        return socketcanReceive(&rx_ins, out_frame, timeout_msec);
+    }
+    static int16_t transmitBatch(const CanardCANFrame* frames, uint16_t num_frames, int32_t timeout_msec)
+    {
+        return socketcanTransmitBatch(&tx_ins, frames, num_frames, timeout_msec);
+    }
+    static int16_t receiveBatch(CanardCANFrame* out_frames, uint16_t max_frames, int32_t timeout_msec)
+    {
+        return socketcanReceiveBatch(&rx_ins, out_frames, NULL, max_frames, timeout_msec);
+    }
+};
+
+struct UringBus
+{
+    static int16_t transmit(const CanardCANFrame* frame, int32_t timeout_msec)
+    {
+        return socketcanUringTransmit(&uring_tx_ins, frame, timeout_msec);
+    }
+    static int16_t receive(CanardCANFrame* out_frame, int32_t timeout_msec)
+    {
+        return socketcanUringReceive(&uring_rx_ins, out_frame, timeout_msec);
+    }
+    static int16_t transmitBatch(const CanardCANFrame* frames, uint16_t num_frames, int32_t timeout_msec)
+    {
+        return socketcanUringTransmitBatch(&uring_tx_ins, frames, num_frames, timeout_msec);
+    }
+    static int16_t receiveBatch(CanardCANFrame* out_frames, uint16_t max_frames, int32_t timeout_msec)
+    {
+        return socketcanUringReceiveBatch(&uring_rx_ins, out_frames, max_frames, timeout_msec);
+    }
+};
+
+int main(int argc, char** argv)
+{
+    const char* iface = (argc > 1) ? argv[1] : "vcan0";
+    const unsigned num_frames = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 10) : 200000U;
+
+#if CANARD_ENABLE_CANFD
+    const int16_t tx_res = socketcanInit(&tx_ins, iface, false);
+    const int16_t rx_res = socketcanInit(&rx_ins, iface, false);
+#else
+    const int16_t tx_res = socketcanInit(&tx_ins, iface);
+    const int16_t rx_res = socketcanInit(&rx_ins, iface);
+#endif
+    if (tx_res < 0 || rx_res < 0)
+    {
+        fprintf(stderr, "can't open %s: %d\n", iface, (int)((tx_res < 0) ? tx_res : rx_res));
+        return 1;
+    }
+
+    initFrames();
+    report("single", moveFramesOneByOne<SocketCANBus>, num_frames);
+    report("batch", moveFramesInBatches<SocketCANBus>, num_frames);
+    (void)socketcanClose(&tx_ins);
+    (void)socketcanClose(&rx_ins);
+
+#if CANARD_ENABLE_CANFD
+    const int16_t uring_tx_res = socketcanUringInit(&uring_tx_ins, iface, false);
+    const int16_t uring_rx_res = socketcanUringInit(&uring_rx_ins, iface, false);
+#else
+    const int16_t uring_tx_res = socketcanUringInit(&uring_tx_ins, iface);
+    const int16_t uring_rx_res = socketcanUringInit(&uring_rx_ins, iface);
+#endif
+    if (uring_tx_res < 0 || uring_rx_res < 0)
+    {
+        fprintf(stderr, "can't open %s: %d\n", iface, (int)((uring_tx_res < 0) ? uring_tx_res : uring_rx_res));
+        return 1;
+    }
+    if (!socketcanUringIsActive(&uring_tx_ins) || !socketcanUringIsActive(&uring_rx_ins))
+    {
+        printf("io_uring is not available, the io_uring figures are for the poll fallback\n");
+    }
+    report("io_uring", moveFramesInBatches<UringBus>, num_frames);
+    (void)socketcanUringClose(&uring_tx_ins);
+    (void)socketcanUringClose(&uring_rx_ins);
+    return 0;
+}
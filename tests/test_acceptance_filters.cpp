@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+#include <gtest/gtest.h>
+#include "canard_internals.h"
+
+static uint32_t messageId(uint16_t dtid, uint8_t source_node_id)
+{
+    return CANARD_CAN_FRAME_EFF | (16UL << 24U) | ((uint32_t)dtid << 8U) | source_node_id;
+}
+
+static uint32_t anonymousMessageId(uint16_t dtid, uint16_t discriminator)
+{
+    return CANARD_CAN_FRAME_EFF | (16UL << 24U) | ((uint32_t)discriminator << 10U) | ((uint32_t)dtid << 8U);
+}
+
+static uint32_t serviceId(uint8_t dtid, bool request, uint8_t destination_node_id, uint8_t source_node_id)
+{
+    return CANARD_CAN_FRAME_EFF | (16UL << 24U) | ((uint32_t)dtid << 16U) | ((request ? 1UL : 0UL) << 15U) |
+           ((uint32_t)destination_node_id << 8U) | (1U << 7U) | source_node_id;
+}
+
+static bool passes(const CanardAcceptanceFilter* filters, int16_t num_filters, uint32_t id)
+{
+    for (int16_t i = 0; i < num_filters; i++)
+    {
+        if ((id & filters[i].mask) == (filters[i].id & filters[i].mask))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST(AcceptanceFilters, Exact)
+{
+    const CanardAcceptedTransfer accepted[] = {
+        { 341, CanardTransferTypeBroadcast },
+        { 1, CanardTransferTypeBroadcast },
+        { 1, CanardTransferTypeRequest },
+        { 1, CanardTransferTypeResponse },
+    };
+    CanardAcceptanceFilter filters[16];
+    const int16_t num = canardMakeAcceptanceFilters(accepted, 4, 42, filters, 16);
+
+    // Message 341, message 1 and its anonymous form, and one filter for both directions of service 1
+    ASSERT_EQ(4, num);
+
+    EXPECT_TRUE(passes(filters, num, messageId(341, 10)));
+    EXPECT_TRUE(passes(filters, num, messageId(341, 127)));
+    EXPECT_TRUE(passes(filters, num, messageId(1, 10)));
+    EXPECT_TRUE(passes(filters, num, anonymousMessageId(1, 0x3FFF)));
+    EXPECT_TRUE(passes(filters, num, anonymousMessageId(1, 0)));
+    EXPECT_TRUE(passes(filters, num, serviceId(1, true, 42, 10)));
+    EXPECT_TRUE(passes(filters, num, serviceId(1, false, 42, 10)));
+
+    EXPECT_FALSE(passes(filters, num, messageId(342, 10)));
+    EXPECT_FALSE(passes(filters, num, messageId(0x4001, 10)));
+    EXPECT_FALSE(passes(filters, num, anonymousMessageId(2, 5)));
+    EXPECT_FALSE(passes(filters, num, serviceId(1, true, 43, 10)));
+    EXPECT_FALSE(passes(filters, num, serviceId(2, true, 42, 10)));
+    EXPECT_FALSE(passes(filters, num, messageId(341, 10) & ~(uint32_t)CANARD_CAN_FRAME_EFF));
+    EXPECT_FALSE(passes(filters, num, (uint32_t)(messageId(341, 10) | CANARD_CAN_FRAME_RTR)));
+}
+
+TEST(AcceptanceFilters, CombinesNeighbours)
+{
+    // Data type IDs 1000 to 1007 differ only in their lowest three bits
+    CanardAcceptedTransfer accepted[8];
+    for (uint16_t i = 0; i < 8; i++)
+    {
+        accepted[i].data_type_id = (uint16_t)(1000U + i);
+        accepted[i].transfer_type = CanardTransferTypeBroadcast;
+    }
+    CanardAcceptanceFilter filters[8];
+    const int16_t num = canardMakeAcceptanceFilters(accepted, 8, 42, filters, 8);
+    ASSERT_EQ(1, num);
+    for (uint16_t dtid = 1000; dtid < 1008; dtid++)
+    {
+        EXPECT_TRUE(passes(filters, num, messageId(dtid, 10)));
+    }
+    EXPECT_FALSE(passes(filters, num, messageId(999, 10)));
+    EXPECT_FALSE(passes(filters, num, messageId(1008, 10)));
+}
+
+TEST(AcceptanceFilters, WidensWhenFull)
+{
+    static const uint16_t dtids[] = { 341, 1030, 1034, 1063, 1110, 1111, 20000, 20007, 4, 155, 260, 1001 };
+    const uint16_t count = sizeof(dtids) / sizeof(dtids[0]);
+    CanardAcceptedTransfer accepted[count + 2];
+    for (uint16_t i = 0; i < count; i++)
+    {
+        accepted[i].data_type_id = dtids[i];
+        accepted[i].transfer_type = CanardTransferTypeBroadcast;
+    }
+    accepted[count] = { 11, CanardTransferTypeRequest };
+    accepted[count + 1] = { 48, CanardTransferTypeResponse };
+
+    for (uint16_t max_filters = 1; max_filters <= 8; max_filters++)
+    {
+        CanardAcceptanceFilter filters[8];
+        const int16_t num = canardMakeAcceptanceFilters(accepted, count + 2, 100, filters, max_filters);
+        ASSERT_GT(num, 0);
+        ASSERT_LE(num, (int16_t)max_filters);
+        for (uint16_t i = 0; i < count; i++)
+        {
+            EXPECT_TRUE(passes(filters, num, messageId(dtids[i], 10)));
+        }
+        EXPECT_TRUE(passes(filters, num, serviceId(11, true, 100, 10)));
+        EXPECT_TRUE(passes(filters, num, serviceId(48, false, 100, 10)));
+        // Standard frames are never of interest
+        EXPECT_FALSE(passes(filters, num, 0x123U));
+    }
+}
+
+TEST(AcceptanceFilters, Anonymous)
+{
+    const CanardAcceptedTransfer accepted[] = {
+        { 341, CanardTransferTypeBroadcast },
+        { 1, CanardTransferTypeRequest },
+    };
+    CanardAcceptanceFilter filters[4];
+
+    // Without a node ID, nobody can address a service to us
+    const int16_t num = canardMakeAcceptanceFilters(accepted, 2, CANARD_BROADCAST_NODE_ID, filters, 4);
+    ASSERT_EQ(1, num);
+    EXPECT_FALSE(passes(filters, num, serviceId(1, true, 0, 10)));
+
+    EXPECT_EQ(0, canardMakeAcceptanceFilters(&accepted[1], 1, CANARD_BROADCAST_NODE_ID, filters, 0));
+    EXPECT_EQ(-CANARD_ERROR_INVALID_ARGUMENT, canardMakeAcceptanceFilters(accepted, 2, 42, filters, 0));
+    EXPECT_EQ(0, canardMakeAcceptanceFilters(NULL, 0, 42, filters, 4));
+}
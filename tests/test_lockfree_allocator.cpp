@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "canard_internals.h"
+
+
+#define AVAILABLE_BLOCKS 8
+#define NUM_THREADS 4
+#define ITERATIONS 100000
+
+static uint16_t countFreeBlocks(const CanardPoolAllocator& allocator)
+{
+    const CanardPoolAllocatorBlock* blocks = static_cast<const CanardPoolAllocatorBlock*>(allocator.arena);
+    uint16_t count = 0;
+    uint32_t index = allocator.free_head & 0xFFFFU;
+    while (index != 0)
+    {
+        count++;
+        if (count > allocator.statistics.capacity_blocks)
+        {
+            break;  // cycle in the free list
+        }
+        index = blocks[index - 1].next_index;
+    }
+    return count;
+}
+
+
+TEST(LockFreeAllocatorTestGroup, SingleThreadedBehaviour)
+{
+    CanardPoolAllocator allocator;
+    CanardPoolAllocatorBlock buffer[3];
+    initPoolAllocator(&allocator, buffer, 3);
+    ASSERT_EQ(3, countFreeBlocks(allocator));
+
+    void* a = allocateBlock(&allocator, CanardPoolConsumerTx);
+    void* b = allocateBlock(&allocator, CanardPoolConsumerTx);
+    void* c = allocateBlock(&allocator, CanardPoolConsumerTx);
+    ASSERT_EQ(&buffer[0], a);
+    ASSERT_EQ(&buffer[1], b);
+    ASSERT_EQ(&buffer[2], c);
+    ASSERT_EQ(NULL, allocateBlock(&allocator, CanardPoolConsumerTx));
+    ASSERT_EQ(1U, allocator.consumers[CanardPoolConsumerTx].denied_allocations);
+    ASSERT_EQ(3, allocator.statistics.current_usage_blocks);
+    ASSERT_EQ(3, allocator.statistics.peak_usage_blocks);
+
+    freeBlock(&allocator, CanardPoolConsumerTx, b);
+    ASSERT_EQ(&buffer[1], allocateBlock(&allocator, CanardPoolConsumerTx));
+    freeBlock(&allocator, CanardPoolConsumerTx, a);
+    freeBlock(&allocator, CanardPoolConsumerTx, b);
+    freeBlock(&allocator, CanardPoolConsumerTx, c);
+    ASSERT_EQ(0, allocator.statistics.current_usage_blocks);
+    ASSERT_EQ(3, countFreeBlocks(allocator));
+}
+
+TEST(LockFreeAllocatorTestGroup, QuotaIsEnforced)
+{
+    CanardPoolAllocator allocator;
+    CanardPoolAllocatorBlock buffer[4];
+    initPoolAllocator(&allocator, buffer, 4);
+    allocator.consumers[CanardPoolConsumerTx].reserved_blocks = 2;
+    allocator.consumers[CanardPoolConsumerRxPayload].max_blocks = 3;
+
+    ASSERT_NE(nullptr, allocateBlock(&allocator, CanardPoolConsumerRxPayload));
+    ASSERT_NE(nullptr, allocateBlock(&allocator, CanardPoolConsumerRxPayload));
+    // The remaining two blocks are reserved for TX
+    ASSERT_EQ(nullptr, allocateBlock(&allocator, CanardPoolConsumerRxPayload));
+    ASSERT_EQ(nullptr, allocateBlock(&allocator, CanardPoolConsumerRxState));
+    ASSERT_NE(nullptr, allocateBlock(&allocator, CanardPoolConsumerTx));
+    ASSERT_NE(nullptr, allocateBlock(&allocator, CanardPoolConsumerTx));
+    ASSERT_EQ(4, allocator.statistics.current_usage_blocks);
+    ASSERT_EQ(2, allocator.consumers[CanardPoolConsumerRxPayload].current_usage_blocks);
+}
+
+TEST(LockFreeAllocatorTestGroup, ConcurrentAllocateAndFree)
+{
+    CanardPoolAllocator allocator;
+    CanardPoolAllocatorBlock buffer[AVAILABLE_BLOCKS];
+    initPoolAllocator(&allocator, buffer, AVAILABLE_BLOCKS);
+
+    std::atomic<bool> corrupted(false);
+    std::vector<std::thread> threads;
+    for (uint8_t t = 0; t < NUM_THREADS; t++)
+    {
+        threads.emplace_back([&allocator, &corrupted, t]() {
+            const CanardPoolConsumer consumer = static_cast<CanardPoolConsumer>(t % CANARD_POOL_NUM_CONSUMERS);
+            CanardPoolAllocatorBlock* held[3] = {};
+            for (uint32_t i = 0; i < ITERATIONS; i++)
+            {
+                CanardPoolAllocatorBlock*& slot = held[i % 3];
+                if (slot != nullptr)
+                {
+                    // A block handed out twice would have been overwritten by another thread
+                    for (uint8_t k = 0; k < sizeof(slot->bytes); k++)
+                    {
+                        if (static_cast<uint8_t>(slot->bytes[k]) != static_cast<uint8_t>(t + 1U))
+                        {
+                            corrupted = true;
+                        }
+                    }
+                    freeBlock(&allocator, consumer, slot);
+                    slot = nullptr;
+                }
+                else
+                {
+                    slot = static_cast<CanardPoolAllocatorBlock*>(allocateBlock(&allocator, consumer));
+                    if (slot != nullptr)
+                    {
+                        memset(slot->bytes, t + 1, sizeof(slot->bytes));
+                    }
+                }
+            }
+            for (CanardPoolAllocatorBlock* block : held)
+            {
+                if (block != nullptr)
+                {
+                    freeBlock(&allocator, consumer, block);
+                }
+            }
+        });
+    }
+    for (std::thread& th : threads)
+    {
+        th.join();
+    }
+
+    ASSERT_FALSE(corrupted);
+    ASSERT_EQ(0, allocator.statistics.current_usage_blocks);
+    for (uint8_t i = 0; i < CANARD_POOL_NUM_CONSUMERS; i++)
+    {
+        ASSERT_EQ(0, allocator.consumers[i].current_usage_blocks);
+    }
+    ASSERT_LE(allocator.statistics.peak_usage_blocks, AVAILABLE_BLOCKS);
+    ASSERT_EQ(AVAILABLE_BLOCKS, countFreeBlocks(allocator));
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "mcast.h"
+
+// A sender and a receiver on a bus of their own; every test uses its own bus, ctest runs them in parallel.
+// Multicast loopback delivers the datagrams of the sender to the receiver on the same host.
+class McastTestGroup : public ::testing::Test
+{
+protected:
+    void open(const char* bus)
+    {
+        name = bus;
+        tx = static_cast<MCASTCANInstance*>(calloc(1, sizeof(MCASTCANInstance)));
+        rx = static_cast<MCASTCANInstance*>(calloc(1, sizeof(MCASTCANInstance)));
+        ASSERT_NE(nullptr, tx);
+        ASSERT_NE(nullptr, rx);
+#if CANARD_ENABLE_CANFD
+        ASSERT_EQ(0, mcastInit(tx, name, false));
+        ASSERT_EQ(0, mcastInit(rx, name, false));
+#else
+        ASSERT_EQ(0, mcastInit(tx, name));
+        ASSERT_EQ(0, mcastInit(rx, name));
+#endif
+    }
+
+    void TearDown() override
+    {
+        if (tx != nullptr)
+        {
+            (void)mcastClose(tx);
+            free(tx);
+        }
+        if (rx != nullptr)
+        {
+            (void)mcastClose(rx);
+            free(rx);
+        }
+    }
+
+    // Sends a datagram the way another node would, to the group of the bus
+    void sendRaw(const std::vector<uint8_t>& datagram)
+    {
+        const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(fd, 0);
+        char address[] = "239.65.82.0";
+        address[strlen(address) - 1] = name[strlen(name) - 1];
+        struct sockaddr_in sockaddr;
+        memset(&sockaddr, 0, sizeof(sockaddr));
+        sockaddr.sin_family = AF_INET;
+        sockaddr.sin_port = htons(57732U);
+        sockaddr.sin_addr.s_addr = inet_addr(address);
+        const ssize_t res = sendto(fd, datagram.data(), datagram.size(), 0,
+                                   reinterpret_cast<struct sockaddr*>(&sockaddr), sizeof(sockaddr));
+        (void)close(fd);
+        ASSERT_EQ((ssize_t)datagram.size(), res);
+    }
+
+    // Reads frames until num_frames have arrived or nothing comes for a while
+    unsigned receive(CanardCANFrame* out_frames, unsigned num_frames)
+    {
+        unsigned received = 0;
+        while (received < num_frames)
+        {
+            const int16_t res = mcastReceiveBatch(rx, &out_frames[received], (uint16_t)(num_frames - received), 100);
+            if (res <= 0)
+            {
+                break;
+            }
+            received += (unsigned)res;
+        }
+        return received;
+    }
+
+    const char* name = nullptr;
+    MCASTCANInstance* tx = nullptr;
+    MCASTCANInstance* rx = nullptr;
+};
+
+static CanardCANFrame makeFrame(uint32_t id, uint32_t number, uint8_t data_len = 4)
+{
+    CanardCANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.id = id;
+    frame.data_len = data_len;
+    memcpy(frame.data, &number, sizeof(number));
+    return frame;
+}
+
+static uint32_t frameNumber(const CanardCANFrame& frame)
+{
+    uint32_t number = 0;
+    memcpy(&number, frame.data, sizeof(number));
+    return number;
+}
+
+static void append(std::vector<uint8_t>* datagram, const void* data, size_t len)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    datagram->insert(datagram->end(), bytes, bytes + len);
+}
+
+// Builds a packed datagram: magic, crc, flags and num_frames, then a message id, flags and length per record.
+// The crc is CRC-16/CCITT over everything after the crc field, so it is valid whatever the header claims.
+static std::vector<uint8_t> packDatagram(uint16_t num_frames, const std::vector<CanardCANFrame>& frames,
+                                         const std::vector<uint8_t>& data_lens)
+{
+    std::vector<uint8_t> datagram;
+    const uint16_t header[] = { 0x2935U, 0U, 0U, num_frames };
+    append(&datagram, header, sizeof(header));
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        const uint8_t flags = 0;
+        append(&datagram, &frames[i].id, sizeof(frames[i].id));
+        append(&datagram, &flags, sizeof(flags));
+        append(&datagram, &data_lens[i], sizeof(data_lens[i]));
+        // the data is taken from a padded copy, a record may claim more than a frame holds
+        uint8_t data[256] = {};
+        memcpy(data, frames[i].data, sizeof(frames[i].data));
+        append(&datagram, data, frames[i].data_len);
+    }
+    uint16_t crc = 0xFFFFU;
+    for (size_t i = 4; i < datagram.size(); i++)
+    {
+        crc = (uint16_t)(crc ^ (uint16_t)(datagram[i] << 8U));
+        for (unsigned bit = 0; bit < 8U; bit++)
+        {
+            crc = ((crc & 0x8000U) != 0U) ? (uint16_t)((uint16_t)(crc << 1U) ^ 0x1021U) : (uint16_t)(crc << 1U);
+        }
+    }
+    memcpy(&datagram[2], &crc, sizeof(crc));
+    return datagram;
+}
+
+TEST_F(McastTestGroup, PackedDatagramIsReadAcrossCalls)
+{
+    open("mcast:4");
+    mcastEnableBatching(tx, true);
+    CanardCANFrame sent[10];
+    for (unsigned i = 0; i < 10U; i++)
+    {
+        sent[i] = makeFrame(CANARD_CAN_FRAME_EFF | (0x1000U + i), i, (uint8_t)(4U + i % 5U));
+    }
+    ASSERT_EQ(10, mcastTransmitBatch(tx, sent, 10, 100));
+
+    // the whole batch is one datagram, the frames that don't fit come from the buffer without another read
+    CanardCANFrame frames[3];
+    ASSERT_EQ(3, mcastReceiveBatch(rx, frames, 3, 100));
+    unsigned received = 3;
+    for (unsigned i = 0; i < 3U; i++)
+    {
+        ASSERT_EQ(sent[i].id, frames[i].id);
+    }
+    const int16_t expected[] = { 3, 3, 1 };
+    for (int16_t num : expected)
+    {
+        ASSERT_EQ(num, mcastReceiveBatch(rx, frames, 3, 0));
+        for (int16_t i = 0; i < num; i++)
+        {
+            const CanardCANFrame& frame = frames[i];
+            ASSERT_EQ(sent[received].id, frame.id);
+            ASSERT_EQ(sent[received].data_len, frame.data_len);
+            ASSERT_EQ(0, memcmp(sent[received].data, frame.data, frame.data_len));
+            received++;
+        }
+    }
+    ASSERT_EQ(0, mcastReceiveBatch(rx, frames, 3, 0));
+
+    // a single frame read in between keeps its place too
+    ASSERT_EQ(10, mcastTransmitBatch(tx, sent, 10, 100));
+    ASSERT_EQ(3, mcastReceiveBatch(rx, frames, 3, 100));
+    ASSERT_EQ(1, mcastReceive(rx, &frames[0], 0));
+    ASSERT_EQ(sent[3].id, frames[0].id);
+    ASSERT_EQ(6U, receive(frames, 3) + receive(frames, 3));
+    ASSERT_EQ(sent[9].id, frames[2].id);
+}
+
+TEST_F(McastTestGroup, SingleAndPackedDatagramsMix)
+{
+    open("mcast:5");
+    CanardCANFrame sent[12];
+    for (unsigned i = 0; i < 12U; i++)
+    {
+        sent[i] = makeFrame(CANARD_CAN_FRAME_EFF | 0x2000U, i);
+    }
+    // a node with an older driver sends a datagram per frame, this one packs its batches
+    ASSERT_EQ(3, mcastTransmitBatch(tx, &sent[0], 3, 100));
+    mcastEnableBatching(tx, true);
+    ASSERT_EQ(5, mcastTransmitBatch(tx, &sent[3], 5, 100));
+    mcastEnableBatching(tx, false);
+    ASSERT_EQ(1, mcastTransmit(tx, &sent[8], 100));
+    mcastEnableBatching(tx, true);
+    ASSERT_EQ(3, mcastTransmitBatch(tx, &sent[9], 3, 100));
+
+    CanardCANFrame frames[12];
+    ASSERT_EQ(12U, receive(frames, 12));
+    for (unsigned i = 0; i < 12U; i++)
+    {
+        ASSERT_EQ(i, frameNumber(frames[i]));
+        ASSERT_EQ(sent[i].id, frames[i].id);
+    }
+    ASSERT_EQ(0, mcastReceiveBatch(rx, frames, 12, 0));
+}
+
+TEST_F(McastTestGroup, CorruptedDatagramsAreSkipped)
+{
+    open("mcast:6");
+    const std::vector<CanardCANFrame> records = {
+        makeFrame(CANARD_CAN_FRAME_EFF | 0x3000U, 100),
+        makeFrame(CANARD_CAN_FRAME_EFF | 0x3001U, 101, 8),
+    };
+    CanardCANFrame frames[4];
+
+    // a well formed datagram built here reads back, so the corrupted ones below only fail on what they corrupt
+    sendRaw(packDatagram(2, records, { 4, 8 }));
+    ASSERT_EQ(2U, receive(frames, 4));
+    ASSERT_EQ(100U, frameNumber(frames[0]));
+    ASSERT_EQ(records[1].id, frames[1].id);
+    ASSERT_EQ(8, frames[1].data_len);
+
+    // a valid crc but records that don't add up to the length of the datagram
+    const std::vector<std::vector<uint8_t>> corrupted = {
+        packDatagram(3, records, { 4, 8 }),     // more frames than records
+        packDatagram(1, records, { 4, 8 }),     // fewer frames than records
+        packDatagram(0xFFFFU, records, { 4, 8 }),
+        packDatagram(2, records, { 4, 200 }),   // a record longer than the datagram
+        packDatagram(2, records, { 6, 8 }),     // a record that runs into the next one
+        packDatagram(2, records, { 4, 6 }),     // a record shorter than its data
+    };
+    for (const std::vector<uint8_t>& datagram : corrupted)
+    {
+        sendRaw(datagram);
+        ASSERT_EQ(-EIO, mcastReceiveBatch(rx, frames, 4, 100));
+        ASSERT_EQ(0, mcastReceiveBatch(rx, frames, 4, 0));
+    }
+
+    // a broken crc, and a record too long for a frame in a datagram that is otherwise consistent
+    std::vector<uint8_t> bad_crc = packDatagram(2, records, { 4, 8 });
+    bad_crc.back() = (uint8_t)(bad_crc.back() ^ 1U);
+    sendRaw(bad_crc);
+    ASSERT_EQ(-EIO, mcastReceiveBatch(rx, frames, 4, 100));
+    CanardCANFrame too_long = makeFrame(CANARD_CAN_FRAME_EFF | 0x3002U, 102, 8);
+    too_long.data_len = 9;
+    sendRaw(packDatagram(2, { records[0], too_long }, { 4, 9 }));
+    ASSERT_EQ(1U, receive(frames, 4));
+    ASSERT_EQ(100U, frameNumber(frames[0]));
+
+    // frames around a corrupted datagram still come through, in order
+    ASSERT_EQ(1, mcastTransmit(tx, &records[0], 100));
+    sendRaw(corrupted[0]);
+    ASSERT_EQ(1, mcastTransmit(tx, &records[1], 100));
+    ASSERT_EQ(2U, receive(frames, 4));
+    ASSERT_EQ(100U, frameNumber(frames[0]));
+    ASSERT_EQ(101U, frameNumber(frames[1]));
+    ASSERT_EQ(0, mcastReceiveBatch(rx, frames, 4, 0));
+}
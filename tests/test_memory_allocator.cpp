@@ -53,7 +53,7 @@ TEST(MemoryAllocatorTestGroup, CanAllocateBlock)
     CanardPoolAllocatorBlock buffer[AVAILABLE_BLOCKS];
     initPoolAllocator(&allocator, buffer, AVAILABLE_BLOCKS);
 
-    void* block = allocateBlock(&allocator);
+    void* block = allocateBlock(&allocator, CanardPoolConsumerTx);
 
     // Check that the first free memory block was used and that the next block is ready.
     ASSERT_TRUE(&buffer[0] == block);
@@ -74,11 +74,11 @@ TEST(MemoryAllocatorTestGroup, ReturnsNullIfThereIsNoBlockLeft)
     // First exhaust all availables block
     for (int i = 0; i < AVAILABLE_BLOCKS; ++i)
     {
-        allocateBlock(&allocator);
+        allocateBlock(&allocator, CanardPoolConsumerTx);
     }
 
     // Try to allocate one extra block
-    void* block = allocateBlock(&allocator);
+    void* block = allocateBlock(&allocator, CanardPoolConsumerTx);
     ASSERT_TRUE(NULL == block);
 
     // Check statistics
@@ -93,9 +93,9 @@ TEST(MemoryAllocatorTestGroup, CanFreeBlock)
     CanardPoolAllocatorBlock buffer[AVAILABLE_BLOCKS];
     initPoolAllocator(&allocator, buffer, AVAILABLE_BLOCKS);
 
-    void* block = allocateBlock(&allocator);
+    void* block = allocateBlock(&allocator, CanardPoolConsumerTx);
 
-    freeBlock(&allocator, block);
+    freeBlock(&allocator, CanardPoolConsumerTx, block);
 
     // Check that the block was added back to the beginning
     ASSERT_TRUE(&buffer[0] == allocator.free_list);
@@ -106,3 +106,275 @@ TEST(MemoryAllocatorTestGroup, CanFreeBlock)
     ASSERT_TRUE(0 ==                allocator.statistics.current_usage_blocks);
     ASSERT_TRUE(1 ==                allocator.statistics.peak_usage_blocks);
 }
+
+TEST(MemoryAllocatorTestGroup, QuotaLimitsConsumer)
+{
+    CanardPoolAllocator allocator;
+    CanardPoolAllocatorBlock buffer[AVAILABLE_BLOCKS];
+    initPoolAllocator(&allocator, buffer, AVAILABLE_BLOCKS);
+
+    allocator.consumers[CanardPoolConsumerRxPayload].max_blocks = 1;
+
+    void* block = allocateBlock(&allocator, CanardPoolConsumerRxPayload);
+    ASSERT_TRUE(NULL != block);
+    ASSERT_TRUE(NULL == allocateBlock(&allocator, CanardPoolConsumerRxPayload));
+
+    // Other consumers are not affected by the quota
+    ASSERT_TRUE(NULL != allocateBlock(&allocator, CanardPoolConsumerTx));
+
+    ASSERT_TRUE(1 == allocator.consumers[CanardPoolConsumerRxPayload].current_usage_blocks);
+    ASSERT_TRUE(1 == allocator.consumers[CanardPoolConsumerRxPayload].denied_allocations);
+    ASSERT_TRUE(1 == allocator.consumers[CanardPoolConsumerTx].current_usage_blocks);
+    ASSERT_TRUE(0 == allocator.consumers[CanardPoolConsumerTx].denied_allocations);
+
+    freeBlock(&allocator, CanardPoolConsumerRxPayload, block);
+    ASSERT_TRUE(0 == allocator.consumers[CanardPoolConsumerRxPayload].current_usage_blocks);
+    ASSERT_TRUE(1 == allocator.consumers[CanardPoolConsumerRxPayload].peak_usage_blocks);
+    ASSERT_TRUE(NULL != allocateBlock(&allocator, CanardPoolConsumerRxPayload));
+}
+
+TEST(MemoryAllocatorTestGroup, ReservationIsKeptForOwner)
+{
+    CanardPoolAllocator allocator;
+    CanardPoolAllocatorBlock buffer[AVAILABLE_BLOCKS];
+    initPoolAllocator(&allocator, buffer, AVAILABLE_BLOCKS);
+
+    allocator.consumers[CanardPoolConsumerTx].reserved_blocks = 2;
+
+    // RX may only take the unreserved block
+    ASSERT_TRUE(NULL != allocateBlock(&allocator, CanardPoolConsumerRxState));
+    ASSERT_TRUE(NULL == allocateBlock(&allocator, CanardPoolConsumerRxPayload));
+    ASSERT_TRUE(0 == availableBlocks(&allocator, CanardPoolConsumerRxPayload));
+    ASSERT_TRUE(2 == availableBlocks(&allocator, CanardPoolConsumerTx));
+
+    // The reserved blocks are still available to TX
+    ASSERT_TRUE(NULL != allocateBlock(&allocator, CanardPoolConsumerTx));
+    ASSERT_TRUE(NULL != allocateBlock(&allocator, CanardPoolConsumerTx));
+    ASSERT_TRUE(NULL == allocateBlock(&allocator, CanardPoolConsumerTx));
+
+    ASSERT_TRUE(1 == allocator.consumers[CanardPoolConsumerRxPayload].denied_allocations);
+    ASSERT_TRUE(1 == allocator.consumers[CanardPoolConsumerTx].denied_allocations);
+    ASSERT_TRUE(AVAILABLE_BLOCKS == allocator.statistics.current_usage_blocks);
+}
+
+static bool shouldAcceptAll(const CanardInstance*, uint64_t* out_data_type_signature, uint16_t,
+                            CanardTransferType, uint8_t)
+{
+    *out_data_type_signature = 0;
+    return true;
+}
+
+static void onTransferReceptionNop(CanardInstance*, CanardRxTransfer*)
+{
+}
+
+TEST(MemoryAllocatorTestGroup, RxFloodCannotStarveTx)
+{
+    static const uint16_t NUM_BLOCKS = 16;
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+
+    // Invalid configurations are rejected
+    ASSERT_EQ(-CANARD_ERROR_INVALID_ARGUMENT, canardSetPoolQuota(&ins, CanardPoolConsumerTx, 5, 4));
+    ASSERT_EQ(-CANARD_ERROR_INVALID_ARGUMENT, canardSetPoolQuota(&ins, CanardPoolConsumerTx, NUM_BLOCKS + 1,
+                                                                 NUM_BLOCKS + 1));
+    ASSERT_EQ(CANARD_OK, canardSetPoolQuota(&ins, CanardPoolConsumerTx, 4, NUM_BLOCKS));
+
+    // Start multi-frame transfers from many different sources, each takes an RX state and a payload block
+    CanardCANFrame frame {};
+    frame.data_len = 8;
+    for (uint8_t source = 1; source < 100; source++)
+    {
+        frame.id = CANARD_CAN_FRAME_EFF | (10U << 8U) | source;
+        frame.data[7] = 0x80;                   // start of transfer, toggle 0, TID 0
+        (void)canardHandleRxFrame(&ins, &frame, 1000);
+        frame.data[7] = 0x20;                   // middle frame, toggle 1, TID 0
+        (void)canardHandleRxFrame(&ins, &frame, 1000);
+    }
+
+    CanardPoolConsumerStatistics rx_states = canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxState);
+    CanardPoolConsumerStatistics rx_payload = canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxPayload);
+    ASSERT_EQ(NUM_BLOCKS - 4, rx_states.current_usage_blocks + rx_payload.current_usage_blocks);
+    ASSERT_GT(rx_states.denied_allocations + rx_payload.denied_allocations, 0U);
+
+    // TX still has its reserved headroom
+    uint8_t transfer_id = 0;
+    uint8_t payload[19] = {};           // 19 bytes + CRC take 3 frames
+    CanardTxTransfer transfer;
+    canardInitTxTransfer(&transfer);
+    transfer.transfer_type = CanardTransferTypeBroadcast;
+    transfer.data_type_id = 20;
+    transfer.inout_transfer_id = &transfer_id;
+    transfer.payload = payload;
+    transfer.payload_len = sizeof(payload);
+    ASSERT_EQ(3, canardBroadcastObj(&ins, &transfer));
+    ASSERT_EQ(3, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerTx).current_usage_blocks);
+    ASSERT_EQ(0U, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerTx).denied_allocations);
+
+    // Releasing the RX sessions gives the pool back
+    canardCleanupStaleTransfers(&ins, 1000 + 3000000);
+    ASSERT_EQ(0, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxState).current_usage_blocks);
+    ASSERT_EQ(0, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxPayload).current_usage_blocks);
+}
+
+static uint16_t low_watermark_calls;
+static uint16_t low_watermark_free_blocks;
+static uint16_t out_of_memory_calls;
+static CanardPoolConsumer out_of_memory_consumer;
+static uint16_t out_of_memory_data_type_id;
+
+static void onPoolLowWatermark(CanardInstance*, uint16_t free_blocks)
+{
+    low_watermark_calls++;
+    low_watermark_free_blocks = free_blocks;
+}
+
+static void onPoolOutOfMemory(CanardInstance*, CanardPoolConsumer consumer, uint16_t data_type_id,
+                              CanardTransferType)
+{
+    out_of_memory_calls++;
+    out_of_memory_consumer = consumer;
+    out_of_memory_data_type_id = data_type_id;
+}
+
+TEST(MemoryAllocatorTestGroup, LowWatermarkAndOutOfMemoryHooks)
+{
+    static const uint16_t NUM_BLOCKS = 8;
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+    canardSetPoolHooks(&ins, 2, onPoolLowWatermark, onPoolOutOfMemory);
+    low_watermark_calls = 0;
+    out_of_memory_calls = 0;
+
+    uint8_t transfer_id = 0;
+    uint8_t payload[4] = {};
+    CanardTxTransfer transfer;
+    canardInitTxTransfer(&transfer);
+    transfer.transfer_type = CanardTransferTypeBroadcast;
+    transfer.data_type_id = 20;
+    transfer.inout_transfer_id = &transfer_id;
+    transfer.payload = payload;
+    transfer.payload_len = sizeof(payload);
+
+    for (uint16_t i = 0; i < NUM_BLOCKS - 2; i++)
+    {
+        ASSERT_EQ(0, low_watermark_calls);
+        ASSERT_EQ(1, canardBroadcastObj(&ins, &transfer));
+    }
+    ASSERT_EQ(1, low_watermark_calls);
+    ASSERT_EQ(2, low_watermark_free_blocks);
+
+    // The hook fires only once per crossing
+    ASSERT_EQ(1, canardBroadcastObj(&ins, &transfer));
+    ASSERT_EQ(1, canardBroadcastObj(&ins, &transfer));
+    ASSERT_EQ(1, low_watermark_calls);
+    ASSERT_EQ(0, out_of_memory_calls);
+
+    ASSERT_EQ(-CANARD_ERROR_OUT_OF_MEMORY, canardBroadcastObj(&ins, &transfer));
+    ASSERT_EQ(1, out_of_memory_calls);
+    ASSERT_EQ(CanardPoolConsumerTx, out_of_memory_consumer);
+    ASSERT_EQ(20, out_of_memory_data_type_id);
+
+    // RX is refused as well
+    CanardCANFrame frame {};
+    frame.data_len = 8;
+    frame.id = CANARD_CAN_FRAME_EFF | (10U << 8U) | 7U;
+    frame.data[7] = 0x80;
+    ASSERT_EQ(-CANARD_ERROR_OUT_OF_MEMORY, canardHandleRxFrame(&ins, &frame, 1000));
+    ASSERT_EQ(2, out_of_memory_calls);
+    ASSERT_EQ(CanardPoolConsumerRxState, out_of_memory_consumer);
+    ASSERT_EQ(10, out_of_memory_data_type_id);
+
+    // Draining the queue above the watermark re-arms the hook
+    while (canardPeekTxQueue(&ins) != NULL)
+    {
+        canardPopTxQueue(&ins);
+    }
+    for (uint16_t i = 0; i < NUM_BLOCKS - 2; i++)
+    {
+        ASSERT_EQ(1, canardBroadcastObj(&ins, &transfer));
+    }
+    ASSERT_EQ(2, low_watermark_calls);
+}
+
+TEST(MemoryAllocatorTestGroup, UsageBreakdown)
+{
+    static const uint16_t NUM_BLOCKS = 32;
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+
+    CanardPoolUsageEntry entries[8];
+    ASSERT_EQ(0, canardGetPoolUsageBreakdown(&ins, entries, 8));
+
+    // An RX session from node 5 that has spilled over into payload blocks
+    CanardCANFrame frame {};
+    frame.data_len = 8;
+    frame.id = CANARD_CAN_FRAME_EFF | (10U << 8U) | 5U;
+    frame.data[7] = 0x80;
+    ASSERT_EQ(CANARD_OK, canardHandleRxFrame(&ins, &frame, 1000));
+    uint8_t toggle = 1;
+    while (canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxPayload).current_usage_blocks == 0)
+    {
+        frame.data[7] = (uint8_t)(toggle << 5U);
+        ASSERT_EQ(CANARD_OK, canardHandleRxFrame(&ins, &frame, 1000));
+        toggle ^= 1U;
+    }
+
+    // Two broadcasts of the same type and one request
+    uint8_t transfer_id = 0;
+    uint8_t payload[19] = {};
+    CanardTxTransfer transfer;
+    canardInitTxTransfer(&transfer);
+    transfer.transfer_type = CanardTransferTypeBroadcast;
+    transfer.data_type_id = 20;
+    transfer.inout_transfer_id = &transfer_id;
+    transfer.payload = payload;
+    transfer.payload_len = sizeof(payload);
+    ASSERT_EQ(3, canardBroadcastObj(&ins, &transfer));
+    transfer.payload_len = 4;
+    ASSERT_EQ(1, canardBroadcastObj(&ins, &transfer));
+    canardInitTxTransfer(&transfer);
+    transfer.transfer_type = CanardTransferTypeRequest;
+    transfer.data_type_id = 1;
+    transfer.inout_transfer_id = &transfer_id;
+    transfer.payload = payload;
+    transfer.payload_len = 2;
+    ASSERT_EQ(1, canardRequestOrRespondObj(&ins, 9, &transfer));
+
+    ASSERT_EQ(3, canardGetPoolUsageBreakdown(&ins, entries, 8));
+
+    ASSERT_FALSE(entries[0].tx);
+    ASSERT_EQ(10, entries[0].data_type_id);
+    ASSERT_EQ(CanardTransferTypeBroadcast, entries[0].transfer_type);
+    ASSERT_EQ(5, entries[0].node_id);
+    ASSERT_EQ(2, entries[0].blocks);        // The state and one payload block
+
+    uint16_t total = 0;
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        total = (uint16_t)(total + entries[i].blocks);
+        if (entries[i].tx && entries[i].transfer_type == CanardTransferTypeBroadcast)
+        {
+            ASSERT_EQ(20, entries[i].data_type_id);
+            ASSERT_EQ(0, entries[i].node_id);
+            ASSERT_EQ(4, entries[i].blocks);
+        }
+        else if (entries[i].tx)
+        {
+            ASSERT_EQ(CanardTransferTypeRequest, entries[i].transfer_type);
+            ASSERT_EQ(1, entries[i].data_type_id);
+            ASSERT_EQ(9, entries[i].node_id);
+            ASSERT_EQ(1, entries[i].blocks);
+        }
+    }
+    ASSERT_EQ(canardGetPoolAllocatorStatistics(&ins).current_usage_blocks, total);
+
+    // A short array is filled without overflowing
+    ASSERT_EQ(1, canardGetPoolUsageBreakdown(&ins, entries, 1));
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "replay.h"
+
+static const uint32_t PCAP_MAGIC = 0xA1B2C3D4U;
+static const uint32_t PCAP_MAGIC_NSEC = 0xA1B23C4DU;
+static const uint32_t LINKTYPE_CAN_SOCKETCAN = 227U;
+static const uint32_t SOCKETCAN_EFF_FLAG = 0x80000000U;
+
+static int16_t openString(ReplayCapture* cap, const std::string& text)
+{
+    return replayOpenBuffer(cap, text.data(), text.size());
+}
+
+TEST(ReplayTestGroup, CandumpFrames)
+{
+    const std::string log =
+        "(1436509052.249713) can0 1F400A0A#0102\n"
+        "\n"
+        "(1.5) can1 123#DEADBEEF\n"
+        "(2.000001) can0 1F400A0A#R\n"
+        "(3.000000) can0 0C8#R8 R\n"
+        "(4.0) can1 10#11.22.33\n";
+    ReplayCapture cap;
+    ASSERT_EQ(0, openString(&cap, log));
+    ASSERT_EQ(ReplayFormatCandump, cap.format);
+
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(1436509052249713ULL, timestamp);
+    ASSERT_EQ(CANARD_CAN_FRAME_EFF | 0x1F400A0AU, frame.id);
+    ASSERT_EQ(2, frame.data_len);
+    ASSERT_EQ(0x01, frame.data[0]);
+    ASSERT_EQ(0x02, frame.data[1]);
+    ASSERT_EQ(0, frame.iface_id);
+
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(1500000ULL, timestamp);
+    ASSERT_EQ(0x123U, frame.id);
+    ASSERT_EQ(4, frame.data_len);
+    ASSERT_EQ(0xEF, frame.data[3]);
+    ASSERT_EQ(1, frame.iface_id);
+
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(2000001ULL, timestamp);
+    ASSERT_EQ(CANARD_CAN_FRAME_EFF | CANARD_CAN_FRAME_RTR | 0x1F400A0AU, frame.id);
+    ASSERT_EQ(0, frame.data_len);
+
+    // the requested length and the direction of candump -x are ignored
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(CANARD_CAN_FRAME_RTR | 0xC8U, frame.id);
+    ASSERT_EQ(0, frame.data_len);
+
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0x10U, frame.id);
+    ASSERT_EQ(3, frame.data_len);
+    ASSERT_EQ(0x33, frame.data[2]);
+
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0U, cap.malformed);
+    ASSERT_EQ(2, cap.num_ifaces);
+    ASSERT_STREQ("can1", cap.ifaces[1]);
+
+    // and once more from the start
+    replayRewind(&cap);
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(1436509052249713ULL, timestamp);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, CandumpFdFrames)
+{
+    const std::string log =
+        "(1.0) can0 1F400A0A##1000102030405060708090A0B\n"
+        "(2.0) can0 123#01\n";
+    ReplayCapture cap;
+    ASSERT_EQ(0, openString(&cap, log));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+#if CANARD_ENABLE_CANFD
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_TRUE(frame.canfd);
+    ASSERT_EQ(CANARD_CAN_FRAME_EFF | 0x1F400A0AU, frame.id);
+    ASSERT_EQ(12, frame.data_len);
+    ASSERT_EQ(0x0B, frame.data[11]);
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_FALSE(frame.canfd);
+    ASSERT_EQ(0U, cap.unsupported);
+#else
+    // skipped and counted, the next frame is read
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0x123U, frame.id);
+    ASSERT_EQ(1U, cap.unsupported);
+#endif
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0U, cap.malformed);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, CandumpMalformedLines)
+{
+    const std::string log =
+        "garbage\n"
+        "(1.0 can0 123#00\n"
+        "(1.0) can0\n"
+        "(1.0) can0 123456789#00\n"
+        "(1.0) can0 800#00\n"
+        "(1.0) can0 123#0\n"
+        "(1.0) can0 123#0011223344556677889900\n"
+        "(1.0) can0 123##\n"
+        "(1.0) can0 123#zz\n"
+        "(5.0) can0 7FF#AA";                   // no newline at the end of the file
+    ReplayCapture cap;
+    ASSERT_EQ(0, openString(&cap, log));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(5000000ULL, timestamp);
+    ASSERT_EQ(0x7FFU, frame.id);
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(9U, cap.malformed);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, CandumpTooManyInterfaces)
+{
+    std::string log;
+    for (unsigned i = 0; i < REPLAY_MAX_IFACES + 2U; i++)
+    {
+        log += "(1.0) can" + std::to_string(i) + " 123#00\n";
+    }
+    log += "(1.0) can" + std::to_string(REPLAY_MAX_IFACES + 1U) + " 123#00\n";
+    ReplayCapture cap;
+    ASSERT_EQ(0, openString(&cap, log));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    for (unsigned i = 0; i < REPLAY_MAX_IFACES + 3U; i++)
+    {
+        ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+        ASSERT_EQ((i < REPLAY_MAX_IFACES) ? i : REPLAY_MAX_IFACES - 1U, frame.iface_id);
+    }
+    ASSERT_EQ(REPLAY_MAX_IFACES, cap.num_ifaces);
+    ASSERT_EQ(3U, cap.merged);
+    replayClose(&cap);
+}
+
+// Writes pcap files in the byte order of this host or the other one
+class PcapWriter
+{
+public:
+    PcapWriter(bool _swapped, uint32_t magic, uint32_t link_type = LINKTYPE_CAN_SOCKETCAN) : swapped(_swapped)
+    {
+        u32(magic);
+        u16(2);
+        u16(4);
+        u32(0);
+        u32(0);
+        u32(65535);
+        u32(link_type);
+    }
+
+    void record(uint32_t sec, uint32_t frac, uint32_t can_id, const std::vector<uint8_t>& data, uint8_t flags = 0,
+                uint32_t incl_len = 16U)
+    {
+        u32(sec);
+        u32(frac);
+        u32(incl_len);
+        u32(incl_len);
+        // the frame itself is in network byte order
+        std::vector<uint8_t> packet = {
+            (uint8_t)(can_id >> 24U), (uint8_t)(can_id >> 16U), (uint8_t)(can_id >> 8U), (uint8_t)can_id,
+            (uint8_t)data.size(), flags, 0, 0
+        };
+        packet.insert(packet.end(), data.begin(), data.end());
+        packet.resize(incl_len, 0);
+        bytes.insert(bytes.end(), packet.begin(), packet.end());
+    }
+
+    void u32(uint32_t value)
+    {
+        if (swapped)
+        {
+            value = __builtin_bswap32(value);
+        }
+        const uint8_t* p = (const uint8_t*)&value;
+        bytes.insert(bytes.end(), p, p + sizeof(value));
+    }
+
+    void u16(uint16_t value)
+    {
+        if (swapped)
+        {
+            value = __builtin_bswap16(value);
+        }
+        const uint8_t* p = (const uint8_t*)&value;
+        bytes.insert(bytes.end(), p, p + sizeof(value));
+    }
+
+    std::vector<uint8_t> bytes;
+    bool swapped;
+};
+
+static void checkPcapFrames(bool swapped, uint32_t magic, uint32_t frac, uint64_t expected_usec)
+{
+    PcapWriter pcap(swapped, magic);
+    pcap.record(10, frac, SOCKETCAN_EFF_FLAG | 0x1F400A0AU, {1, 2, 3});
+    pcap.record(11, 0, 0x123U, {});
+    ReplayCapture cap;
+    ASSERT_EQ(0, replayOpenBuffer(&cap, pcap.bytes.data(), pcap.bytes.size()));
+    ASSERT_EQ(ReplayFormatPcap, cap.format);
+    ASSERT_EQ(swapped, cap.swapped);
+
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(expected_usec, timestamp);
+    ASSERT_EQ(CANARD_CAN_FRAME_EFF | 0x1F400A0AU, frame.id);
+    ASSERT_EQ(3, frame.data_len);
+    ASSERT_EQ(3, frame.data[2]);
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(11000000ULL, timestamp);
+    ASSERT_EQ(0x123U, frame.id);
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0U, cap.malformed);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, PcapByteOrderAndResolution)
+{
+    checkPcapFrames(false, PCAP_MAGIC, 500U, 10000500ULL);
+    checkPcapFrames(true, PCAP_MAGIC, 500U, 10000500ULL);
+    checkPcapFrames(false, PCAP_MAGIC_NSEC, 1500000U, 10001500ULL);
+    checkPcapFrames(true, PCAP_MAGIC_NSEC, 1500000U, 10001500ULL);
+}
+
+TEST(ReplayTestGroup, PcapFdFrame)
+{
+    PcapWriter pcap(false, PCAP_MAGIC);
+    pcap.record(1, 0, SOCKETCAN_EFF_FLAG | 0x1234U, std::vector<uint8_t>(20, 0xAA), 0x04U, 72U);
+    pcap.record(2, 0, 0x123U, {7});
+    ReplayCapture cap;
+    ASSERT_EQ(0, replayOpenBuffer(&cap, pcap.bytes.data(), pcap.bytes.size()));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+#if CANARD_ENABLE_CANFD
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_TRUE(frame.canfd);
+    ASSERT_EQ(20, frame.data_len);
+    ASSERT_EQ(0xAA, frame.data[19]);
+#endif
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0x123U, frame.id);
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(CANARD_ENABLE_CANFD ? 0U : 1U, cap.unsupported);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, PcapMalformedRecords)
+{
+    PcapWriter pcap(false, PCAP_MAGIC);
+    pcap.record(1, 0, 0x123U, {}, 0, 4U);           // shorter than the SocketCAN header
+    pcap.record(2, 0, 0x123U, {1, 2, 3, 4, 5, 6, 7, 8, 9}, 0, 16U);  // more data than the record holds
+    pcap.record(3, 0, 0x124U, {1});
+    ReplayCapture cap;
+    ASSERT_EQ(0, replayOpenBuffer(&cap, pcap.bytes.data(), pcap.bytes.size()));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0x124U, frame.id);
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(2U, cap.malformed);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, PcapTruncated)
+{
+    // a record cut off in its header
+    PcapWriter pcap(false, PCAP_MAGIC);
+    pcap.record(1, 0, 0x123U, {1});
+    std::vector<uint8_t> bytes = pcap.bytes;
+    bytes.resize(bytes.size() + 10U, 0);
+    ReplayCapture cap;
+    ASSERT_EQ(0, replayOpenBuffer(&cap, bytes.data(), bytes.size()));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(1U, cap.malformed);
+    replayClose(&cap);
+
+    // and one that claims more than the file holds
+    PcapWriter long_record(true, PCAP_MAGIC);
+    long_record.record(1, 0, 0x123U, {1});
+    long_record.u32(2);
+    long_record.u32(0);
+    long_record.u32(1000000U);
+    long_record.u32(1000000U);
+    long_record.bytes.resize(long_record.bytes.size() + 16U, 0);
+    ASSERT_EQ(0, replayOpenBuffer(&cap, long_record.bytes.data(), long_record.bytes.size()));
+    ASSERT_EQ(1, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+    ASSERT_EQ(1U, cap.malformed);
+    replayClose(&cap);
+}
+
+TEST(ReplayTestGroup, UnsupportedFiles)
+{
+    ReplayCapture cap;
+    const uint32_t pcapng = 0x0A0D0D0AU;
+    std::vector<uint8_t> bytes(32, 0);
+    memcpy(bytes.data(), &pcapng, sizeof(pcapng));
+    ASSERT_EQ(-EPROTONOSUPPORT, replayOpenBuffer(&cap, bytes.data(), bytes.size()));
+
+    PcapWriter ethernet(false, PCAP_MAGIC, 1U);
+    ASSERT_EQ(-EPROTONOSUPPORT, replayOpenBuffer(&cap, ethernet.bytes.data(), ethernet.bytes.size()));
+
+    PcapWriter header(false, PCAP_MAGIC);
+    ASSERT_EQ(-EINVAL, replayOpenBuffer(&cap, header.bytes.data(), 20U));
+
+    // an empty file is an empty log
+    ASSERT_EQ(0, replayOpenBuffer(&cap, nullptr, 0));
+    CanardCANFrame frame;
+    uint64_t timestamp = 0;
+    ASSERT_EQ(0, replayNext(&cap, &frame, &timestamp));
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+#include <gtest/gtest.h>
+#include "canard_internals.h"
+
+#define NUM_BLOCKS 32
+
+static bool shouldAcceptAll(const CanardInstance*, uint64_t* out_data_type_signature, uint16_t,
+                            CanardTransferType, uint8_t)
+{
+    *out_data_type_signature = 0;
+    return true;
+}
+
+static void onTransferReceptionNop(CanardInstance*, CanardRxTransfer*)
+{
+}
+
+/// Starts a multi-frame transfer from the given node, which takes an RX state and payload blocks
+static void startRxSession(CanardInstance* ins, uint8_t source_node_id)
+{
+    CanardCANFrame frame {};
+    frame.data_len = 8;
+    frame.id = CANARD_CAN_FRAME_EFF | (10U << 8U) | source_node_id;
+    frame.data[7] = 0x80;
+    ASSERT_EQ(CANARD_OK, canardHandleRxFrame(ins, &frame, 1000));
+    for (uint8_t toggle = 1; toggle < 4; toggle++)
+    {
+        frame.data[7] = (uint8_t)((toggle & 1U) << 5U);
+        ASSERT_EQ(CANARD_OK, canardHandleRxFrame(ins, &frame, 1000));
+    }
+}
+
+static void broadcast(CanardInstance* ins)
+{
+    static uint8_t transfer_id = 0;
+    uint8_t payload[4] = {};
+    CanardTxTransfer transfer;
+    canardInitTxTransfer(&transfer);
+    transfer.transfer_type = CanardTransferTypeBroadcast;
+    transfer.data_type_id = 20;
+    transfer.inout_transfer_id = &transfer_id;
+    transfer.payload = payload;
+    transfer.payload_len = sizeof(payload);
+    ASSERT_EQ(1, canardBroadcastObj(ins, &transfer));
+}
+
+TEST(Reset, DropsEverythingAndKeepsQuotas)
+{
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+    ASSERT_EQ(CANARD_OK, canardSetPoolQuota(&ins, CanardPoolConsumerTx, 4, 8));
+
+    startRxSession(&ins, 5);
+    startRxSession(&ins, 6);
+    broadcast(&ins);
+    broadcast(&ins);
+    const uint16_t peak = canardGetPoolAllocatorStatistics(&ins).current_usage_blocks;
+
+    canardReset(&ins, CANARD_RESET_RX_STATES | CANARD_RESET_TX_QUEUE);
+
+    ASSERT_EQ(NULL, ins.rx_states);
+    ASSERT_EQ(NULL, canardPeekTxQueue(&ins));
+    ASSERT_EQ(0, canardGetPoolAllocatorStatistics(&ins).current_usage_blocks);
+    ASSERT_EQ(peak, canardGetPoolAllocatorStatistics(&ins).peak_usage_blocks);
+    for (uint8_t i = 0; i < CANARD_POOL_NUM_CONSUMERS; i++)
+    {
+        ASSERT_EQ(0, canardGetPoolConsumerStatistics(&ins, (CanardPoolConsumer)i).current_usage_blocks);
+    }
+    ASSERT_EQ(4, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerTx).reserved_blocks);
+    ASSERT_EQ(8, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerTx).max_blocks);
+#if !CANARD_ALLOCATE_LOCKFREE && !CANARD_RX_STATE_ARRAY_SIZE
+    // The free list is back in arena order
+    ASSERT_EQ(&arena[0], ins.allocator.free_list);
+#endif
+
+    // The instance is fully usable afterwards
+    startRxSession(&ins, 5);
+    broadcast(&ins);
+}
+
+TEST(Reset, DropsOnlyTheSelectedLists)
+{
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+
+    startRxSession(&ins, 5);
+    broadcast(&ins);
+
+    canardReset(&ins, CANARD_RESET_RX_STATES);
+    ASSERT_EQ(NULL, ins.rx_states);
+    ASSERT_NE(nullptr, canardPeekTxQueue(&ins));
+    ASSERT_EQ(1, canardGetPoolAllocatorStatistics(&ins).current_usage_blocks);
+
+    startRxSession(&ins, 5);
+    canardReset(&ins, CANARD_RESET_TX_QUEUE);
+    ASSERT_EQ(NULL, canardPeekTxQueue(&ins));
+    ASSERT_NE(nullptr, ins.rx_states);
+    ASSERT_EQ(0, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerTx).current_usage_blocks);
+    ASSERT_EQ(1, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxState).current_usage_blocks);
+}
+
+TEST(Reset, PurgeRxStatesFromNode)
+{
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+
+    startRxSession(&ins, 5);
+    startRxSession(&ins, 6);
+    startRxSession(&ins, 7);
+    const uint16_t usage = canardGetPoolAllocatorStatistics(&ins).current_usage_blocks;
+
+    ASSERT_EQ(0, canardPurgeRxStatesFromNode(&ins, 100));
+    ASSERT_EQ(1, canardPurgeRxStatesFromNode(&ins, 6));
+    ASSERT_EQ(0, canardPurgeRxStatesFromNode(&ins, 6));
+    ASSERT_EQ(2, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxState).current_usage_blocks);
+    ASSERT_EQ(usage / 3 * 2, canardGetPoolAllocatorStatistics(&ins).current_usage_blocks);
+
+    CanardPoolUsageEntry entries[4];
+    ASSERT_EQ(2, canardGetPoolUsageBreakdown(&ins, entries, 4));
+    ASSERT_NE(6, entries[0].node_id);
+    ASSERT_NE(6, entries[1].node_id);
+
+    ASSERT_EQ(1, canardPurgeRxStatesFromNode(&ins, 7));
+    ASSERT_EQ(1, canardPurgeRxStatesFromNode(&ins, 5));
+    ASSERT_EQ(NULL, ins.rx_states);
+    ASSERT_EQ(0, canardGetPoolAllocatorStatistics(&ins).current_usage_blocks);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+#include <gtest/gtest.h>
+#include "canard_internals.h"
+
+#if CANARD_RX_STATE_ARRAY_SIZE != 8
+#error "This test expects CANARD_RX_STATE_ARRAY_SIZE=8"
+#endif
+
+#define NUM_BLOCKS 64
+
+static bool shouldAcceptAll(const CanardInstance*, uint64_t* out_data_type_signature, uint16_t,
+                            CanardTransferType, uint8_t)
+{
+    *out_data_type_signature = 0;
+    return true;
+}
+
+static void onTransferReceptionNop(CanardInstance*, CanardRxTransfer*)
+{
+}
+
+TEST(RxStateArrayTestGroup, StatesAreKeptApartFromPayload)
+{
+    CanardPoolAllocatorBlock arena[NUM_BLOCKS];
+    CanardInstance ins;
+    canardInit(&ins, arena, sizeof(arena), onTransferReceptionNop, shouldAcceptAll, NULL);
+    canardSetLocalNodeID(&ins, 42);
+
+    ASSERT_EQ(NUM_BLOCKS - 8, canardGetPoolAllocatorStatistics(&ins).capacity_blocks);
+
+    // Start multi-frame transfers from more sources than there are RX state slots
+    CanardCANFrame frame {};
+    frame.data_len = 8;
+    for (uint8_t source = 1; source <= 10; source++)
+    {
+        frame.id = CANARD_CAN_FRAME_EFF | (10U << 8U) | source;
+        frame.data[7] = 0x80;
+        const int16_t ret = canardHandleRxFrame(&ins, &frame, 1000);
+        ASSERT_EQ((source <= 8) ? CANARD_OK : -CANARD_ERROR_OUT_OF_MEMORY, ret);
+        for (uint8_t toggle = 1; (ret == CANARD_OK) && (toggle < 20); toggle++)
+        {
+            frame.data[7] = (uint8_t)((toggle & 1U) << 5U);
+            ASSERT_EQ(CANARD_OK, canardHandleRxFrame(&ins, &frame, 1000));
+        }
+    }
+
+    const CanardPoolConsumerStatistics states = canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxState);
+    ASSERT_EQ(8, states.current_usage_blocks);
+    ASSERT_EQ(2U, states.denied_allocations);
+    ASSERT_GT(canardGetPoolAllocatorStatistics(&ins).current_usage_blocks, 0);
+
+    // All states are in the dense region at the start of the arena, payload blocks are behind it
+    for (CanardRxState* state = ins.rx_states; state != NULL;
+         state = canardRxFromIdx(&ins.rx_state_allocator, state->next))
+    {
+        ASSERT_GE((void*)state, (void*)&arena[0]);
+        ASSERT_LT((void*)state, (void*)&arena[8]);
+        for (CanardBufferBlock* block = canardBufferFromIdx(&ins.allocator, state->buffer_blocks);
+             block != NULL; block = block->next)
+        {
+            ASSERT_GE((void*)block, (void*)&arena[8]);
+        }
+    }
+
+    canardCleanupStaleTransfers(&ins, 1000 + 3000000);
+    ASSERT_EQ(0, canardGetPoolConsumerStatistics(&ins, CanardPoolConsumerRxState).current_usage_blocks);
+    ASSERT_EQ(0, canardGetPoolAllocatorStatistics(&ins).current_usage_blocks);
+}
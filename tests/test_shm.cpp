@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2016 UAVCAN Team
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Contributors: https://github.com/UAVCAN/libcanard/contributors
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <poll.h>
+#include "shm.h"
+
+// Two nodes on a fresh bus; every test uses its own bus, ctest runs them in parallel
+class ShmTestGroup : public ::testing::Test
+{
+protected:
+    void open(const char* bus)
+    {
+        name = bus;
+        (void)shmcanUnlink(name);
+#if CANARD_ENABLE_CANFD
+        ASSERT_EQ(0, shmcanInit(&a, name, false));
+        ASSERT_EQ(0, shmcanInit(&b, name, false));
+#else
+        ASSERT_EQ(0, shmcanInit(&a, name));
+        ASSERT_EQ(0, shmcanInit(&b, name));
+#endif
+    }
+
+    void TearDown() override
+    {
+        if (name != nullptr)
+        {
+            (void)shmcanClose(&a);
+            (void)shmcanClose(&b);
+            (void)shmcanUnlink(name);
+        }
+    }
+
+    const char* name = nullptr;
+    SHMCANInstance a;
+    SHMCANInstance b;
+};
+
+static CanardCANFrame makeFrame(uint32_t id, uint32_t number)
+{
+    CanardCANFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.id = id;
+    frame.data_len = 4;
+    memcpy(frame.data, &number, sizeof(number));
+    return frame;
+}
+
+static uint32_t frameNumber(const CanardCANFrame& frame)
+{
+    uint32_t number = 0;
+    memcpy(&number, frame.data, sizeof(number));
+    return number;
+}
+
+TEST_F(ShmTestGroup, OwnFramesAreFiltered)
+{
+    open("shm:7");
+    const CanardCANFrame sent = makeFrame(CANARD_CAN_FRAME_EFF | 0x1234U, 42);
+    ASSERT_EQ(1, shmcanTransmit(&a, &sent, 0));
+
+    CanardCANFrame frame;
+    ASSERT_EQ(0, shmcanReceive(&a, &frame, 0));
+    ASSERT_EQ(1, shmcanReceive(&b, &frame, 0));
+    ASSERT_EQ(sent.id, frame.id);
+    ASSERT_EQ(42U, frameNumber(frame));
+    ASSERT_EQ(0, shmcanReceive(&b, &frame, 0));
+
+    // a node that joins later doesn't see earlier frames
+    SHMCANInstance c;
+#if CANARD_ENABLE_CANFD
+    ASSERT_EQ(0, shmcanInit(&c, name, false));
+#else
+    ASSERT_EQ(0, shmcanInit(&c, name));
+#endif
+    ASSERT_EQ(0, shmcanReceive(&c, &frame, 0));
+    ASSERT_EQ(1, shmcanTransmit(&b, &sent, 0));
+    ASSERT_EQ(1, shmcanReceive(&a, &frame, 0));
+    ASSERT_EQ(1, shmcanReceive(&c, &frame, 0));
+    ASSERT_EQ(0, shmcanClose(&c));
+}
+
+TEST_F(ShmTestGroup, BatchIsSentInArbitrationOrder)
+{
+    open("shm:8");
+    // an extended identifier with base identifier 0 wins over standard identifier 1, which wins over its RTR
+    // frame, which wins over extended identifiers with base identifier 1; equal identifiers keep their order
+    const CanardCANFrame sent[] = {
+        makeFrame(CANARD_CAN_FRAME_EFF | 0x40000U, 0),
+        makeFrame(CANARD_CAN_FRAME_RTR | 1U, 1),
+        makeFrame(CANARD_CAN_FRAME_EFF | 0x40000U, 2),
+        makeFrame(1U, 3),
+        makeFrame(CANARD_CAN_FRAME_EFF | 0x100U, 4),
+    };
+    const uint32_t expected[] = { 4, 3, 1, 0, 2 };
+    ASSERT_EQ(5, shmcanTransmitBatch(&a, sent, 5, 0));
+
+    CanardCANFrame frames[8];
+    ASSERT_EQ(5, shmcanReceiveBatch(&b, frames, 8, 0));
+    for (unsigned i = 0; i < 5U; i++)
+    {
+        ASSERT_EQ(expected[i], frameNumber(frames[i]));
+        ASSERT_EQ(sent[expected[i]].id, frames[i].id);
+    }
+}
+
+TEST_F(ShmTestGroup, OverrunResynchronizes)
+{
+    open("shm:9");
+    // the receiver reads a few frames, then falls more than a ring behind
+    const unsigned num_sent = SHMCAN_RING_FRAMES + SHMCAN_RING_FRAMES / 4U + 10U;
+    CanardCANFrame batch[SHMCAN_MAX_BATCH];
+    CanardCANFrame frames[SHMCAN_MAX_BATCH];
+    for (unsigned i = 0; i < SHMCAN_MAX_BATCH; i++)
+    {
+        batch[i] = makeFrame(CANARD_CAN_FRAME_EFF | 0x1000U, i);
+    }
+    ASSERT_EQ((int16_t)SHMCAN_MAX_BATCH, shmcanTransmitBatch(&a, batch, SHMCAN_MAX_BATCH, 0));
+    ASSERT_EQ(10, shmcanReceiveBatch(&b, frames, 10, 0));
+    for (unsigned sent = SHMCAN_MAX_BATCH; sent < num_sent; sent += SHMCAN_MAX_BATCH)
+    {
+        for (unsigned i = 0; i < SHMCAN_MAX_BATCH; i++)
+        {
+            batch[i] = makeFrame(CANARD_CAN_FRAME_EFF | 0x1000U, sent + i);
+        }
+        ASSERT_EQ((int16_t)SHMCAN_MAX_BATCH, shmcanTransmitBatch(&a, batch, SHMCAN_MAX_BATCH, 0));
+    }
+    const unsigned total = (num_sent + SHMCAN_MAX_BATCH - 1U) / SHMCAN_MAX_BATCH * SHMCAN_MAX_BATCH;
+
+    // the frames after the resync are the newest ones, in order and without gaps
+    unsigned received = 10;
+    uint32_t expected = 0;
+    bool first = true;
+    int16_t res;
+    while ((res = shmcanReceiveBatch(&b, frames, SHMCAN_MAX_BATCH, 0)) > 0)
+    {
+        for (int16_t i = 0; i < res; i++)
+        {
+            if (!first)
+            {
+                ASSERT_EQ(expected, frameNumber(frames[i]));
+            }
+            first = false;
+            expected = frameNumber(frames[i]) + 1U;
+            received++;
+        }
+    }
+    ASSERT_EQ(0, res);
+    ASSERT_EQ(total, expected);
+    ASSERT_GT(b.overruns, 0U);
+    ASSERT_EQ(total, received + b.overruns);
+
+    // and the bus goes on as normal
+    ASSERT_EQ(1, shmcanTransmit(&a, &batch[0], 0));
+    ASSERT_EQ(1, shmcanReceive(&b, &frames[0], 0));
+    ASSERT_EQ(frameNumber(batch[0]), frameNumber(frames[0]));
+    ASSERT_EQ(total, received + b.overruns);
+}
+
+static bool eventFdReadable(const SHMCANInstance& ins, int timeout_msec)
+{
+    struct pollfd pfd = { ins.event_fd, POLLIN, 0 };
+    return poll(&pfd, 1, timeout_msec) == 1 && (pfd.revents & POLLIN) != 0;
+}
+
+TEST_F(ShmTestGroup, EventFdSignalsTransmissions)
+{
+    open("shm:6");
+    ASSERT_EQ(0, shmcanEnableEventFd(&b));
+    ASSERT_GE(b.event_fd, 0);
+
+    // readable once the thread is up, cleared by reading the empty ring
+    ASSERT_TRUE(eventFdReadable(b, 1000));
+    CanardCANFrame frames[4];
+    ASSERT_EQ(0, shmcanReceiveBatch(&b, frames, 4, 0));
+    ASSERT_FALSE(eventFdReadable(b, 50));
+
+    CanardCANFrame batch[6];
+    for (unsigned i = 0; i < 6U; i++)
+    {
+        batch[i] = makeFrame(0x10U, i);
+    }
+    ASSERT_EQ(6, shmcanTransmitBatch(&a, batch, 6, 0));
+    ASSERT_TRUE(eventFdReadable(b, 1000));
+
+    // stays readable while frames are left behind
+    ASSERT_EQ(4, shmcanReceiveBatch(&b, frames, 4, 0));
+    ASSERT_TRUE(eventFdReadable(b, 0));
+    ASSERT_EQ(2, shmcanReceiveBatch(&b, frames, 4, 0));
+    ASSERT_FALSE(eventFdReadable(b, 50));
+
+    ASSERT_EQ(0, shmcanClose(&b));
+    ASSERT_EQ(-1, b.event_fd);
+}